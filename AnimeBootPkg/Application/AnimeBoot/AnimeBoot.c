@@ -1,17 +1,33 @@
 #include "AnimeBoot.h"
+#include "AsyncRead.h"
+#include "BmpDecode.h"
+#include "DecodePool.h"
 #include "DisplayMath.h"
+#include "FrameClock.h"
+#include "FrameScaler.h"
+#include "FrameTrace.h"
 #include "GopBlitter.h"
+#include "JsonToken.h"
+#include "Lz4Decode.h"
+#include "PlaybackArena.h"
+#include "SplashFrame.h"
 
 #include <Guid/FileInfo.h>
-#include <IndustryStandard/Bmp.h>
+#include <Guid/FileSystemVolumeLabelInfo.h>
 #include <Library/AsciiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/FileHandleLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/PartitionInfo.h>
 
 #define DEFAULT_PACKAGE_PATH        L"\\EFI\\AnimeBoot\\splash.anim"
 #define DEFAULT_MANIFEST_PATH       L"\\EFI\\AnimeBoot\\sequence.anim.json"
 #define DEFAULT_NEXT_STAGE_PATH     L"\\EFI\\Microsoft\\Boot\\bootmgfw.efi"
+#define AB_TRACE_PATH               L"\\EFI\\AnimeBoot\\trace.json"
+#define AB_CONFIG_PATH              L"\\EFI\\AnimeBoot\\config.json"
+#define AB_BOOT_PLAN_VARIABLE       L"AnimeBootPlan"
 
 #define AB_DEFAULT_FPS              24
 #define AB_DEFAULT_FRAME_DURATION   (1000000U / AB_DEFAULT_FPS)
@@ -21,16 +37,51 @@
 #define AB_MAX_FRAME_SIZE_BYTES     (16U * 1024U * 1024U)
 #define AB_MAX_LOOP_COUNT           100U
 #define AB_MIN_FRAME_DURATION_US    10000U
+#define AB_MIN_RING_DEPTH           2U
+#define AB_MAX_RING_DEPTH           8U
+#define AB_TRACE_CAPACITY           16384U
+#define AB_DEFAULT_DECODE_WORKERS   AB_MAX_RING_DEPTH
+// Loose BMPs: headers plus row padding on top of the BGRA32 pixel bytes.
+#define AB_LOOSE_PAYLOAD_SLACK      4096U
+#define AB_FILE_INFO_SIZE           (SIZE_OF_EFI_FILE_INFO + 256 * sizeof(CHAR16))
+#define AB_DEFAULT_PRELOAD_PERCENT  50U
+#define AB_PRELOAD_MIN_CHUNK        (64U * 1024U)
+#define AB_PRELOAD_FIRST_CHUNK      (256U * 1024U)
+#define AB_PRELOAD_MAX_CHUNK        (8U * 1024U * 1024U)
+// Runs of repeated frames fold into one slot up to this long, so an endless
+// loop of one image cannot keep the producer spinning.
+#define AB_MAX_HOLD_US              1000000U
+// The first read of a package; enough for the header, manifest and tables of
+// most packages. Hot prefixes up to the cap are completed with a second read.
+#define AB_PACKAGE_PROBE_BYTES      (64U * 1024U)
+#define AB_MAX_HOT_PREFIX_BYTES     (4U * 1024U * 1024U)
+// Long enough for a GPT name (36) or a partition GUID in text form.
+#define AB_PARTITION_SPEC_CHARS     40U
+#define AB_VOLUME_LABEL_CHARS       64U
+#define AB_BOOT_PLAN_VERSION        3U
+#define AB_BOOT_PLAN_MAX_BYTES      2048U
+// OEM error range, so no firmware service can return it: the boot plan no
+// longer matches and nothing has been presented yet.
+#define AB_STATUS_PLAN_STALE        ENCODE_ERROR((MAX_BIT >> 1) | 1)
 
 typedef struct {
   UINT32 LogicalWidth;
   UINT32 LogicalHeight;
   UINT32 FrameDurationUs;
+  UINT32 TargetFps;          // 0 when FrameDurationUs was given explicitly
   UINT32 LoopCount;
   BOOLEAN AllowKeySkip;
+  BOOLEAN AllowFrameDrop;
+  BOOLEAN CacheFrames;
+  BOOLEAN DirectFramebuffer;
+  BOOLEAN SelectMode;
+  UINT32 DecodeWorkers;      // APs to decode on, 0 = BSP only
+  BOOLEAN AsyncIo;           // ReadEx where the file protocol supports it
   UINT64 MaxMemoryBytes;
+  UINT32 PreloadPercent;     // Preload packages up to this share of MaxMemoryBytes
   UINT32 MaxTotalDurationMs;
   CHAR8  Scaling[16];
+  CHAR8  ScaleFilter[16];
 } PLAYBACK_CONFIG;
 
 typedef struct {
@@ -40,36 +91,215 @@ typedef struct {
   ANIM_FRAME_DESC      *FrameTable;
   CHAR8                *ManifestJson;
   UINT32               ManifestSize;
+  UINT32               MaxFrameLength;
+  UINT8                *Preload;         // Frame data section, NULL when streaming
+  UINTN                PreloadPages;
+  ANIM_FRAME_RECT      *RectTable;       // NULL unless ANIM_PACKAGE_FLAG_FRAME_RECTS
+  UINT8                *Prefix;          // Start of the file, read in one go at open
+  UINTN                PrefixSize;
+  EFI_TIME             ModificationTime;
 } ANIM_PACKAGE_STATE;
 
 typedef struct {
-  CHAR16 *Path;
-  UINT32 DurationUs;
+  CHAR16       *Path;
+  CONST CHAR16 *Name;        // Leaf of Path, opened relative to Directory
+  UINT32       Directory;    // Index into LOOSE_MANIFEST_STATE.Directories
+  UINT64       FileSize;     // From the load-time directory scan
+  UINT32       DurationUs;
 } LOOSE_FRAME_DESC;
 
+typedef struct {
+  CHAR16            *Path;
+  EFI_FILE_PROTOCOL *Handle;   // Kept open for the whole playback
+} LOOSE_DIRECTORY;
+
 typedef struct {
   PLAYBACK_CONFIG  Config;
   LOOSE_FRAME_DESC *Frames;
   UINT32           FrameCount;
+  LOOSE_DIRECTORY  *Directories;
+  UINT32           DirectoryCount;
 } LOOSE_MANIFEST_STATE;
 
 typedef struct {
   ANIM_PACKAGE_STATE *Package;
+  EFI_FILE_PROTOCOL  *Root;
+  CONST CHAR16       *Path;      // Reopened per ring slot
 } PACKAGE_PLAYBACK_CONTEXT;
 
 typedef struct {
   const LOOSE_MANIFEST_STATE *Manifest;
-  EFI_FILE_PROTOCOL          *Root;
 } LOOSE_PLAYBACK_CONTEXT;
 
+typedef struct {
+  UINT8             *Data;        // Arena scratch, sized for the largest frame
+  UINTN             Size;
+  UINTN             Capacity;
+  ANIM_PIXEL_FORMAT Format;
+  BOOLEAN           SniffFormat;   // Loose files: BMP or raw BGRA32 by content
+  FRAME_BUFFER      *Target;       // Where the frame is decoded to
+  BOOLEAN           InPlace;       // Read straight into Target->Pixels
+  EFI_FILE_PROTOCOL *Handle;       // Slot's own package handle, so reads can overlap
+  ASYNC_READ        Read;
+} FRAME_PAYLOAD;
+
+// Starts reading a frame's encoded bytes on the BSP; the read may still be in
+// flight on return. Decoding is dispatched separately once the bytes land, so
+// it can run on an AP while the next frames are being read.
 typedef EFI_STATUS (*FRAME_LOADER)(
     VOID *Context,
     UINT32 FrameIndex,
-    FRAME_BUFFER *Target,
-    UINT32 *DurationUs
+    FRAME_PAYLOAD *Payload
+    );
+
+// Returns the per-frame duration in microseconds, or 0 for the nominal rate.
+typedef UINT32 (*FRAME_DURATION_QUERY)(
+    VOID *Context,
+    UINT32 FrameIndex
+    );
+
+// TRUE when FrameIndex shows exactly the image of frame Shown.
+typedef BOOLEAN (*FRAME_REPEAT_QUERY)(
+    VOID *Context,
+    UINT32 Shown,
+    UINT32 FrameIndex
+    );
+
+// TRUE when FrameIndex only replaces Rect of the screen image; its payload is
+// then a Rect-sized image and the rest of the screen stays as it was.
+typedef BOOLEAN (*FRAME_REGION_QUERY)(
+    VOID *Context,
+    UINT32 FrameIndex,
+    FRAME_RECT *Rect
     );
 
+typedef struct {
+  FRAME_BUFFER  *Buffer;     // decode target, from the playback arena
+  FRAME_BUFFER  *Frame;      // what to present: Buffer, a cached frame or Region
+  FRAME_BUFFER  Region;      // Rect-sized view of the start of Buffer or a cached frame
+  FRAME_RECT    Rect;        // Part of the screen image Frame replaces
+  FRAME_PAYLOAD Payload;     // encoded bytes, kept until the decode is collected
+  DECODE_TASK   Decode;
+  AB_BMP_KERNEL Kernel;      // BMP row kernel used, AbBmpKernelCount if none
+  UINT64        DecodeCycles;
+  UINT32        FrameIndex;
+  UINT32        DurationUs;  // Includes repeats of this frame folded into the slot
+  BOOLEAN       Final;
+  BOOLEAN       Hold;        // Repeats what is on screen: nothing to decode or blit
+  BOOLEAN       Reading;     // Read issued, decode not yet submitted
+  BOOLEAN       Pending;     // Decode submitted, not yet collected
+} FRAME_RING_SLOT;
+
+// Decoded frames waiting for their deadline, in presentation order.
+typedef struct {
+  FRAME_RING_SLOT Slots[AB_MAX_RING_DEPTH];
+  UINT32          Depth;
+  UINT32          Head;
+  UINT32          Count;
+  UINT32          Underruns;
+  UINT32          MinOccupancy;
+  UINT64          OccupancySum;
+  UINT32          OccupancySamples;
+  UINT64          DecodeWaitUs;
+  UINT32          Repeats;   // Frames shown by extending an earlier one
+  BMP_KERNEL_STATS Kernels[AbBmpKernelCount];
+  LZ4_DECODE_STATS Lz4;
+} FRAME_RING;
+
+// Decoded frames kept across loops, indexed by frame number. Once Capacity
+// frames are resident new ones bypass the cache rather than evicting: for a
+// cyclic scan that keeps a stable Capacity/FrameCount hit rate where LRU
+// would miss on every access.
+typedef struct {
+  FRAME_BUFFER **Frames;
+  UINT32       FrameCount;
+  UINT32       Capacity;
+  UINT32       Resident;
+  UINT64       ResidentBytes;
+  UINT32       Hits;
+  UINT32       Misses;
+} FRAME_CACHE;
+
+typedef struct {
+  PLAYBACK_CONFIG      *Config;
+  FRAME_LOADER         Loader;
+  FRAME_DURATION_QUERY QueryDuration;
+  FRAME_REPEAT_QUERY   QueryRepeat;
+  FRAME_REGION_QUERY   QueryRegion;   // NULL when every frame is full size
+  VOID                 *Context;
+  UINT32               FrameCount;
+  UINT32               OnScreen;      // last frame presented, MAX_UINT32 before the first
+  UINT32               NextLoop;      // producer cursor
+  UINT32               NextFrame;
+  BOOLEAN              Exhausted;
+  UINT64               LoadCostUs;    // running estimate of one Loader call
+  FRAME_SCHEDULER      Scheduler;
+  FRAME_RING           Ring;
+  FRAME_CACHE          Cache;
+  PLAYBACK_ARENA       Arena;
+  FRAME_BUFFER         *Canvas;       // Screen image partial frames are composed onto
+} PLAYBACK_STATE;
+
+// What a volume can be named by in a path spec. Everything but the file
+// system label comes from protocols already on the handle; the label needs
+// the volume opened and is only read when nothing else matched.
+typedef struct {
+  EFI_HANDLE Handle;
+  BOOLEAN    HasGuid;
+  EFI_GUID   PartitionGuid;   // GPT unique partition GUID
+  CHAR16     GptName[37];
+  CHAR16     LegacyName[16];  // PARTxx or BLKxxxxxxxx
+  BOOLEAN    LabelRead;
+  CHAR16     VolumeLabel[AB_VOLUME_LABEL_CHARS];
+  BOOLEAN    OpenFailed;      // Matched a spec but would not open; skipped by later lookups
+} VOLUME_ENTRY;
+
+// Built on the first partition lookup and kept for the rest of the boot.
+typedef struct {
+  BOOLEAN      Built;
+  VOLUME_ENTRY *Entries;
+  UINTN        Count;
+  UINT64       BuildUs;
+  UINT32       LabelsRead;
+  UINT64       LabelUs;
+} VOLUME_INDEX;
+
+typedef struct {
+  UINT64   Size;              // MAX_UINT64 when the file does not exist
+  EFI_TIME Time;              // Last modification
+} FILE_IDENTITY;
+
+// What an earlier boot resolved for its package, kept in
+// AB_BOOT_PLAN_VARIABLE. Followed by the volume's device path and the
+// package path (NUL terminated). The variable is not runtime accessible, so
+// only pre-OS code can have written it.
+typedef struct {
+  UINT32          Version;
+  UINT32          Size;              // Whole variable
+  UINT32          DevicePathSize;
+  UINT32          PathSize;
+  UINT32          PlaybackSize;      // sizeof(PLAYBACK_CONFIG) in the build that wrote it
+  FILE_IDENTITY   Image;             // AnimeBoot.efi, so another build never applies it
+  FILE_IDENTITY   Config;            // config.json on the boot volume
+  FILE_IDENTITY   Package;
+  UINT32          HeaderCrc;
+  UINT32          ManifestCrc;
+  BOOLEAN         Trace;
+  UINT64          SetupUs;           // Entry to playback on the boot that wrote the plan
+  PLAYBACK_CONFIG Playback;          // After manifest overrides
+} BOOT_PLAN;
+
 static EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL *mTextInputEx = NULL;
+static UINT64                            mStartUs = 0;
+static VOLUME_INDEX                      mVolumeIndex;
+static FILE_IDENTITY                     mImageIdentity;
+static FILE_IDENTITY                     mConfigIdentity;
+static BOOT_PLAN                         *mBootPlan = NULL;
+// {CD38DC4D-CF22-4440-A502-8E301338E52A}
+static EFI_GUID                          mBootPlanGuid = {
+  0xcd38dc4d, 0xcf22, 0x4440, { 0xa5, 0x02, 0x8e, 0x30, 0x13, 0x38, 0xe5, 0x2a }
+};
+static BOOLEAN                           mFirstPixelShown = FALSE;
 
 static EFI_STATUS
 AbOpenRoot(
@@ -80,24 +310,30 @@ AbOpenRoot(
 static EFI_STATUS
 AbOpenRootFromPath(
     CONST CHAR16 *PathSpec,
-    EFI_FILE_PROTOCOL **Root);
+    EFI_FILE_PROTOCOL **Root,
+    EFI_HANDLE *Volume);
 
 static EFI_STATUS
-AbEnumerateFatPartitions(
-    EFI_HANDLE **Handles,
-    UINTN *HandleCount);
+AbBuildVolumeIndex(VOID);
+
+static VOID
+AbDescribeVolume(
+    EFI_HANDLE Handle,
+    VOLUME_ENTRY *Entry);
+
+static VOID
+AbReadVolumeLabel(VOLUME_ENTRY *Entry);
+
+static BOOLEAN
+AbStrEqualsNoCase(
+    CONST CHAR16 *First,
+    CONST CHAR16 *Second);
 
 static EFI_STATUS
 AbFindPartitionByLabel(
     CONST CHAR16 *Label,
     EFI_HANDLE *Handle);
 
-static EFI_STATUS
-AbGetPartitionLabel(
-    EFI_HANDLE Handle,
-    CHAR16 *Label,
-    UINTN LabelSize);
-
 static EFI_STATUS
 AbParsePathSpec(
     CONST CHAR16 *PathSpec,
@@ -116,21 +352,145 @@ AbFreeAnimationConfig(ANIMATION_CONFIG *Config);
 
 static EFI_STATUS
 AbPlayFromPackage(
-    EFI_FILE_PROTOCOL *Root,
+    ANIMATION_CONFIG *AnimConfig,
     GOP_STATE *GopState);
 
 static EFI_STATUS
 AbPlayFromLoose(
-    EFI_FILE_PROTOCOL *Root,
+    ANIMATION_CONFIG *AnimConfig,
     GOP_STATE *GopState);
 
+static VOID
+AbLoadConfigOrDefaults(
+    EFI_FILE_PROTOCOL *Root,
+    ANIMATION_CONFIG *Config);
+
+static VOID
+AbGetFileIdentity(
+    EFI_FILE_PROTOCOL *Root,
+    CONST CHAR16 *Path,
+    FILE_IDENTITY *Identity);
+
+static VOID
+AbGetImageIdentity(
+    EFI_FILE_PROTOCOL *Root,
+    CONST EFI_LOADED_IMAGE_PROTOCOL *LoadedImage,
+    FILE_IDENTITY *Identity);
+
+static UINT32
+AbCrc32(
+    CONST VOID *Data,
+    UINTN Size);
+
+static EFI_STATUS
+AbLoadBootPlan(ANIMATION_CONFIG *Config);
+
+static EFI_STATUS
+AbOpenPlanVolume(EFI_FILE_PROTOCOL **Root);
+
+static EFI_STATUS
+AbApplyBootPlan(
+    ANIM_PACKAGE_STATE *Package,
+    PLAYBACK_CONFIG *Config);
+
+static VOID
+AbSaveBootPlan(
+    EFI_HANDLE Volume,
+    CONST CHAR16 *FilePath,
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config,
+    BOOLEAN Trace);
+
+static VOID
+AbDeleteBootPlan(VOID);
+
 static EFI_STATUS
 AbRunPlayback(
     UINT32 FrameCount,
     PLAYBACK_CONFIG *Config,
     GOP_STATE *GopState,
     FRAME_LOADER Loader,
-    VOID *Context);
+    FRAME_DURATION_QUERY QueryDuration,
+    FRAME_REPEAT_QUERY QueryRepeat,
+    FRAME_REGION_QUERY QueryRegion,
+    VOID *Context,
+    UINTN MaxPayloadBytes);
+
+static EFI_STATUS
+AbRingInit(
+    FRAME_RING *Ring,
+    PLAYBACK_ARENA *Arena,
+    UINT32 Depth,
+    UINT32 Width,
+    UINT32 Height,
+    UINTN PayloadBytes);
+
+static VOID
+AbRingFree(FRAME_RING *Ring);
+
+static EFI_STATUS
+AbCacheInit(
+    FRAME_CACHE *Cache,
+    UINT32 FrameCount,
+    UINT32 Capacity);
+
+static VOID
+AbCacheFree(FRAME_CACHE *Cache);
+
+static VOID
+AbLogBlitTiming(
+    CONST CHAR8 *Path,
+    CONST BLIT_TIMING *Timing);
+
+static VOID
+AbLogBmpKernels(CONST FRAME_RING *Ring);
+
+static VOID
+AbLogLz4Decode(CONST FRAME_RING *Ring);
+
+static BOOLEAN
+AbCacheHas(
+    FRAME_CACHE *Cache,
+    UINT32 FrameIndex);
+
+static EFI_STATUS
+AbProduceFrame(
+    PLAYBACK_STATE *State,
+    BOOLEAN AllowDrop);
+
+static VOID
+AbNarrowSlotToRegion(
+    PLAYBACK_STATE *State,
+    FRAME_RING_SLOT *Slot,
+    UINT32 FrameIndex);
+
+static VOID
+AbComposeRegion(
+    FRAME_BUFFER *Canvas,
+    CONST FRAME_BUFFER *Region,
+    CONST FRAME_RECT *Rect);
+
+static EFI_STATUS
+AbFillRing(PLAYBACK_STATE *State);
+
+static EFI_STATUS
+AbDecodeSlot(VOID *Job);
+
+static EFI_STATUS
+AbStartSlotDecode(
+    FRAME_RING_SLOT *Slot,
+    BOOLEAN Wait);
+
+static VOID
+AbPumpReads(FRAME_RING *Ring);
+
+static EFI_STATUS
+AbCollectFrame(
+    FRAME_RING *Ring,
+    FRAME_RING_SLOT *Slot);
+
+static VOID
+AbCollectAll(FRAME_RING *Ring);
 
 static EFI_STATUS
 AbLoadPackageFromPath(
@@ -138,9 +498,65 @@ AbLoadPackageFromPath(
     CONST CHAR16 *Path,
     ANIM_PACKAGE_STATE *Package);
 
+static EFI_STATUS
+AbExtendHotPrefix(ANIM_PACKAGE_STATE *Package);
+
+static EFI_STATUS
+AbReadPackageBytes(
+    ANIM_PACKAGE_STATE *Package,
+    UINT64 Offset,
+    VOID *Buffer,
+    UINTN Length);
+
+static BOOLEAN
+AbPrefixHoldsFrame(
+    CONST ANIM_PACKAGE_STATE *Package,
+    UINT32 FrameIndex);
+
+static EFI_STATUS
+AbValidateFrameTable(ANIM_PACKAGE_STATE *Package);
+
+static EFI_STATUS
+AbShowHotFrame(
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config,
+    GOP_STATE *GopState);
+
+static EFI_STATUS
+AbPresentStill(
+    CONST PLAYBACK_CONFIG *Config,
+    CONST UINT8 *Payload,
+    UINTN PayloadSize,
+    UINT32 PixelFormat,
+    CONST CHAR8 *Source,
+    GOP_STATE *GopState);
+
+static VOID
+AbShowSplash(GOP_STATE *GopState);
+
+static VOID
+AbPaintBars(
+    GOP_STATE *GopState,
+    FRAME_SCALER *Scaler);
+
+static VOID
+AbNoteFirstPixel(CONST CHAR8 *Source);
+
+static EFI_STATUS
+AbLoadFrameRects(ANIM_PACKAGE_STATE *Package);
+
 static VOID
 AbClosePackage(ANIM_PACKAGE_STATE *Package);
 
+static BOOLEAN
+AbShouldPreloadPackage(
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config
+    );
+
+static EFI_STATUS
+AbPreloadPackage(ANIM_PACKAGE_STATE *Package);
+
 static EFI_STATUS
 AbLoadLooseManifest(
     EFI_FILE_PROTOCOL *Root,
@@ -150,35 +566,93 @@ AbLoadLooseManifest(
 static VOID
 AbFreeLooseManifest(LOOSE_MANIFEST_STATE *Manifest);
 
+static EFI_STATUS
+AbReadDirectoryEntry(
+    EFI_FILE_PROTOCOL *Directory,
+    EFI_FILE_INFO *Info);
+
+static EFI_STATUS
+AbAddLooseDirectory(
+    EFI_FILE_PROTOCOL *Root,
+    LOOSE_MANIFEST_STATE *Manifest,
+    CONST CHAR16 *Path,
+    UINTN Length,
+    UINT32 *Index);
+
+static UINT32
+AbHashLooseName(
+    UINT32 Directory,
+    CONST CHAR16 *Name);
+
+static EFI_STATUS
+AbIndexLooseFrames(
+    EFI_FILE_PROTOCOL *Root,
+    LOOSE_MANIFEST_STATE *Manifest);
+
+static BOOLEAN
+AbMatchFramePattern(
+    CONST CHAR16 *Name,
+    UINT32 *Number);
+
+static EFI_STATUS
+AbScanFramePattern(
+    EFI_FILE_PROTOCOL *Root,
+    CONST CHAR16 *ManifestPath,
+    LOOSE_MANIFEST_STATE *Manifest);
+
 static EFI_STATUS
 AbPackageFrameLoader(
     VOID *Context,
     UINT32 FrameIndex,
-    FRAME_BUFFER *Target,
-    UINT32 *DurationUs);
+    FRAME_PAYLOAD *Payload);
+
+static UINT32
+AbPackageFrameDuration(
+    VOID *Context,
+    UINT32 FrameIndex);
+
+static BOOLEAN
+AbPackageFrameRepeats(
+    VOID *Context,
+    UINT32 Shown,
+    UINT32 FrameIndex);
+
+static BOOLEAN
+AbPackageFrameRegion(
+    VOID *Context,
+    UINT32 FrameIndex,
+    FRAME_RECT *Rect);
 
 static EFI_STATUS
 AbLooseFrameLoader(
     VOID *Context,
     UINT32 FrameIndex,
-    FRAME_BUFFER *Target,
-    UINT32 *DurationUs);
+    FRAME_PAYLOAD *Payload);
 
-static EFI_STATUS
-AbDecodeFramePayload(
-    CONST UINT8 *Payload,
-    UINTN PayloadSize,
-    ANIM_PIXEL_FORMAT FormatHint,
-    FRAME_BUFFER *Target);
+static UINT32
+AbLooseFrameDuration(
+    VOID *Context,
+    UINT32 FrameIndex);
+
+static BOOLEAN
+AbLooseFrameRepeats(
+    VOID *Context,
+    UINT32 Shown,
+    UINT32 FrameIndex);
+
+static BOOLEAN
+AbPayloadFitsTarget(
+    CONST FRAME_BUFFER *Target,
+    UINTN PayloadSize);
 
 static EFI_STATUS
-AbDecodeBmpPayload(
+AbDecodeRawPayload(
     CONST UINT8 *Payload,
     UINTN PayloadSize,
     FRAME_BUFFER *Target);
 
 static EFI_STATUS
-AbDecodeRawPayload(
+AbDecodeLz4Payload(
     CONST UINT8 *Payload,
     UINTN PayloadSize,
     FRAME_BUFFER *Target);
@@ -200,45 +674,18 @@ AbInitPlaybackFromHeader(
 
 static VOID
 AbApplyManifestOverrides(
-    CHAR8 *Json,
+    CONST JSON_KEY_TABLE *Keys,
     PLAYBACK_CONFIG *Config);
 
-static CHAR8 *
-AbJsonFindKey(
-    CHAR8 *Json,
-    CONST CHAR8 *Key);
-
-static CHAR8 *
-AbSkipJsonNoise(CHAR8 *Ptr);
-
-static BOOLEAN
-AbJsonReadUint(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    UINT64 *Value);
-
-static BOOLEAN
-AbJsonReadBool(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    BOOLEAN *Value);
-
-static BOOLEAN
-AbJsonReadString(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    CHAR8 *Buffer,
-    UINTN BufferSize);
-
 static EFI_STATUS
 AbParseLooseFrames(
-    CHAR8 *Json,
+    CONST JSON_KEY_TABLE *Keys,
     CONST CHAR16 *ManifestPath,
     LOOSE_MANIFEST_STATE *Manifest);
 
 static EFI_STATUS
 AbParseFrameObject(
-    CHAR8 *ObjectJson,
+    CONST JSON_KEY_TABLE *Object,
     CONST CHAR16 *BaseDirectory,
     LOOSE_FRAME_DESC *Frame);
 
@@ -263,6 +710,14 @@ AbUserRequestedSkip(BOOLEAN AllowSkip);
 static VOID
 AbInitInputProtocols(VOID);
 
+static EFI_EVENT
+AbGetSkipEvent(BOOLEAN AllowSkip);
+
+static BOOLEAN
+AbWaitForFrame(
+    FRAME_SCHEDULER *Scheduler,
+    EFI_EVENT SkipEvent);
+
 static VOID
 AbFlushKeys(VOID);
 
@@ -284,16 +739,6 @@ static
 BOOLEAN
 AbIsBmpPayload(CONST UINT8 *Payload, UINTN Length);
 
-static
-VOID
-AbComputeDestPosition(
-    GOP_STATE *State,
-    UINT32 FrameWidth,
-    UINT32 FrameHeight,
-    CONST CHAR8 *Scaling,
-    UINT32 *DestX,
-    UINT32 *DestY);
-
 EFI_STATUS
 EFIAPI
 UefiMain(
@@ -304,32 +749,68 @@ UefiMain(
   EFI_LOADED_IMAGE_PROTOCOL *LoadedImage = NULL;
   GOP_STATE GopState;
   ANIMATION_CONFIG Config;
+  UINT64 TraceStart;
 
+  mStartUs = AbClockNowUs();
+  TraceStart = AbTraceBegin();
   Status = AbInitGopState(&GopState);
   if (EFI_ERROR(Status)) {
     return Status;
   }
+  AbTraceEnd("gop_init", TraceStart, AB_TRACE_NO_ARG);
 
+  TraceStart = AbTraceBegin();
+  AbShowSplash(&GopState);
+  AbTraceEnd("splash", TraceStart, AB_TRACE_NO_ARG);
+
+  TraceStart = AbTraceBegin();
   Status = AbOpenRoot(ImageHandle, &Root, &LoadedImage);
   if (EFI_ERROR(Status)) {
     AbRestoreGopState(&GopState);
     return Status;
   }
+  AbTraceEnd("open_root", TraceStart, AB_TRACE_NO_ARG);
 
-  // Load animation configuration
-  Status = AbLoadAnimationConfig(Root, &Config);
+  // A boot plan from an earlier boot stands in for config.json, partition
+  // discovery and package validation while nothing it was built from changed.
+  TraceStart = AbTraceBegin();
+  AbGetImageIdentity(Root, LoadedImage, &mImageIdentity);
+  AbGetFileIdentity(Root, AB_CONFIG_PATH, &mConfigIdentity);
+  Status = AbLoadBootPlan(&Config);
   if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_WARN, "Failed to load animation config: %r\n", Status));
-    // Fall back to default behavior
-    Config.AnimationPath = AbDuplicateString(DEFAULT_PACKAGE_PATH);
-    Config.ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
-    Config.UseCustomPartition = FALSE;
+    AbLoadConfigOrDefaults(Root, &Config);
+  }
+  AbTraceEnd("config_load", TraceStart, AB_TRACE_NO_ARG);
+
+  if (Config.Trace) {
+    Status = AbTraceStart(AB_TRACE_CAPACITY);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_WARN, "Trace disabled: %r\n", Status));
+    }
+  } else {
+    AbTraceStop();
   }
 
   EFI_STATUS PlaybackStatus = AbPlayFromPackage(&Config, &GopState);
+  if (PlaybackStatus == AB_STATUS_PLAN_STALE) {
+    // Something the plan was built from changed; redo the full startup.
+    DEBUG((DEBUG_INFO, "Boot plan not usable, rebuilding\n"));
+    AbDeleteBootPlan();
+    AbFreeAnimationConfig(&Config);
+    AbLoadConfigOrDefaults(Root, &Config);
+    PlaybackStatus = AbPlayFromPackage(&Config, &GopState);
+  }
   if (EFI_ERROR(PlaybackStatus)) {
     DEBUG((DEBUG_WARN, "Package playback failed: %r\n", PlaybackStatus));
 
+    // A plan only records the package. The fallbacks below need config.json's
+    // manifest path and partition settings; the plan itself still matches
+    // and is kept.
+    if (Config.UsePlan) {
+      AbFreeAnimationConfig(&Config);
+      AbLoadConfigOrDefaults(Root, &Config);
+    }
+
     // If using custom partition failed, try fallback to EFI partition
     if (Config.UseCustomPartition) {
       DEBUG((DEBUG_INFO, "Trying fallback to EFI partition\n"));
@@ -337,6 +818,9 @@ UefiMain(
       FallbackConfig.AnimationPath = AbDuplicateString(DEFAULT_PACKAGE_PATH);
       FallbackConfig.ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
       FallbackConfig.UseCustomPartition = FALSE;
+      FallbackConfig.UsePlan = FALSE;
+      FallbackConfig.SavePlan = FALSE;
+      FallbackConfig.Trace = Config.Trace;
 
       PlaybackStatus = AbPlayFromPackage(&FallbackConfig, &GopState);
       AbFreeAnimationConfig(&FallbackConfig);
@@ -348,6 +832,9 @@ UefiMain(
           FallbackConfig.AnimationPath = AbDuplicateString(DEFAULT_PACKAGE_PATH);
           FallbackConfig.ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
           FallbackConfig.UseCustomPartition = FALSE;
+          FallbackConfig.UsePlan = FALSE;
+          FallbackConfig.SavePlan = FALSE;
+          FallbackConfig.Trace = Config.Trace;
           PlaybackStatus = AbPlayFromLoose(&FallbackConfig, &GopState);
           AbFreeAnimationConfig(&FallbackConfig);
         }
@@ -362,10 +849,24 @@ UefiMain(
   }
 
   AbFreeAnimationConfig(&Config);
+  if (mBootPlan != NULL) {
+    FreePool(mBootPlan);
+    mBootPlan = NULL;
+  }
+  if (mVolumeIndex.Entries != NULL) {
+    FreePool(mVolumeIndex.Entries);
+  }
+  ZeroMem(&mVolumeIndex, sizeof(mVolumeIndex));
 
   if (Root != NULL) {
+    // Written before chainload; the next stage never returns here.
+    Status = AbTraceFlush(Root, AB_TRACE_PATH);
+    if (EFI_ERROR(Status) && Status != EFI_NOT_STARTED) {
+      DEBUG((DEBUG_WARN, "Failed to write trace: %r\n", Status));
+    }
     Root->Close(Root);
   }
+  AbTraceStop();
 
   AbRestoreGopState(&GopState);
 
@@ -419,30 +920,42 @@ AbPlayFromPackage(
   ANIM_PACKAGE_STATE Package;
   PLAYBACK_CONFIG Config;
   PACKAGE_PLAYBACK_CONTEXT Context;
+  JSON_KEY_TABLE ManifestKeys;
   EFI_FILE_PROTOCOL *Root = NULL;
+  EFI_HANDLE Volume = NULL;
   EFI_STATUS Status;
+  UINT64 TraceStart;
 
   if (AnimConfig == NULL || AnimConfig->AnimationPath == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
   // Open appropriate filesystem
-  if (AnimConfig->UseCustomPartition) {
-    Status = AbOpenRootFromPath(AnimConfig->AnimationPath, &Root);
+  if (AnimConfig->UsePlan) {
+    Status = AbOpenPlanVolume(&Root);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_INFO, "Boot plan: volume not found: %r\n", Status));
+      return AB_STATUS_PLAN_STALE;
+    }
+  } else if (AnimConfig->UseCustomPartition) {
+    TraceStart = AbTraceBegin();
+    Status = AbOpenRootFromPath(AnimConfig->AnimationPath, &Root, &Volume);
     if (EFI_ERROR(Status)) {
       DEBUG((DEBUG_WARN, "Failed to open custom partition for animation: %r\n", Status));
       return Status;
     }
+    AbTraceEnd("partition_discovery", TraceStart, AB_TRACE_NO_ARG);
   } else {
     EFI_LOADED_IMAGE_PROTOCOL *LoadedImage = NULL;
     Status = AbOpenRoot(gImageHandle, &Root, &LoadedImage);
     if (EFI_ERROR(Status)) {
       return Status;
     }
+    Volume = LoadedImage->DeviceHandle;
   }
 
   // Extract just the file path part for loading
-  CHAR16 PartitionSpec[32];
+  CHAR16 PartitionSpec[AB_PARTITION_SPEC_CHARS];
   CHAR16 FilePath[256];
   Status = AbParsePathSpec(AnimConfig->AnimationPath, PartitionSpec,
                           sizeof(PartitionSpec), FilePath, sizeof(FilePath));
@@ -452,19 +965,98 @@ AbPlayFromPackage(
   }
 
   ZeroMem(&Package, sizeof(Package));
+  TraceStart = AbTraceBegin();
   Status = AbLoadPackageFromPath(Root, FilePath, &Package);
   if (EFI_ERROR(Status)) {
+    Root->Close(Root);
+    if (AnimConfig->UsePlan) {
+      DEBUG((DEBUG_INFO, "Boot plan: package not opened: %r\n", Status));
+      return AB_STATUS_PLAN_STALE;
+    }
+    return Status;
+  }
+  AbTraceEnd("package_open", TraceStart, AB_TRACE_NO_ARG);
+
+  if (AnimConfig->UsePlan) {
+    Status = AbApplyBootPlan(&Package, &Config);
+    if (EFI_ERROR(Status)) {
+      AbClosePackage(&Package);
+      Root->Close(Root);
+      return AB_STATUS_PLAN_STALE;
+    }
+  } else {
+    AbInitPlaybackFromHeader(&Package.Header, &Config);
+    if (Package.ManifestJson != NULL && Package.ManifestSize > 0) {
+      Status = AbJsonTokenize(Package.ManifestJson, Package.ManifestSize, &ManifestKeys, NULL);
+      if (EFI_ERROR(Status)) {
+        DEBUG((DEBUG_WARN, "Package manifest ignored: %r\n", Status));
+      } else {
+        AbApplyManifestOverrides(&ManifestKeys, &Config);
+      }
+    }
+    // A partial frame only makes sense on top of the one before it.
+    if (Package.RectTable != NULL && Config.AllowFrameDrop) {
+      DEBUG((DEBUG_INFO, "Package has partial frames, frame dropping disabled\n"));
+      Config.AllowFrameDrop = FALSE;
+    }
+  }
+
+  // Frame 0 already in memory goes up before the rest of the package is
+  // checked or preloaded.
+  if (AbPrefixHoldsFrame(&Package, 0)) {
+    TraceStart = AbTraceBegin();
+    Status = AbShowHotFrame(&Package, &Config, GopState);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_INFO, "Frame 0 not shown early: %r\n", Status));
+    }
+    AbTraceEnd("hot_frame", TraceStart, AB_TRACE_NO_ARG);
+  }
+  // Always checked: the table lives on a volume the OS can write, and a
+  // plan only records that nothing changed, not that the bytes are sane.
+  Status = AbValidateFrameTable(&Package);
+  if (EFI_ERROR(Status)) {
+    AbClosePackage(&Package);
     Root->Close(Root);
     return Status;
   }
+  if (AnimConfig->UsePlan) {
+    DEBUG((DEBUG_INFO, "Boot plan: playback set up %lu us after start, %lu us on the boot that built the plan\n",
+           AbClockNowUs() - mStartUs, mBootPlan->SetupUs));
+  } else if (AnimConfig->SavePlan && Volume != NULL) {
+    AbSaveBootPlan(Volume, FilePath, &Package, &Config, AnimConfig->Trace);
+  }
+  // The prefix stays resident for the frames inside it.
+  Config.MaxMemoryBytes -= MIN(Config.MaxMemoryBytes, Package.PrefixSize);
 
-  AbInitPlaybackFromHeader(&Package.Header, &Config);
-  if (Package.ManifestJson != NULL && Package.ManifestSize > 0) {
-    AbApplyManifestOverrides(Package.ManifestJson, &Config);
+  // Small packages are read whole up front; the image is charged against
+  // max_memory and frames then decode straight out of it.
+  if (AbShouldPreloadPackage(&Package, &Config)) {
+    TraceStart = AbTraceBegin();
+    Status = AbPreloadPackage(&Package);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_WARN, "Package preload failed (%r), streaming frames\n", Status));
+    } else {
+      Config.MaxMemoryBytes -= EFI_PAGES_TO_SIZE(Package.PreloadPages);
+    }
+    AbTraceEnd("preload", TraceStart, AB_TRACE_NO_ARG);
   }
 
   Context.Package = &Package;
-  Status = AbRunPlayback(Package.Header.FrameCount, &Config, GopState, AbPackageFrameLoader, &Context);
+  Context.Root = Root;
+  Context.Path = FilePath;
+  // Raw frames are read straight into frame buffers and preloaded frames are
+  // decoded where they lie; neither needs scratch.
+  Status = AbRunPlayback(
+      Package.Header.FrameCount,
+      &Config,
+      GopState,
+      AbPackageFrameLoader,
+      AbPackageFrameDuration,
+      AbPackageFrameRepeats,
+      (Package.RectTable != NULL) ? AbPackageFrameRegion : NULL,
+      &Context,
+      (Package.Header.PixelFormat == AnimPixelFormatBgra32 || Package.Preload != NULL) ?
+          0 : Package.MaxFrameLength);
   AbClosePackage(&Package);
   Root->Close(Root);
   return Status;
@@ -478,6 +1070,7 @@ AbPlayFromLoose(
   LOOSE_PLAYBACK_CONTEXT Context;
   EFI_FILE_PROTOCOL *Root = NULL;
   EFI_STATUS Status;
+  UINT64 TraceStart;
 
   if (AnimConfig == NULL || AnimConfig->ManifestPath == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -485,11 +1078,13 @@ AbPlayFromLoose(
 
   // Open appropriate filesystem
   if (AnimConfig->UseCustomPartition) {
-    Status = AbOpenRootFromPath(AnimConfig->ManifestPath, &Root);
+    TraceStart = AbTraceBegin();
+    Status = AbOpenRootFromPath(AnimConfig->ManifestPath, &Root, NULL);
     if (EFI_ERROR(Status)) {
       DEBUG((DEBUG_WARN, "Failed to open custom partition for manifest: %r\n", Status));
       return Status;
     }
+    AbTraceEnd("partition_discovery", TraceStart, AB_TRACE_NO_ARG);
   } else {
     EFI_LOADED_IMAGE_PROTOCOL *LoadedImage = NULL;
     Status = AbOpenRoot(gImageHandle, &Root, &LoadedImage);
@@ -499,7 +1094,7 @@ AbPlayFromLoose(
   }
 
   // Extract just the file path part for loading
-  CHAR16 PartitionSpec[32];
+  CHAR16 PartitionSpec[AB_PARTITION_SPEC_CHARS];
   CHAR16 FilePath[256];
   Status = AbParsePathSpec(AnimConfig->ManifestPath, PartitionSpec,
                           sizeof(PartitionSpec), FilePath, sizeof(FilePath));
@@ -509,20 +1104,26 @@ AbPlayFromLoose(
   }
 
   ZeroMem(&Manifest, sizeof(Manifest));
+  TraceStart = AbTraceBegin();
   Status = AbLoadLooseManifest(Root, FilePath, &Manifest);
   if (EFI_ERROR(Status)) {
     Root->Close(Root);
     return Status;
   }
+  AbTraceEnd("manifest_load", TraceStart, AB_TRACE_NO_ARG);
 
   Context.Manifest = &Manifest;
-  Context.Root = Root;
   Status = AbRunPlayback(
       Manifest.FrameCount,
       &Manifest.Config,
       GopState,
       AbLooseFrameLoader,
-      &Context);
+      AbLooseFrameDuration,
+      AbLooseFrameRepeats,
+      NULL,
+      &Context,
+      (UINTN)Manifest.Config.LogicalWidth * Manifest.Config.LogicalHeight *
+          sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL) + AB_LOOSE_PAYLOAD_SLACK);
   AbFreeLooseManifest(&Manifest);
   Root->Close(Root);
   return Status;
@@ -534,18 +1135,36 @@ AbRunPlayback(
     PLAYBACK_CONFIG *Config,
     GOP_STATE *GopState,
     FRAME_LOADER Loader,
-    VOID *Context) {
+    FRAME_DURATION_QUERY QueryDuration,
+    FRAME_REPEAT_QUERY QueryRepeat,
+    FRAME_REGION_QUERY QueryRegion,
+    VOID *Context,
+    UINTN MaxPayloadBytes) {
   EFI_STATUS Status;
-  FRAME_BUFFER *Front = NULL;
-  FRAME_BUFFER *Back = NULL;
+  PLAYBACK_STATE State;
+  FRAME_RING *Ring;
+  FRAME_SCHEDULER *Scheduler;
   UINT64 FrameBytes;
+  UINT64 SlotBytes;
+  UINT64 CanvasBytes;
+  UINT64 ShadowBytes;
+  UINT64 BudgetBytes;
   UINT64 TotalBudgetUs;
-  UINT64 AccumulatedUs;
-  UINT32 LoopIndex;
+  UINT64 Occupancy;
+  UINT64 BudgetSlots;
+  UINT32 Depth;
+  UINT32 CacheCapacity;
   UINT32 DestX;
   UINT32 DestY;
-
-  if (FrameCount == 0 || Config == NULL || GopState == NULL || Loader == NULL) {
+  EFI_EVENT SkipEvent;
+  FRAME_SCALER Scaler;
+  FRAME_BUFFER *Presented;
+  UINT64 TraceStart;
+  DECODE_POOL_STATS DecodeStats;
+  ASYNC_READ_STATS ReadStats;
+
+  if (FrameCount == 0 || Config == NULL || GopState == NULL ||
+      Loader == NULL || QueryDuration == NULL || QueryRepeat == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -567,85 +1186,801 @@ AbRunPlayback(
     Config->FrameDurationUs = AB_DEFAULT_FRAME_DURATION;
   }
 
-  FrameBytes = (UINT64)Config->LogicalWidth *
-      (UINT64)Config->LogicalHeight *
-      sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-  if (FrameBytes == 0) {
-    return EFI_BAD_BUFFER_SIZE;
+  // The mode and scaler come first: what is presented, and so what the
+  // dirty tracker shadows, depends on them.
+  if (Config->SelectMode) {
+    TraceStart = AbTraceBegin();
+    Status = AbSelectGopMode(GopState, Config->LogicalWidth, Config->LogicalHeight);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_WARN, "GOP mode selection failed: %r\n", Status));
+    }
+    AbTraceEnd("mode_select", TraceStart, AB_TRACE_NO_ARG);
+  }
+
+  TraceStart = AbTraceBegin();
+  Status = AbScalerInit(
+      &Scaler,
+      GopState->Gop->Mode->Information->HorizontalResolution,
+      GopState->Gop->Mode->Information->VerticalResolution,
+      Config->LogicalWidth,
+      Config->LogicalHeight,
+      AbScaleModeFromName(Config->Scaling),
+      AbScaleFilterFromName(Config->ScaleFilter));
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  AbTraceEnd("scaler_init", TraceStart, AB_TRACE_NO_ARG);
+  DestX = Scaler.Output.X;
+  DestY = Scaler.Output.Y;
+
+  // Every ring slot holds a decoded frame plus the encoded bytes it came
+  // from; cached frames are decoded only. All of it comes out of one arena
+  // charged against max_memory_bytes.
+  FrameBytes = AbArenaFrameFootprint(Config->LogicalWidth, Config->LogicalHeight);
+  SlotBytes = FrameBytes + AB_ARENA_FOOTPRINT(MaxPayloadBytes);
+  // Partial frames are composed onto a screen image kept for the whole run.
+  CanvasBytes = (QueryRegion != NULL) ? FrameBytes : 0;
+  // Everything but unscaled partial frames goes through the dirty tracker,
+  // whose shadow lives outside the arena but is charged all the same.
+  ShadowBytes = 0;
+  if (QueryRegion == NULL || Scaler.Active) {
+    ShadowBytes = Scaler.Active ? AbDirtyTrackerFootprint(Scaler.View.Width, Scaler.View.Height)
+                                : AbDirtyTrackerFootprint(Config->LogicalWidth, Config->LogicalHeight);
+  }
+  if (Config->MaxMemoryBytes < CanvasBytes + ShadowBytes) {
+    AbScalerFree(&Scaler);
+    return EFI_OUT_OF_RESOURCES;
   }
+  BudgetBytes = Config->MaxMemoryBytes - CanvasBytes - ShadowBytes;
 
-  if ((FrameBytes * 2) > Config->MaxMemoryBytes) {
+  // The ring replaces the old front/back pair, so it needs at least two slots.
+  BudgetSlots = DivU64x64Remainder(BudgetBytes, SlotBytes, NULL);
+  if (BudgetSlots < AB_MIN_RING_DEPTH) {
+    AbScalerFree(&Scaler);
     return EFI_OUT_OF_RESOURCES;
   }
+  Depth = (UINT32)MIN(BudgetSlots, AB_MAX_RING_DEPTH);
+
+  // Only worth caching when frames are shown more than once. If the whole
+  // animation fits, later loops are pure blits and a minimal ring suffices;
+  // otherwise whatever the ring leaves over holds the head of the sequence.
+  CacheCapacity = 0;
+  if (Config->CacheFrames && Config->LoopCount != 1) {
+    if (MultU64x32(FrameBytes, FrameCount) + AB_MIN_RING_DEPTH * SlotBytes <= BudgetBytes) {
+      Depth = AB_MIN_RING_DEPTH;
+      CacheCapacity = FrameCount;
+    } else {
+      CacheCapacity = (UINT32)DivU64x64Remainder(
+          BudgetBytes - Depth * SlotBytes, FrameBytes, NULL);
+    }
+  }
+
+  ZeroMem(&State, sizeof(State));
+  State.Config = Config;
+  State.Loader = Loader;
+  State.QueryDuration = QueryDuration;
+  State.QueryRepeat = QueryRepeat;
+  State.QueryRegion = QueryRegion;
+  State.OnScreen = MAX_UINT32;
+  State.Context = Context;
+  State.FrameCount = FrameCount;
+  Ring = &State.Ring;
+  Scheduler = &State.Scheduler;
 
-  Status = AbAllocateFrameBuffer(Config->LogicalWidth, Config->LogicalHeight, &Front);
+  Status = AbArenaInit(&State.Arena, Depth * SlotBytes + MultU64x32(FrameBytes, CacheCapacity) + CanvasBytes);
+  if (EFI_ERROR(Status)) {
+    AbScalerFree(&Scaler);
+    return Status;
+  }
+  if (QueryRegion != NULL) {
+    Status = AbArenaAllocFrame(&State.Arena, Config->LogicalWidth, Config->LogicalHeight, &State.Canvas);
+    if (EFI_ERROR(Status)) {
+      AbArenaFree(&State.Arena);
+      AbScalerFree(&Scaler);
+      return Status;
+    }
+  }
+  Status = AbRingInit(Ring, &State.Arena, Depth, Config->LogicalWidth, Config->LogicalHeight,
+                      MaxPayloadBytes);
   if (EFI_ERROR(Status)) {
+    AbArenaFree(&State.Arena);
+    AbScalerFree(&Scaler);
     return Status;
   }
-  Status = AbAllocateFrameBuffer(Config->LogicalWidth, Config->LogicalHeight, &Back);
+  Status = AbCacheInit(&State.Cache, FrameCount, CacheCapacity);
   if (EFI_ERROR(Status)) {
-    AbFreeFrameBuffer(&Front);
+    AbRingFree(Ring);
+    AbArenaFree(&State.Arena);
+    AbScalerFree(&Scaler);
     return Status;
   }
 
-  AbComputeDestPosition(
-      GopState,
-      Config->LogicalWidth,
-      Config->LogicalHeight,
-      Config->Scaling,
-      &DestX,
-      &DestY);
+  if (Config->DirectFramebuffer) {
+    Status = AbEnableDirectWrite(GopState);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_INFO, "Direct framebuffer unavailable (%r), using Blt\n", Status));
+    }
+  }
+
+  AbAsyncReadReset(Config->AsyncIo);
+  AbBmpDecodeInit();
+
+  // No more than one AP per ring slot can have work at a time.
+  Status = AbDecodePoolStart(MIN(Config->DecodeWorkers, Depth));
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_INFO, "Decoding on the BSP only (%r)\n", Status));
+  }
+
+  if (Scaler.Active) {
+    // Paint the bars once; afterwards only the output window is presented.
+    AbPaintBars(GopState, &Scaler);
+  }
 
   AbFlushKeys();
-  AccumulatedUs = 0;
+  SkipEvent = AbGetSkipEvent(Config->AllowKeySkip);
   TotalBudgetUs = (UINT64)Config->MaxTotalDurationMs * 1000ULL;
+  AbSchedulerInit(Scheduler, Config->TargetFps, Config->FrameDurationUs, Config->AllowFrameDrop);
+
+  for (;;) {
+    FRAME_RING_SLOT *Slot;
+
+    if (TotalBudgetUs > 0 && AbSchedulerBudgetExhausted(Scheduler, TotalBudgetUs)) {
+      // The budget is a hard cap; the frame on screen is not held out.
+      Status = EFI_SUCCESS;
+      goto Cleanup;
+    }
 
-  for (LoopIndex = 0;
-       (Config->LoopCount == 0) || (LoopIndex < Config->LoopCount);
-       ++LoopIndex) {
-    UINT32 FrameIndex;
-    for (FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex) {
-      UINT32 DurationUs = Config->FrameDurationUs;
-      Status = Loader(Context, FrameIndex, Back, &DurationUs);
+    if (Ring->Count == 0) {
+      if (State.Exhausted) {
+        break;
+      }
+      if (Scheduler->Started) {
+        Ring->Underruns++;
+      }
+      Status = AbProduceFrame(&State, TRUE);
+      if (Status == EFI_END_OF_FILE) {
+        break;
+      }
       if (EFI_ERROR(Status)) {
         goto Cleanup;
       }
+    }
 
-      Status = AbBlitFrame(GopState, Back, DestX, DestY);
+    Slot = &Ring->Slots[Ring->Head];
+    if (!Slot->Final && AbSchedulerShouldDrop(Scheduler, Slot->DurationUs)) {
+      AbTraceInstant("drop", Slot->FrameIndex);
+      AbSchedulerDropFrame(Scheduler, Slot->DurationUs);
+      // An AP may still be writing into the slot.
+      Status = AbCollectFrame(Ring, Slot);
       if (EFI_ERROR(Status)) {
         goto Cleanup;
       }
+      Ring->Head = (Ring->Head + 1) % Ring->Depth;
+      Ring->Count--;
+      continue;
+    }
 
-      if (DurationUs < AB_MIN_FRAME_DURATION_US) {
-        DurationUs = AB_MIN_FRAME_DURATION_US;
-      }
+    Status = AbCollectFrame(Ring, Slot);
+    if (EFI_ERROR(Status)) {
+      goto Cleanup;
+    }
 
-      if (AbUserRequestedSkip(Config->AllowKeySkip)) {
-        Status = EFI_ABORTED;
-        goto Cleanup;
-      }
+    Presented = Slot->Frame;
+    if (State.Canvas != NULL && !Slot->Hold) {
+      AbComposeRegion(State.Canvas, Slot->Frame, &Slot->Rect);
+      Presented = State.Canvas;
+    }
+    if (Scaler.Active && !Slot->Hold) {
+      TraceStart = AbTraceBegin();
+      AbScaleFrame(&Scaler, Presented);
+      Presented = &Scaler.View;
+      AbTraceEnd("scale", TraceStart, Slot->FrameIndex);
+    }
 
-      AbSwapBuffers(&Front, &Back);
-      gBS->Stall(DurationUs);
+    // Spend the time until this frame is due decoding the ones after it.
+    TraceStart = AbTraceBegin();
+    Status = AbFillRing(&State);
+    if (EFI_ERROR(Status)) {
+      goto Cleanup;
+    }
+    AbTraceEnd("fill_ring", TraceStart, Slot->FrameIndex);
 
-      AccumulatedUs += DurationUs;
-      if (TotalBudgetUs > 0 && AccumulatedUs >= TotalBudgetUs) {
-        Status = EFI_SUCCESS;
+    TraceStart = AbTraceBegin();
+    if (AbWaitForFrame(Scheduler, SkipEvent)) {
+      Status = EFI_ABORTED;
+      goto Cleanup;
+    }
+    AbTraceEnd("wait", TraceStart, Slot->FrameIndex);
+    if (!Slot->Hold) {
+      TraceStart = AbTraceBegin();
+      // Unscaled, the frame's rectangle is exactly what changed on screen.
+      if (State.Canvas != NULL && !Scaler.Active) {
+        Status = AbBlitFrameRect(GopState, Presented, &Slot->Rect, DestX, DestY);
+      } else {
+        Status = AbBlitFrameDirty(GopState, Presented, DestX, DestY);
+      }
+      if (EFI_ERROR(Status)) {
         goto Cleanup;
       }
+      AbTraceEnd("blit", TraceStart, Slot->FrameIndex);
+      AbNoteFirstPixel("playback");
+    }
+    AbSchedulerFramePresented(Scheduler, Slot->DurationUs);
+    State.OnScreen = Slot->FrameIndex;
+
+    Ring->OccupancySum += Ring->Count;
+    Ring->OccupancySamples++;
+    if (Ring->OccupancySamples == 1 || Ring->Count < Ring->MinOccupancy) {
+      Ring->MinOccupancy = Ring->Count;
     }
+    Ring->Head = (Ring->Head + 1) % Ring->Depth;
+    Ring->Count--;
+  }
+
+  // Hold the last frame for its full duration.
+  if (AbWaitForFrame(Scheduler, SkipEvent)) {
+    Status = EFI_ABORTED;
+    goto Cleanup;
   }
   Status = EFI_SUCCESS;
 
 Cleanup:
-  AbFreeFrameBuffer(&Front);
-  AbFreeFrameBuffer(&Back);
+  // Nothing may still be decoding into ring or cache buffers past here.
+  AbCollectAll(Ring);
+  AbDecodePoolGetStats(&DecodeStats);
+  AbDecodePoolStop();
+  AbAsyncReadGetStats(&ReadStats);
+
+  DEBUG((DEBUG_INFO,
+         "Playback: %u presented, %u late, %u dropped, %u resyncs, max lateness %lu us, %lu ms elapsed, %lu ms halted\n",
+         Scheduler->FramesPresented,
+         Scheduler->FramesLate,
+         Scheduler->FramesDropped,
+         Scheduler->Resyncs,
+         Scheduler->MaxLatenessUs,
+         DivU64x32(AbSchedulerElapsedUs(Scheduler), 1000),
+         DivU64x32(Scheduler->HaltedUs, 1000)));
+  Occupancy = (Ring->OccupancySamples > 0) ?
+      DivU64x32(Ring->OccupancySum * 100, Ring->OccupancySamples) : 0;
+  DEBUG((DEBUG_INFO,
+         "Ring: depth %u, avg occupancy %lu.%02lu, min %u, %u underruns, load ~%lu us\n",
+         Ring->Depth,
+         DivU64x32(Occupancy, 100),
+         Occupancy % 100,
+         Ring->MinOccupancy,
+         Ring->Underruns,
+         State.LoadCostUs));
+  if (Ring->Repeats > 0) {
+    DEBUG((DEBUG_INFO, "Repeats: %u frames shown by holding the previous image\n", Ring->Repeats));
+  }
+  DEBUG((DEBUG_INFO,
+         "Decode: %u APs, %u frames on APs, %u on BSP, %lu us waiting on decodes\n",
+         DecodeStats.Workers,
+         DecodeStats.DecodedOnAps,
+         DecodeStats.DecodedOnBsp,
+         Ring->DecodeWaitUs));
+  AbLogBmpKernels(Ring);
+  AbLogLz4Decode(Ring);
+  DEBUG((DEBUG_INFO,
+         "Read: %u reads (%u async), %lu KiB at %lu KiB/s, %lu%% overlapped\n",
+         ReadStats.Reads,
+         ReadStats.AsyncReads,
+         DivU64x32(ReadStats.Bytes, 1024),
+         (ReadStats.InFlightUs > 0) ?
+             DivU64x64Remainder(MultU64x32(ReadStats.Bytes, 1000000U) / 1024, ReadStats.InFlightUs, NULL) : 0,
+         (ReadStats.ReadUs > ReadStats.BlockedUs) ?
+             DivU64x64Remainder(MultU64x32(ReadStats.ReadUs - ReadStats.BlockedUs, 100), ReadStats.ReadUs, NULL) : 0));
+  if (State.Cache.Capacity > 0) {
+    DEBUG((DEBUG_INFO,
+           "Cache: %u/%u frames resident (%lu bytes), %u hits, %u misses, %u%% hit rate\n",
+           State.Cache.Resident,
+           State.Cache.FrameCount,
+           State.Cache.ResidentBytes,
+           State.Cache.Hits,
+           State.Cache.Misses,
+           (State.Cache.Hits + State.Cache.Misses > 0) ?
+               (UINT32)DivU64x32((UINT64)State.Cache.Hits * 100, State.Cache.Hits + State.Cache.Misses) : 0));
+  }
+  DEBUG((DEBUG_INFO,
+         "Arena: %lu KiB reserved, %lu KiB high-water, %lu KiB payload scratch per slot\n",
+         DivU64x32(State.Arena.Size, 1024),
+         DivU64x32(State.Arena.Used, 1024),
+         DivU64x32(AB_ARENA_FOOTPRINT(MaxPayloadBytes), 1024)));
+  DEBUG((DEBUG_INFO,
+         "Blit: %u full, %u partial, %u unchanged, %u rects, %lu of %lu pixels sent\n",
+         GopState->Dirty.FullBlits,
+         GopState->Dirty.PartialBlits,
+         GopState->Dirty.SkippedBlits,
+         GopState->Dirty.RectsSent,
+         GopState->Dirty.PixelsSent,
+         GopState->Dirty.PixelsPresented));
+  AbLogBlitTiming("Blt", &GopState->GopTiming);
+  AbLogBlitTiming("direct", &GopState->DirectTiming);
+  AbDisableDirectWrite(GopState);
+  AbResetDirtyTracking(GopState);
+  AbSchedulerFree(Scheduler);
+  AbScalerFree(&Scaler);
+  AbCacheFree(&State.Cache);
+  AbRingFree(Ring);
+  AbArenaFree(&State.Arena);
   if (Status == EFI_ABORTED) {
     return EFI_SUCCESS;
   }
   return Status;
 }
 
+static VOID
+AbLogBlitTiming(
+    CONST CHAR8 *Path,
+    CONST BLIT_TIMING *Timing) {
+  if (Timing->Frames == 0) {
+    return;
+  }
+  DEBUG((DEBUG_INFO, "Blit time (%a): %u frames, avg %lu us, max %lu us\n",
+         Path,
+         Timing->Frames,
+         DivU64x32(Timing->TotalUs, Timing->Frames),
+         Timing->MaxUs));
+}
+
+static VOID
+AbLogBmpKernels(CONST FRAME_RING *Ring) {
+  CONST BMP_KERNEL_STATS *Kernel;
+  UINT64 Us;
+  UINT32 Index;
+
+  for (Index = 0; Index < AbBmpKernelCount; ++Index) {
+    Kernel = &Ring->Kernels[Index];
+    if (Kernel->Frames == 0) {
+      continue;
+    }
+    // Bytes per microsecond is MB/s.
+    Us = AbClockCyclesToUs(Kernel->Cycles);
+    DEBUG((DEBUG_INFO, "BMP decode (%a): %u frames, %lu KiB, %lu MB/s\n",
+           AbBmpKernelName((AB_BMP_KERNEL)Index),
+           Kernel->Frames,
+           DivU64x32(Kernel->Bytes, 1024),
+           (Us > 0) ? DivU64x64Remainder(Kernel->Bytes, Us, NULL) : 0));
+  }
+}
+
+static VOID
+AbLogLz4Decode(CONST FRAME_RING *Ring) {
+  UINT64 Us;
+  UINT64 Ratio;
+
+  if (Ring->Lz4.Frames == 0 || Ring->Lz4.InputBytes == 0) {
+    return;
+  }
+  Us = AbClockCyclesToUs(Ring->Lz4.Cycles);
+  Ratio = DivU64x64Remainder(MultU64x32(Ring->Lz4.OutputBytes, 100), Ring->Lz4.InputBytes, NULL);
+  DEBUG((DEBUG_INFO, "LZ4 decode: %u frames, %lu KiB to %lu KiB (%lu.%02lux), %lu MB/s\n",
+         Ring->Lz4.Frames,
+         DivU64x32(Ring->Lz4.InputBytes, 1024),
+         DivU64x32(Ring->Lz4.OutputBytes, 1024),
+         DivU64x32(Ratio, 100),
+         Ratio % 100,
+         (Us > 0) ? DivU64x64Remainder(Ring->Lz4.OutputBytes, Us, NULL) : 0));
+}
+
+static EFI_STATUS
+AbRingInit(
+    FRAME_RING *Ring,
+    PLAYBACK_ARENA *Arena,
+    UINT32 Depth,
+    UINT32 Width,
+    UINT32 Height,
+    UINTN PayloadBytes) {
+  EFI_STATUS Status;
+  FRAME_RING_SLOT *Slot;
+  UINT32 Index;
+
+  if (Ring == NULL || Depth == 0 || Depth > AB_MAX_RING_DEPTH) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Ring, sizeof(*Ring));
+  Ring->Depth = Depth;
+  for (Index = 0; Index < Depth; ++Index) {
+    Slot = &Ring->Slots[Index];
+    Status = AbArenaAllocFrame(Arena, Width, Height, &Slot->Buffer);
+    if (EFI_ERROR(Status)) {
+      AbRingFree(Ring);
+      return Status;
+    }
+    if (PayloadBytes == 0) {
+      continue;
+    }
+    Slot->Payload.Data = AbArenaAlloc(Arena, PayloadBytes);
+    if (Slot->Payload.Data == NULL) {
+      AbRingFree(Ring);
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Slot->Payload.Capacity = PayloadBytes;
+  }
+  return EFI_SUCCESS;
+}
+
+static VOID
+AbRingFree(FRAME_RING *Ring) {
+  UINT32 Index;
+
+  if (Ring == NULL) {
+    return;
+  }
+  // Buffers and payload bytes go back with the arena.
+  for (Index = 0; Index < AB_MAX_RING_DEPTH; ++Index) {
+    Ring->Slots[Index].Buffer = NULL;
+    Ring->Slots[Index].Frame = NULL;
+    AbAsyncReadFree(&Ring->Slots[Index].Payload.Read);
+    if (Ring->Slots[Index].Payload.Handle != NULL) {
+      Ring->Slots[Index].Payload.Handle->Close(Ring->Slots[Index].Payload.Handle);
+    }
+    ZeroMem(&Ring->Slots[Index].Payload, sizeof(FRAME_PAYLOAD));
+  }
+  Ring->Depth = 0;
+  Ring->Count = 0;
+}
+
+static EFI_STATUS
+AbCacheInit(
+    FRAME_CACHE *Cache,
+    UINT32 FrameCount,
+    UINT32 Capacity) {
+  if (Cache == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  ZeroMem(Cache, sizeof(*Cache));
+  if (Capacity == 0) {
+    return EFI_SUCCESS;
+  }
+  Cache->Frames = AllocateZeroPool(sizeof(FRAME_BUFFER *) * FrameCount);
+  if (Cache->Frames == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Cache->FrameCount = FrameCount;
+  Cache->Capacity = MIN(Capacity, FrameCount);
+  return EFI_SUCCESS;
+}
+
+// Cached frames live in the playback arena; only the index is freed here.
+static VOID
+AbCacheFree(FRAME_CACHE *Cache) {
+  if (Cache == NULL || Cache->Frames == NULL) {
+    return;
+  }
+  FreePool(Cache->Frames);
+  ZeroMem(Cache, sizeof(*Cache));
+}
+
+static BOOLEAN
+AbCacheHas(
+    FRAME_CACHE *Cache,
+    UINT32 FrameIndex) {
+  return Cache->Frames != NULL && FrameIndex < Cache->FrameCount &&
+      Cache->Frames[FrameIndex] != NULL;
+}
+
+// Decodes the frame at the producer cursor into the ring tail. Returns
+// EFI_END_OF_FILE once every loop has been produced.
+static EFI_STATUS
+AbProduceFrame(
+    PLAYBACK_STATE *State,
+    BOOLEAN AllowDrop) {
+  PLAYBACK_CONFIG *Config = State->Config;
+  FRAME_RING *Ring = &State->Ring;
+  FRAME_CACHE *Cache = &State->Cache;
+  FRAME_RING_SLOT *Slot;
+  EFI_STATUS Status;
+  UINT32 FrameIndex;
+  UINT32 DurationUs;
+  BOOLEAN Final;
+  BOOLEAN Cached;
+  UINT64 LoadStart;
+  UINT64 LoadCost;
+  UINT64 TraceStart;
+
+  if (Ring->Count >= Ring->Depth) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  while (!State->Exhausted) {
+    FrameIndex = State->NextFrame;
+    Final = (Config->LoopCount != 0) &&
+        (State->NextLoop + 1 == Config->LoopCount) &&
+        (FrameIndex + 1 == State->FrameCount);
+
+    DurationUs = AbSchedulerResolveDuration(
+        &State->Scheduler,
+        State->QueryDuration(State->Context, FrameIndex));
+    if (DurationUs < AB_MIN_FRAME_DURATION_US) {
+      DurationUs = AB_MIN_FRAME_DURATION_US;
+    }
+
+    if (++State->NextFrame == State->FrameCount) {
+      State->NextFrame = 0;
+      State->NextLoop++;
+      State->Exhausted = Final;
+    }
+
+    // Only the frame about to be shown can be judged late; skip its I/O.
+    if (AllowDrop && !Final && AbSchedulerShouldDrop(&State->Scheduler, DurationUs)) {
+      AbTraceInstant("drop", FrameIndex);
+      AbSchedulerDropFrame(&State->Scheduler, DurationUs);
+      continue;
+    }
+
+    // A repeat of the newest queued frame just stays up longer; with nothing
+    // queued, a repeat of the image on screen becomes a hold slot.
+    if (Ring->Count > 0) {
+      Slot = &Ring->Slots[(Ring->Head + Ring->Count - 1) % Ring->Depth];
+      if (Slot->DurationUs + DurationUs <= AB_MAX_HOLD_US &&
+          State->QueryRepeat(State->Context, Slot->FrameIndex, FrameIndex)) {
+        AbTraceInstant("repeat", FrameIndex);
+        Slot->DurationUs += DurationUs;
+        Slot->Final = Final;
+        Ring->Repeats++;
+        return EFI_SUCCESS;
+      }
+    }
+
+    TraceStart = AbTraceBegin();
+    Slot = &Ring->Slots[(Ring->Head + Ring->Count) % Ring->Depth];
+    Slot->Hold = Ring->Count == 0 && State->OnScreen != MAX_UINT32 &&
+        State->QueryRepeat(State->Context, State->OnScreen, FrameIndex);
+    if (Slot->Hold) {
+      AbTraceInstant("repeat", FrameIndex);
+      Slot->Frame = NULL;
+      Ring->Repeats++;
+    } else if (AbCacheHas(Cache, FrameIndex)) {
+      Cache->Hits++;
+      Slot->Frame = Cache->Frames[FrameIndex];
+      AbNarrowSlotToRegion(State, Slot, FrameIndex);
+    } else {
+      Slot->Frame = Slot->Buffer;
+      if (Cache->Frames != NULL) {
+        Cache->Misses++;
+        if (Cache->Resident < Cache->Capacity &&
+            !EFI_ERROR(AbArenaAllocFrame(&State->Arena, Slot->Buffer->Width, Slot->Buffer->Height,
+                                         &Cache->Frames[FrameIndex]))) {
+          Slot->Frame = Cache->Frames[FrameIndex];
+        }
+      }
+      Cached = Slot->Frame != Slot->Buffer;
+      AbNarrowSlotToRegion(State, Slot, FrameIndex);
+
+      LoadStart = AbClockNowUs();
+      Slot->Payload.Target = Slot->Frame;
+      Status = State->Loader(State->Context, FrameIndex, &Slot->Payload);
+      if (EFI_ERROR(Status)) {
+        // The arena cannot take one frame back; playback is ending anyway.
+        if (Cached) {
+          Cache->Frames[FrameIndex] = NULL;
+        }
+        return Status;
+      }
+      // Synchronous reads have landed already. Without worker APs the decode
+      // then runs inline, so LoadCost covers both.
+      Slot->Reading = TRUE;
+      AbStartSlotDecode(Slot, FALSE);
+      LoadCost = AbClockNowUs() - LoadStart;
+      State->LoadCostUs = (State->LoadCostUs == 0) ? LoadCost : (State->LoadCostUs * 3 + LoadCost) / 4;
+
+      if (Cached) {
+        Cache->Resident++;
+        Cache->ResidentBytes += (UINT64)Cache->Frames[FrameIndex]->PitchPixels *
+            Cache->Frames[FrameIndex]->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+      }
+    }
+
+    Slot->FrameIndex = FrameIndex;
+    Slot->DurationUs = DurationUs;
+    Slot->Final = Final;
+    Ring->Count++;
+    AbTraceEnd("produce", TraceStart, FrameIndex);
+    return EFI_SUCCESS;
+  }
+  return EFI_END_OF_FILE;
+}
+
+// Runs on whichever processor claims the task: no boot services here.
+static EFI_STATUS
+AbDecodeSlot(VOID *Job) {
+  FRAME_RING_SLOT *Slot = (FRAME_RING_SLOT *)Job;
+  ANIM_PIXEL_FORMAT Format;
+  EFI_STATUS Status;
+  UINT64 StartCycles;
+
+  Slot->Kernel = AbBmpKernelCount;
+
+  if (Slot->Payload.InPlace) {
+    if (!AbIsBmpPayload((CONST UINT8 *)Slot->Frame->Pixels, Slot->Payload.Size)) {
+      return EFI_SUCCESS;
+    }
+    // A loose BMP that happens to be exactly frame-sized.
+    CopyMem(Slot->Payload.Data, Slot->Frame->Pixels, Slot->Payload.Size);
+  }
+
+  Format = Slot->Payload.Format;
+  if (Slot->Payload.SniffFormat) {
+    Format = AbIsBmpPayload(Slot->Payload.Data, Slot->Payload.Size) ?
+        AnimPixelFormatBmp32 : AnimPixelFormatBgra32;
+  }
+  if (Format == AnimPixelFormatBgra32) {
+    return AbDecodeRawPayload(Slot->Payload.Data, Slot->Payload.Size, Slot->Frame);
+  }
+  if (Format == AnimPixelFormatLz4Bgra32) {
+    StartCycles = AbClockCycles();
+    Status = AbDecodeLz4Payload(Slot->Payload.Data, Slot->Payload.Size, Slot->Frame);
+    Slot->DecodeCycles = AbClockCycles() - StartCycles;
+    return Status;
+  }
+
+  StartCycles = AbClockCycles();
+  Status = AbBmpDecode(Slot->Payload.Data, Slot->Payload.Size, Slot->Frame, &Slot->Kernel);
+  Slot->DecodeCycles = AbClockCycles() - StartCycles;
+  return Status;
+}
+
+// Hands the slot to the decoder once its read has landed. A failed read
+// leaves the slot Reading so the error surfaces when the frame is collected.
+static EFI_STATUS
+AbStartSlotDecode(
+    FRAME_RING_SLOT *Slot,
+    BOOLEAN Wait) {
+  EFI_STATUS Status;
+
+  if (!Slot->Reading) {
+    return EFI_SUCCESS;
+  }
+  if (!Wait && !AbAsyncReadPoll(&Slot->Payload.Read)) {
+    return EFI_NOT_READY;
+  }
+  Status = AbAsyncReadWait(&Slot->Payload.Read);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Slot->Reading = FALSE;
+  if (Slot->Payload.InPlace && !Slot->Payload.SniffFormat) {
+    return EFI_SUCCESS;
+  }
+  Slot->Pending = TRUE;
+  AbDecodeSubmit(&Slot->Decode, AbDecodeSlot, Slot);
+  return EFI_SUCCESS;
+}
+
+// Starts decodes for reads that completed, in presentation order.
+static VOID
+AbPumpReads(FRAME_RING *Ring) {
+  UINT32 Index;
+
+  for (Index = 0; Index < Ring->Count; ++Index) {
+    AbStartSlotDecode(&Ring->Slots[(Ring->Head + Index) % Ring->Depth], FALSE);
+  }
+}
+
+// Waits for the slot's read and decode, finishing the decode on the BSP if no
+// AP took it.
+static EFI_STATUS
+AbCollectFrame(
+    FRAME_RING *Ring,
+    FRAME_RING_SLOT *Slot) {
+  EFI_STATUS Status;
+  UINT64 WaitStart;
+  BMP_KERNEL_STATS *Kernel;
+
+  // Time blocked on the read itself is counted by AsyncReadLib.
+  Status = AbStartSlotDecode(Slot, TRUE);
+  if (EFI_ERROR(Status)) {
+    Slot->Reading = FALSE;
+    return Status;
+  }
+  if (!Slot->Pending) {
+    return EFI_SUCCESS;
+  }
+  WaitStart = AbClockNowUs();
+  Status = AbDecodeWait(&Slot->Decode);
+  Slot->Pending = FALSE;
+  Ring->DecodeWaitUs += AbClockNowUs() - WaitStart;
+  AbTraceEnd("decode_wait", WaitStart, Slot->FrameIndex);
+  if (!EFI_ERROR(Status) && Slot->Kernel < AbBmpKernelCount) {
+    Kernel = &Ring->Kernels[Slot->Kernel];
+    Kernel->Frames++;
+    Kernel->Bytes += (UINT64)Slot->Frame->Width * Slot->Frame->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    Kernel->Cycles += Slot->DecodeCycles;
+  }
+  if (!EFI_ERROR(Status) && Slot->Payload.Format == AnimPixelFormatLz4Bgra32) {
+    Ring->Lz4.Frames++;
+    Ring->Lz4.InputBytes += Slot->Payload.Size;
+    Ring->Lz4.OutputBytes += (UINT64)Slot->Frame->Width * Slot->Frame->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    Ring->Lz4.Cycles += Slot->DecodeCycles;
+  }
+  return Status;
+}
+
+static VOID
+AbCollectAll(FRAME_RING *Ring) {
+  UINT32 Index;
+
+  for (Index = 0; Index < AB_MAX_RING_DEPTH; ++Index) {
+    if (Ring->Slots[Index].Reading) {
+      AbAsyncReadWait(&Ring->Slots[Index].Payload.Read);
+      Ring->Slots[Index].Reading = FALSE;
+    }
+    if (Ring->Slots[Index].Pending) {
+      AbDecodeWait(&Ring->Slots[Index].Decode);
+      Ring->Slots[Index].Pending = FALSE;
+    }
+  }
+}
+
+// Partial frames decode into a Rect-sized image packed at the start of the
+// slot's frame, so every decoder sees an ordinary unpadded target.
+static VOID
+AbNarrowSlotToRegion(
+    PLAYBACK_STATE *State,
+    FRAME_RING_SLOT *Slot,
+    UINT32 FrameIndex) {
+  Slot->Rect.X = 0;
+  Slot->Rect.Y = 0;
+  Slot->Rect.Width = Slot->Frame->Width;
+  Slot->Rect.Height = Slot->Frame->Height;
+  if (State->QueryRegion == NULL ||
+      !State->QueryRegion(State->Context, FrameIndex, &Slot->Rect)) {
+    return;
+  }
+  Slot->Region.Width = Slot->Rect.Width;
+  Slot->Region.Height = Slot->Rect.Height;
+  Slot->Region.PitchPixels = Slot->Rect.Width;
+  Slot->Region.Pixels = Slot->Frame->Pixels;
+  Slot->Frame = &Slot->Region;
+}
+
+static VOID
+AbComposeRegion(
+    FRAME_BUFFER *Canvas,
+    CONST FRAME_BUFFER *Region,
+    CONST FRAME_RECT *Rect) {
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dest;
+  CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Source;
+  UINT32 Row;
+
+  Dest = Canvas->Pixels + (UINTN)Rect->Y * Canvas->PitchPixels + Rect->X;
+  Source = Region->Pixels;
+  if (Rect->Width == Canvas->PitchPixels && Region->PitchPixels == Rect->Width) {
+    CopyMem(Dest, Source, (UINTN)Rect->Width * Rect->Height * sizeof(*Dest));
+    return;
+  }
+  for (Row = 0; Row < Rect->Height; ++Row) {
+    CopyMem(Dest, Source, (UINTN)Rect->Width * sizeof(*Dest));
+    Dest += Canvas->PitchPixels;
+    Source += Region->PitchPixels;
+  }
+}
+
+// Decodes ahead while the next deadline leaves room for another load.
+static EFI_STATUS
+AbFillRing(PLAYBACK_STATE *State) {
+  EFI_STATUS Status;
+
+  AbPumpReads(&State->Ring);
+  while (!State->Exhausted && State->Ring.Count < State->Ring.Depth) {
+    // Cached frames cost nothing to queue, so only misses need the slack.
+    if (!AbCacheHas(&State->Cache, State->NextFrame) &&
+        AbSchedulerTimeToDeadlineUs(&State->Scheduler) <= State->LoadCostUs) {
+      break;
+    }
+    Status = AbProduceFrame(State, FALSE);
+    if (Status == EFI_END_OF_FILE) {
+      break;
+    }
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+  return EFI_SUCCESS;
+}
+
 static EFI_STATUS
 AbLoadPackageFromPath(
     EFI_FILE_PROTOCOL *Root,
@@ -668,30 +2003,63 @@ AbLoadPackageFromPath(
   ZeroMem(Package, sizeof(*Package));
   Package->Handle = File;
 
-  Bytes = sizeof(ANIM_PACKAGE_HEADER);
-  Status = File->Read(File, &Bytes, &Package->Header);
-  if (EFI_ERROR(Status) || Bytes != sizeof(ANIM_PACKAGE_HEADER)) {
+  FileInfo = FileHandleGetInfo(File, &gEfiFileInfoGuid);
+  if (FileInfo == NULL) {
+    Status = EFI_DEVICE_ERROR;
+    goto Cleanup;
+  }
+  Package->FileSize = FileInfo->FileSize;
+  CopyMem(&Package->ModificationTime, &FileInfo->ModificationTime, sizeof(EFI_TIME));
+  if (Package->FileSize < sizeof(ANIM_PACKAGE_HEADER)) {
+    Status = EFI_COMPROMISED_DATA;
+    goto Cleanup;
+  }
+
+  // Header, manifest and tables come out of one read instead of a seek and
+  // read each.
+  Package->PrefixSize = (UINTN)MIN(Package->FileSize, AB_PACKAGE_PROBE_BYTES);
+  Package->Prefix = AllocatePool(Package->PrefixSize);
+  if (Package->Prefix == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Cleanup;
+  }
+  Bytes = Package->PrefixSize;
+  Status = File->Read(File, &Bytes, Package->Prefix);
+  if (EFI_ERROR(Status) || Bytes != Package->PrefixSize) {
     Status = EFI_DEVICE_ERROR;
     goto Cleanup;
   }
+  CopyMem(&Package->Header, Package->Prefix, sizeof(ANIM_PACKAGE_HEADER));
 
   if (CompareMem(Package->Header.Magic, ANIM_PACKAGE_MAGIC, 7) != 0) {
     Status = EFI_COMPROMISED_DATA;
     goto Cleanup;
   }
 
+  // Minor revisions only add what an older header leaves zeroed.
+  if (Package->Header.VersionMajor != ANIM_PACKAGE_VERSION_MAJ) {
+    DEBUG((DEBUG_WARN, "Unsupported package version %u.%u\n",
+           Package->Header.VersionMajor, Package->Header.VersionMinor));
+    Status = EFI_UNSUPPORTED;
+    goto Cleanup;
+  }
+
   if (Package->Header.FrameCount == 0 ||
       Package->Header.FrameCount > AB_MAX_FRAME_COUNT) {
     Status = EFI_COMPROMISED_DATA;
     goto Cleanup;
   }
 
-  FileInfo = FileHandleGetInfo(File, &gEfiFileInfoGuid);
-  if (FileInfo == NULL) {
-    Status = EFI_DEVICE_ERROR;
+  if (Package->Header.PixelFormat >= AnimPixelFormatCount) {
+    DEBUG((DEBUG_WARN, "Unsupported pixel format %u\n", Package->Header.PixelFormat));
+    Status = EFI_UNSUPPORTED;
+    goto Cleanup;
+  }
+
+  Status = AbExtendHotPrefix(Package);
+  if (EFI_ERROR(Status)) {
     goto Cleanup;
   }
-  Package->FileSize = FileInfo->FileSize;
 
   if (Package->Header.ManifestSize > 0) {
     Package->ManifestJson = AllocateZeroPool(Package->Header.ManifestSize + 1);
@@ -700,10 +2068,9 @@ AbLoadPackageFromPath(
       goto Cleanup;
     }
     Package->ManifestSize = Package->Header.ManifestSize;
-    Bytes = Package->Header.ManifestSize;
-    Status = File->Read(File, &Bytes, Package->ManifestJson);
-    if (EFI_ERROR(Status) || Bytes != Package->Header.ManifestSize) {
-      Status = EFI_DEVICE_ERROR;
+    Status = AbReadPackageBytes(Package, sizeof(ANIM_PACKAGE_HEADER), Package->ManifestJson,
+                                Package->Header.ManifestSize);
+    if (EFI_ERROR(Status)) {
       goto Cleanup;
     }
   }
@@ -714,31 +2081,19 @@ AbLoadPackageFromPath(
     Status = EFI_OUT_OF_RESOURCES;
     goto Cleanup;
   }
-
-  Status = File->SetPosition(File, Package->Header.FrameTableOffset);
+  Status = AbReadPackageBytes(Package, Package->Header.FrameTableOffset, Package->FrameTable, Bytes);
   if (EFI_ERROR(Status)) {
     goto Cleanup;
   }
 
-  Status = File->Read(File, &Bytes, Package->FrameTable);
-  if (EFI_ERROR(Status) || Bytes != sizeof(ANIM_FRAME_DESC) * Package->Header.FrameCount) {
-    Status = EFI_DEVICE_ERROR;
-    goto Cleanup;
-  }
-
   if (Package->Header.FrameDataOffset >= Package->FileSize) {
     Status = EFI_COMPROMISED_DATA;
     goto Cleanup;
   }
 
-  UINT32 Index;
-  for (Index = 0; Index < Package->Header.FrameCount; ++Index) {
-    UINT64 Start = (UINT64)Package->Header.FrameDataOffset + Package->FrameTable[Index].Offset;
-    UINT64 End = Start + Package->FrameTable[Index].Length;
-    if (Start >= Package->FileSize || End > Package->FileSize ||
-        Package->FrameTable[Index].Length == 0 ||
-        Package->FrameTable[Index].Length > AB_MAX_FRAME_SIZE_BYTES) {
-      Status = EFI_COMPROMISED_DATA;
+  if ((Package->Header.Flags & ANIM_PACKAGE_FLAG_FRAME_RECTS) != 0) {
+    Status = AbLoadFrameRects(Package);
+    if (EFI_ERROR(Status)) {
       goto Cleanup;
     }
   }
@@ -755,13 +2110,307 @@ Cleanup:
   return Status;
 }
 
-static VOID
-AbClosePackage(ANIM_PACKAGE_STATE *Package) {
-  if (Package == NULL) {
-    return;
-  }
-  if (Package->Handle != NULL) {
-    Package->Handle->Close(Package->Handle);
+// A hot prefix larger than the probe is completed by one more sequential
+// read. One that is too large is simply not used; the package still plays.
+static EFI_STATUS
+AbExtendHotPrefix(ANIM_PACKAGE_STATE *Package) {
+  EFI_STATUS Status;
+  UINT8 *Prefix;
+  UINTN Bytes;
+
+  if ((Package->Header.Flags & ANIM_PACKAGE_FLAG_HOT_PREFIX) == 0 ||
+      Package->Header.HotPrefixSize <= Package->PrefixSize ||
+      Package->Header.HotPrefixSize > AB_MAX_HOT_PREFIX_BYTES ||
+      Package->Header.HotPrefixSize > Package->FileSize) {
+    return EFI_SUCCESS;
+  }
+
+  Prefix = AllocatePool(Package->Header.HotPrefixSize);
+  if (Prefix == NULL) {
+    return EFI_SUCCESS;
+  }
+  CopyMem(Prefix, Package->Prefix, Package->PrefixSize);
+
+  // The file position is still right after the probe.
+  Bytes = Package->Header.HotPrefixSize - Package->PrefixSize;
+  Status = Package->Handle->Read(Package->Handle, &Bytes, Prefix + Package->PrefixSize);
+  if (EFI_ERROR(Status) || Bytes != Package->Header.HotPrefixSize - Package->PrefixSize) {
+    FreePool(Prefix);
+    return EFI_DEVICE_ERROR;
+  }
+  FreePool(Package->Prefix);
+  Package->Prefix = Prefix;
+  Package->PrefixSize = Package->Header.HotPrefixSize;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS
+AbReadPackageBytes(
+    ANIM_PACKAGE_STATE *Package,
+    UINT64 Offset,
+    VOID *Buffer,
+    UINTN Length) {
+  if (Offset + Length <= Package->PrefixSize) {
+    CopyMem(Buffer, Package->Prefix + Offset, Length);
+    return EFI_SUCCESS;
+  }
+  return AbReadFileChunk(Package->Handle, Offset, Buffer, Length);
+}
+
+static BOOLEAN
+AbPrefixHoldsFrame(
+    CONST ANIM_PACKAGE_STATE *Package,
+    UINT32 FrameIndex) {
+  CONST ANIM_FRAME_DESC *Descriptor;
+
+  if (Package->Prefix == NULL || FrameIndex >= Package->Header.FrameCount) {
+    return FALSE;
+  }
+  Descriptor = &Package->FrameTable[FrameIndex];
+  return Descriptor->Length > 0 &&
+      Descriptor->Offset < Package->PrefixSize &&
+      (UINT64)Package->Header.FrameDataOffset + Descriptor->Offset + Descriptor->Length <= Package->PrefixSize;
+}
+
+static EFI_STATUS
+AbValidateFrameTable(ANIM_PACKAGE_STATE *Package) {
+  CONST ANIM_FRAME_DESC *Descriptor;
+  UINT64 Start;
+  UINT64 End;
+  UINT32 Index;
+
+  for (Index = 0; Index < Package->Header.FrameCount; ++Index) {
+    Descriptor = &Package->FrameTable[Index];
+    Start = (UINT64)Package->Header.FrameDataOffset + Descriptor->Offset;
+    End = Start + Descriptor->Length;
+    if (Descriptor->Offset >= Package->FileSize || Start >= Package->FileSize || End > Package->FileSize ||
+        Descriptor->Length == 0 || Descriptor->Length > AB_MAX_FRAME_SIZE_BYTES) {
+      return EFI_COMPROMISED_DATA;
+    }
+    Package->MaxFrameLength = MAX(Package->MaxFrameLength, Descriptor->Length);
+  }
+  return EFI_SUCCESS;
+}
+
+// Frame 0 straight from the prefix, presented before the package is fully
+// checked.
+static EFI_STATUS
+AbShowHotFrame(
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config,
+    GOP_STATE *GopState) {
+  CONST ANIM_FRAME_DESC *Descriptor;
+
+  if (!AbPrefixHoldsFrame(Package, 0)) {
+    return EFI_NOT_FOUND;
+  }
+  Descriptor = &Package->FrameTable[0];
+  return AbPresentStill(
+      Config,
+      Package->Prefix + Package->Header.FrameDataOffset + Descriptor->Offset,
+      Descriptor->Length,
+      Package->Header.PixelFormat,
+      "hot frame",
+      GopState);
+}
+
+// Decodes one image and presents it the way playback will, in the same mode
+// and window, so nothing moves when playback takes over. The buffers are
+// temporary and gone before the playback arena exists.
+static EFI_STATUS
+AbPresentStill(
+    CONST PLAYBACK_CONFIG *Config,
+    CONST UINT8 *Payload,
+    UINTN PayloadSize,
+    UINT32 PixelFormat,
+    CONST CHAR8 *Source,
+    GOP_STATE *GopState) {
+  EFI_STATUS Status;
+  FRAME_BUFFER *Frame = NULL;
+  FRAME_BUFFER *Presented;
+  FRAME_SCALER Scaler;
+  AB_BMP_KERNEL Kernel;
+
+  if (Config->LogicalWidth == 0 || Config->LogicalHeight == 0 ||
+      Config->LogicalWidth > AB_MAX_FRAME_DIMENSION ||
+      Config->LogicalHeight > AB_MAX_FRAME_DIMENSION) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  if (Config->SelectMode) {
+    Status = AbSelectGopMode(GopState, Config->LogicalWidth, Config->LogicalHeight);
+    if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_WARN, "GOP mode selection failed: %r\n", Status));
+    }
+  }
+
+  Status = AbAllocateFrameBuffer(Config->LogicalWidth, Config->LogicalHeight, &Frame);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if (PixelFormat == AnimPixelFormatBgra32) {
+    Status = AbDecodeRawPayload(Payload, PayloadSize, Frame);
+  } else if (PixelFormat == AnimPixelFormatLz4Bgra32) {
+    Status = AbDecodeLz4Payload(Payload, PayloadSize, Frame);
+  } else {
+    AbBmpDecodeInit();
+    Status = AbBmpDecode(Payload, PayloadSize, Frame, &Kernel);
+  }
+  if (EFI_ERROR(Status)) {
+    AbFreeFrameBuffer(&Frame);
+    return Status;
+  }
+
+  Status = AbScalerInit(
+      &Scaler,
+      GopState->Gop->Mode->Information->HorizontalResolution,
+      GopState->Gop->Mode->Information->VerticalResolution,
+      Config->LogicalWidth,
+      Config->LogicalHeight,
+      AbScaleModeFromName(Config->Scaling),
+      AbScaleFilterFromName(Config->ScaleFilter));
+  if (EFI_ERROR(Status)) {
+    AbFreeFrameBuffer(&Frame);
+    return Status;
+  }
+  Presented = Frame;
+  if (Scaler.Active) {
+    AbScaleFrame(&Scaler, Frame);
+    Presented = &Scaler.View;
+    AbPaintBars(GopState, &Scaler);
+  }
+  Status = AbBlitFrameDirty(GopState, Presented, Scaler.Output.X, Scaler.Output.Y);
+  if (!EFI_ERROR(Status)) {
+    AbNoteFirstPixel(Source);
+  }
+  AbScalerFree(&Scaler);
+  AbFreeFrameBuffer(&Frame);
+  return Status;
+}
+
+// The poster frame linked into the image (SplashFrame.c), shown before any
+// file is opened. The default SplashFrame.c has none.
+static VOID
+AbShowSplash(GOP_STATE *GopState) {
+  EFI_STATUS Status;
+  PLAYBACK_CONFIG Config;
+
+  if (gAbSplashSize == 0) {
+    return;
+  }
+  if (gAbSplashSize > AB_MAX_SPLASH_BYTES) {
+    DEBUG((DEBUG_WARN, "Splash frame of %u bytes exceeds the limit\n", gAbSplashSize));
+    return;
+  }
+
+  ZeroMem(&Config, sizeof(Config));
+  Config.LogicalWidth = gAbSplashWidth;
+  Config.LogicalHeight = gAbSplashHeight;
+  Config.SelectMode = gAbSplashSelectMode;
+  AsciiStrCpyS(Config.Scaling, sizeof(Config.Scaling), gAbSplashScaling);
+  AsciiStrCpyS(Config.ScaleFilter, sizeof(Config.ScaleFilter), gAbSplashScaleFilter);
+
+  Status = AbPresentStill(&Config, gAbSplashData, gAbSplashSize, AnimPixelFormatLz4Bgra32, "splash", GopState);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "Splash frame not shown: %r\n", Status));
+    return;
+  }
+  DEBUG((DEBUG_INFO, "Splash: %ux%u from %u embedded bytes\n", gAbSplashWidth, gAbSplashHeight, gAbSplashSize));
+}
+
+// Blits only the bars around the scaler's output window, leaving whatever
+// the window already shows alone.
+static VOID
+AbPaintBars(
+    GOP_STATE *GopState,
+    FRAME_SCALER *Scaler) {
+  FRAME_RECT Bars[4];
+  CONST FRAME_RECT *Output;
+  UINT32 Width;
+  UINT32 Height;
+  UINT32 Index;
+
+  Output = &Scaler->Output;
+  Width = Scaler->Staging->Width;
+  Height = Scaler->Staging->Height;
+  Bars[0].X = 0;
+  Bars[0].Y = 0;
+  Bars[0].Width = Width;
+  Bars[0].Height = Output->Y;
+  Bars[1].X = 0;
+  Bars[1].Y = Output->Y + Output->Height;
+  Bars[1].Width = Width;
+  Bars[1].Height = Height - Bars[1].Y;
+  Bars[2].X = 0;
+  Bars[2].Y = Output->Y;
+  Bars[2].Width = Output->X;
+  Bars[2].Height = Output->Height;
+  Bars[3].X = Output->X + Output->Width;
+  Bars[3].Y = Output->Y;
+  Bars[3].Width = Width - Bars[3].X;
+  Bars[3].Height = Output->Height;
+  for (Index = 0; Index < ARRAY_SIZE(Bars); ++Index) {
+    if (Bars[Index].Width > 0 && Bars[Index].Height > 0) {
+      AbBlitFrameRect(GopState, Scaler->Staging, &Bars[Index], 0, 0);
+    }
+  }
+}
+
+// Time-to-first-pixel: from entry to the first blit of an animation frame.
+static VOID
+AbNoteFirstPixel(CONST CHAR8 *Source) {
+  if (mFirstPixelShown) {
+    return;
+  }
+  mFirstPixelShown = TRUE;
+  AbTraceInstant("first_pixel", AB_TRACE_NO_ARG);
+  DEBUG((DEBUG_INFO, "First pixel: %lu us after start (%a)\n", AbClockNowUs() - mStartUs, Source));
+}
+
+// Frame 0 has to cover the whole frame: it is what every loop starts from.
+static EFI_STATUS
+AbLoadFrameRects(ANIM_PACKAGE_STATE *Package) {
+  EFI_STATUS Status;
+  CONST ANIM_FRAME_RECT *Rect;
+  UINTN Bytes;
+  UINT32 Index;
+
+  Bytes = sizeof(ANIM_FRAME_RECT) * Package->Header.FrameCount;
+  if (Package->Header.RectTableOffset == 0 ||
+      (UINT64)Package->Header.RectTableOffset + Bytes > Package->FileSize) {
+    return EFI_COMPROMISED_DATA;
+  }
+  Package->RectTable = AllocatePool(Bytes);
+  if (Package->RectTable == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = AbReadPackageBytes(Package, Package->Header.RectTableOffset, Package->RectTable, Bytes);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < Package->Header.FrameCount; ++Index) {
+    Rect = &Package->RectTable[Index];
+    if (Rect->Width == 0 || Rect->Height == 0 ||
+        (UINT32)Rect->X + Rect->Width > Package->Header.LogicalWidth ||
+        (UINT32)Rect->Y + Rect->Height > Package->Header.LogicalHeight) {
+      return EFI_COMPROMISED_DATA;
+    }
+  }
+  Rect = &Package->RectTable[0];
+  if (Rect->Width != Package->Header.LogicalWidth || Rect->Height != Package->Header.LogicalHeight) {
+    return EFI_COMPROMISED_DATA;
+  }
+  return EFI_SUCCESS;
+}
+
+static VOID
+AbClosePackage(ANIM_PACKAGE_STATE *Package) {
+  if (Package == NULL) {
+    return;
+  }
+  if (Package->Handle != NULL) {
+    Package->Handle->Close(Package->Handle);
   }
   if (Package->ManifestJson != NULL) {
     FreePool(Package->ManifestJson);
@@ -769,9 +2418,143 @@ AbClosePackage(ANIM_PACKAGE_STATE *Package) {
   if (Package->FrameTable != NULL) {
     FreePool(Package->FrameTable);
   }
+  if (Package->Preload != NULL) {
+    FreePages(Package->Preload, Package->PreloadPages);
+  }
+  if (Package->RectTable != NULL) {
+    FreePool(Package->RectTable);
+  }
+  if (Package->Prefix != NULL) {
+    FreePool(Package->Prefix);
+  }
   ZeroMem(Package, sizeof(*Package));
 }
 
+// Preloading only pays while the ring keeps its minimum depth in what is left
+// of the budget.
+static BOOLEAN
+AbShouldPreloadPackage(
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config) {
+  UINT64 PreloadBytes;
+  UINT64 RingBytes;
+
+  if (Config->PreloadPercent == 0) {
+    return FALSE;
+  }
+  PreloadBytes = ALIGN_VALUE(Package->FileSize - Package->Header.FrameDataOffset, EFI_PAGE_SIZE);
+  if (PreloadBytes > DivU64x32(MultU64x32(Config->MaxMemoryBytes, Config->PreloadPercent), 100)) {
+    return FALSE;
+  }
+  // Partial frames also need the screen image they are composed onto.
+  RingBytes = MultU64x32(
+      AbArenaFrameFootprint(Config->LogicalWidth, Config->LogicalHeight),
+      AB_MIN_RING_DEPTH + ((Package->RectTable != NULL) ? 1 : 0));
+  return PreloadBytes + RingBytes <= Config->MaxMemoryBytes;
+}
+
+//
+// Reads the whole frame data section into page-aligned memory in large
+// sequential chunks. The chunk size starts at 256 KiB and doubles while that
+// still buys at least 1/8 more throughput; a read the firmware refuses is
+// retried at half the size, down to 64 KiB.
+//
+static EFI_STATUS
+AbPreloadPackage(ANIM_PACKAGE_STATE *Package) {
+  EFI_FILE_PROTOCOL *File = Package->Handle;
+  EFI_STATUS Status;
+  UINT8 *Base;
+  UINTN Size;
+  UINTN Pages;
+  UINTN Offset;
+  UINTN Chunk;
+  UINTN Bytes;
+  UINT32 Reads;
+  BOOLEAN Tuned;
+  UINT64 StartUs;
+  UINT64 ChunkStartUs;
+  UINT64 ElapsedUs;
+  UINT64 Rate;
+  UINT64 BestRate;
+
+  Size = (UINTN)(Package->FileSize - Package->Header.FrameDataOffset);
+  Pages = EFI_SIZE_TO_PAGES(Size);
+  Base = AllocatePages(Pages);
+  if (Base == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = File->SetPosition(File, Package->Header.FrameDataOffset);
+  if (EFI_ERROR(Status)) {
+    goto Cleanup;
+  }
+
+  StartUs = AbClockNowUs();
+  Offset = 0;
+  Chunk = AB_PRELOAD_FIRST_CHUNK;
+  Reads = 0;
+  Tuned = FALSE;
+  BestRate = 0;
+  while (Offset < Size) {
+    Bytes = MIN(Chunk, Size - Offset);
+    ChunkStartUs = AbClockNowUs();
+    Status = File->Read(File, &Bytes, Base + Offset);
+    if (EFI_ERROR(Status)) {
+      if (Chunk <= AB_PRELOAD_MIN_CHUNK) {
+        goto Cleanup;
+      }
+      // Some USB stacks reject large transfers; the position is unreliable
+      // after a failed read.
+      Chunk /= 2;
+      Tuned = TRUE;
+      Status = File->SetPosition(File, Package->Header.FrameDataOffset + Offset);
+      if (EFI_ERROR(Status)) {
+        goto Cleanup;
+      }
+      continue;
+    }
+    if (Bytes == 0) {
+      Status = EFI_DEVICE_ERROR;
+      goto Cleanup;
+    }
+    Offset += Bytes;
+    Reads++;
+
+    if (!Tuned && Bytes == Chunk) {
+      ElapsedUs = MAX(AbClockNowUs() - ChunkStartUs, 1);
+      Rate = DivU64x64Remainder(Bytes, ElapsedUs, NULL);
+      if (Rate * 8 >= BestRate * 9 && Chunk < AB_PRELOAD_MAX_CHUNK) {
+        BestRate = Rate;
+        Chunk *= 2;
+      } else {
+        if (Rate < BestRate) {
+          Chunk /= 2;
+        }
+        Tuned = TRUE;
+      }
+    }
+  }
+
+  ElapsedUs = MAX(AbClockNowUs() - StartUs, 1);
+  DEBUG((DEBUG_INFO,
+         "Preload: %lu KiB in %u reads, %lu KiB chunks, %lu KiB/s\n",
+         (UINT64)(Size / 1024),
+         Reads,
+         (UINT64)(Chunk / 1024),
+         DivU64x64Remainder(MultU64x32((UINT64)Size, 1000000U) / 1024, ElapsedUs, NULL)));
+
+  Package->Preload = Base;
+  Package->PreloadPages = Pages;
+  Base = NULL;
+  Status = EFI_SUCCESS;
+
+Cleanup:
+  if (Base != NULL) {
+    FreePages(Base, Pages);
+  }
+  return Status;
+}
+
 static EFI_STATUS
 AbLoadLooseManifest(
     EFI_FILE_PROTOCOL *Root,
@@ -780,6 +2563,8 @@ AbLoadLooseManifest(
   EFI_STATUS Status;
   CHAR8 *Json = NULL;
   UINT32 Length = 0;
+  JSON_KEY_TABLE Keys;
+  UINT64 StartUs;
 
   if (Manifest == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -792,43 +2577,378 @@ AbLoadLooseManifest(
     return Status;
   }
 
-  AbApplyManifestOverrides(Json, &Manifest->Config);
-  Status = AbParseLooseFrames(Json, Path, Manifest);
-  FreePool(Json);
-  return Status;
-}
+  StartUs = AbClockNowUs();
+  Status = AbJsonTokenize(Json, Length, &Keys, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Manifest %s is not a JSON object: %r\n", Path, Status));
+    FreePool(Json);
+    return Status;
+  }
+  AbApplyManifestOverrides(&Keys, &Manifest->Config);
+  Status = AbParseLooseFrames(&Keys, Path, Manifest);
+  DEBUG((DEBUG_INFO, "Manifest parsed: %u bytes, %u keys, %u frames in %lu us\n",
+         Length, Keys.Count, Manifest->FrameCount, AbClockNowUs() - StartUs));
+  FreePool(Json);
+  if (Status == EFI_NOT_FOUND) {
+    return AbScanFramePattern(Root, Path, Manifest);
+  }
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = AbIndexLooseFrames(Root, Manifest);
+  if (EFI_ERROR(Status)) {
+    AbFreeLooseManifest(Manifest);
+  }
+  return Status;
+}
+
+static VOID
+AbFreeLooseManifest(LOOSE_MANIFEST_STATE *Manifest) {
+  UINT32 Index;
+  if (Manifest == NULL) {
+    return;
+  }
+  if (Manifest->Frames != NULL) {
+    for (Index = 0; Index < Manifest->FrameCount; ++Index) {
+      if (Manifest->Frames[Index].Path != NULL) {
+        FreePool(Manifest->Frames[Index].Path);
+      }
+    }
+    FreePool(Manifest->Frames);
+  }
+  if (Manifest->Directories != NULL) {
+    for (Index = 0; Index < Manifest->DirectoryCount; ++Index) {
+      Manifest->Directories[Index].Handle->Close(Manifest->Directories[Index].Handle);
+      FreePool(Manifest->Directories[Index].Path);
+    }
+    FreePool(Manifest->Directories);
+  }
+  ZeroMem(Manifest, sizeof(*Manifest));
+}
+
+// Next entry of a directory opened for reading; EFI_END_OF_FILE after the last.
+static EFI_STATUS
+AbReadDirectoryEntry(
+    EFI_FILE_PROTOCOL *Directory,
+    EFI_FILE_INFO *Info) {
+  EFI_STATUS Status;
+  UINTN Size;
+
+  Size = AB_FILE_INFO_SIZE;
+  Status = Directory->Read(Directory, &Size, Info);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  return (Size == 0) ? EFI_END_OF_FILE : EFI_SUCCESS;
+}
+
+// Opens the directory Path[0..Length) once and returns its slot.
+static EFI_STATUS
+AbAddLooseDirectory(
+    EFI_FILE_PROTOCOL *Root,
+    LOOSE_MANIFEST_STATE *Manifest,
+    CONST CHAR16 *Path,
+    UINTN Length,
+    UINT32 *Index) {
+  LOOSE_DIRECTORY *Directory;
+  EFI_STATUS Status;
+
+  for (*Index = 0; *Index < Manifest->DirectoryCount; ++*Index) {
+    Directory = &Manifest->Directories[*Index];
+    if (StrLen(Directory->Path) == Length && StrnCmp(Directory->Path, Path, Length) == 0) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  Directory = &Manifest->Directories[Manifest->DirectoryCount];
+  Directory->Path = AllocateZeroPool((Length + 1) * sizeof(CHAR16));
+  if (Directory->Path == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(Directory->Path, Path, Length * sizeof(CHAR16));
+  Status = Root->Open(Root, &Directory->Handle, Directory->Path, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "Cannot open frame directory %s: %r\n", Directory->Path, Status));
+    FreePool(Directory->Path);
+    Directory->Path = NULL;
+    return Status;
+  }
+  Manifest->DirectoryCount++;
+  return EFI_SUCCESS;
+}
+
+// FNV-1a over the upper-cased name: FAT lookups ignore case.
+static UINT32
+AbHashLooseName(
+    UINT32 Directory,
+    CONST CHAR16 *Name) {
+  UINT32 Hash = 2166136261U ^ Directory;
+  CHAR16 Char;
+
+  for (; *Name != L'\0'; ++Name) {
+    Char = (*Name >= L'a' && *Name <= L'z') ? (CHAR16)(*Name - (L'a' - L'A')) : *Name;
+    Hash = (Hash ^ Char) * 16777619U;
+  }
+  return Hash;
+}
+
+//
+// Resolves every listed frame against one enumeration of its directory, so
+// playback opens frames relative to an already open directory handle and
+// never needs GetInfo. Frames listed more than once share a single lookup.
+//
+static EFI_STATUS
+AbIndexLooseFrames(
+    EFI_FILE_PROTOCOL *Root,
+    LOOSE_MANIFEST_STATE *Manifest) {
+  EFI_STATUS Status;
+  LOOSE_FRAME_DESC *Frame;
+  UINT64 InfoBuffer[AB_FILE_INFO_SIZE / sizeof(UINT64) + 1];
+  EFI_FILE_INFO *Info = (EFI_FILE_INFO *)InfoBuffer;
+  UINT32 *Table = NULL;
+  UINT32 TableMask;
+  UINT32 Slot;
+  UINT32 Index;
+  UINT32 Directory;
+  UINTN Separator;
+
+  Manifest->Directories = AllocateZeroPool(sizeof(LOOSE_DIRECTORY) * Manifest->FrameCount);
+  TableMask = 1;
+  while (TableMask < Manifest->FrameCount * 2) {
+    TableMask <<= 1;
+  }
+  Table = AllocateZeroPool(sizeof(UINT32) * TableMask);
+  TableMask--;
+  if (Manifest->Directories == NULL || Table == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Cleanup;
+  }
+
+  // Table slots hold FrameIndex + 1 of the first frame with a given name.
+  for (Index = 0; Index < Manifest->FrameCount; ++Index) {
+    Frame = &Manifest->Frames[Index];
+    Separator = StrLen(Frame->Path);
+    while (Separator > 0 && Frame->Path[Separator - 1] != L'\\') {
+      --Separator;
+    }
+    Frame->Name = Frame->Path + Separator;
+    if (*Frame->Name == L'\0') {
+      Status = EFI_COMPROMISED_DATA;
+      goto Cleanup;
+    }
+    // Keep the root's separator, drop any other trailing one.
+    Status = AbAddLooseDirectory(
+        Root,
+        Manifest,
+        Frame->Path,
+        (Separator > 1) ? Separator - 1 : Separator,
+        &Frame->Directory);
+    if (EFI_ERROR(Status)) {
+      goto Cleanup;
+    }
+    for (Slot = AbHashLooseName(Frame->Directory, Frame->Name) & TableMask;
+         Table[Slot] != 0;
+         Slot = (Slot + 1) & TableMask) {
+      if (Manifest->Frames[Table[Slot] - 1].Directory == Frame->Directory &&
+          StriCmp(Manifest->Frames[Table[Slot] - 1].Name, Frame->Name) == 0) {
+        break;
+      }
+    }
+    if (Table[Slot] == 0) {
+      Table[Slot] = Index + 1;
+    }
+  }
+
+  for (Directory = 0; Directory < Manifest->DirectoryCount; ++Directory) {
+    while (!EFI_ERROR(Status = AbReadDirectoryEntry(Manifest->Directories[Directory].Handle, Info))) {
+      if ((Info->Attribute & EFI_FILE_DIRECTORY) != 0) {
+        continue;
+      }
+      for (Slot = AbHashLooseName(Directory, Info->FileName) & TableMask;
+           Table[Slot] != 0;
+           Slot = (Slot + 1) & TableMask) {
+        Frame = &Manifest->Frames[Table[Slot] - 1];
+        if (Frame->Directory == Directory && StriCmp(Frame->Name, Info->FileName) == 0) {
+          Frame->FileSize = Info->FileSize;
+          break;
+        }
+      }
+    }
+    if (Status != EFI_END_OF_FILE) {
+      goto Cleanup;
+    }
+  }
+
+  // Every name is in the table, so the probe always ends on its first frame.
+  for (Index = 0; Index < Manifest->FrameCount; ++Index) {
+    Frame = &Manifest->Frames[Index];
+    Slot = AbHashLooseName(Frame->Directory, Frame->Name) & TableMask;
+    while (Manifest->Frames[Table[Slot] - 1].Directory != Frame->Directory ||
+           StriCmp(Manifest->Frames[Table[Slot] - 1].Name, Frame->Name) != 0) {
+      Slot = (Slot + 1) & TableMask;
+    }
+    Frame->FileSize = Manifest->Frames[Table[Slot] - 1].FileSize;
+    if (Frame->FileSize == 0) {
+      DEBUG((DEBUG_WARN, "Frame %u (%s) is missing or empty\n", Index, Frame->Path));
+      Status = EFI_NOT_FOUND;
+      goto Cleanup;
+    }
+  }
+  Status = EFI_SUCCESS;
+
+Cleanup:
+  if (Table != NULL) {
+    FreePool(Table);
+  }
+  return Status;
+}
+
+// Matches frame<digits>.bmp, at least four digits, ignoring case.
+static BOOLEAN
+AbMatchFramePattern(
+    CONST CHAR16 *Name,
+    UINT32 *Number) {
+  CONST CHAR16 *Prefix = L"frame";
+  UINTN Digits;
+  UINT64 Value = 0;
+
+  for (; *Prefix != L'\0'; ++Prefix, ++Name) {
+    if ((*Name | 0x20) != *Prefix) {
+      return FALSE;
+    }
+  }
+  for (Digits = 0; Name[Digits] >= L'0' && Name[Digits] <= L'9'; ++Digits) {
+    if (Value <= MAX_UINT32) {
+      Value = Value * 10 + (Name[Digits] - L'0');
+    }
+  }
+  if (Digits < 4 || Value > MAX_UINT32 || StriCmp(Name + Digits, L".bmp") != 0) {
+    return FALSE;
+  }
+  *Number = (UINT32)Value;
+  return TRUE;
+}
+
+//
+// Default sequence when the manifest lists no frames: frame%04d.bmp next to
+// the manifest, from the lowest number found up to the first gap, taken from
+// a single enumeration of that directory.
+//
+static EFI_STATUS
+AbScanFramePattern(
+    EFI_FILE_PROTOCOL *Root,
+    CONST CHAR16 *ManifestPath,
+    LOOSE_MANIFEST_STATE *Manifest) {
+  EFI_STATUS Status;
+  CHAR16 *BaseDirectory = NULL;
+  CHAR16 **Names = NULL;
+  UINT64 *Sizes = NULL;
+  UINT64 InfoBuffer[AB_FILE_INFO_SIZE / sizeof(UINT64) + 1];
+  EFI_FILE_INFO *Info = (EFI_FILE_INFO *)InfoBuffer;
+  LOOSE_FRAME_DESC *Frame;
+  UINT32 Number;
+  UINT32 First;
+  UINT32 Count;
+  UINT32 Index;
+  UINTN Length;
+
+  BaseDirectory = AbExtractDirectory(ManifestPath);
+  Manifest->Directories = AllocateZeroPool(sizeof(LOOSE_DIRECTORY));
+  Names = AllocateZeroPool(sizeof(CHAR16 *) * AB_MAX_FRAME_COUNT);
+  Sizes = AllocateZeroPool(sizeof(UINT64) * AB_MAX_FRAME_COUNT);
+  if (BaseDirectory == NULL || Manifest->Directories == NULL || Names == NULL || Sizes == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Cleanup;
+  }
+
+  Length = StrLen(BaseDirectory);
+  Status = AbAddLooseDirectory(Root, Manifest, BaseDirectory, (Length > 1) ? Length - 1 : Length, &Index);
+  if (EFI_ERROR(Status)) {
+    goto Cleanup;
+  }
+
+  // frame0000 and frame0001 are both common starts; numbers past the frame
+  // limit can never be part of a playable run.
+  First = AB_MAX_FRAME_COUNT;
+  while (!EFI_ERROR(Status = AbReadDirectoryEntry(Manifest->Directories[0].Handle, Info))) {
+    if ((Info->Attribute & EFI_FILE_DIRECTORY) != 0 || Info->FileSize == 0 ||
+        !AbMatchFramePattern(Info->FileName, &Number) ||
+        Number >= AB_MAX_FRAME_COUNT || Names[Number] != NULL) {
+      continue;
+    }
+    Names[Number] = AbDuplicateString(Info->FileName);
+    if (Names[Number] == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Cleanup;
+    }
+    Sizes[Number] = Info->FileSize;
+    First = MIN(First, Number);
+  }
+  if (Status != EFI_END_OF_FILE) {
+    goto Cleanup;
+  }
+  if (First == AB_MAX_FRAME_COUNT) {
+    Status = EFI_NOT_FOUND;
+    goto Cleanup;
+  }
 
-static VOID
-AbFreeLooseManifest(LOOSE_MANIFEST_STATE *Manifest) {
-  UINT32 Index;
-  if (Manifest == NULL) {
-    return;
+  Count = 0;
+  while (First + Count < AB_MAX_FRAME_COUNT && Names[First + Count] != NULL) {
+    ++Count;
   }
-  if (Manifest->Frames != NULL) {
-    for (Index = 0; Index < Manifest->FrameCount; ++Index) {
-      if (Manifest->Frames[Index].Path != NULL) {
-        FreePool(Manifest->Frames[Index].Path);
+  Manifest->Frames = AllocateZeroPool(sizeof(LOOSE_FRAME_DESC) * Count);
+  if (Manifest->Frames == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Cleanup;
+  }
+  Manifest->FrameCount = Count;
+  for (Index = 0; Index < Count; ++Index) {
+    Frame = &Manifest->Frames[Index];
+    Frame->Path = AbJoinPaths(BaseDirectory, Names[First + Index]);
+    if (Frame->Path == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Cleanup;
+    }
+    Frame->Name = Frame->Path + StrLen(Frame->Path) - StrLen(Names[First + Index]);
+    Frame->FileSize = Sizes[First + Index];
+  }
+  DEBUG((DEBUG_INFO, "Found frame%%04d.bmp sequence: %u frames from %u\n", Count, First));
+  Status = EFI_SUCCESS;
+
+Cleanup:
+  if (Names != NULL) {
+    for (Index = 0; Index < AB_MAX_FRAME_COUNT; ++Index) {
+      if (Names[Index] != NULL) {
+        FreePool(Names[Index]);
       }
     }
-    FreePool(Manifest->Frames);
+    FreePool(Names);
   }
-  ZeroMem(Manifest, sizeof(*Manifest));
+  if (Sizes != NULL) {
+    FreePool(Sizes);
+  }
+  if (BaseDirectory != NULL) {
+    FreePool(BaseDirectory);
+  }
+  if (EFI_ERROR(Status)) {
+    AbFreeLooseManifest(Manifest);
+  }
+  return Status;
 }
 
 static EFI_STATUS
 AbPackageFrameLoader(
     VOID *Context,
     UINT32 FrameIndex,
-    FRAME_BUFFER *Target,
-    UINT32 *DurationUs) {
+    FRAME_PAYLOAD *Payload) {
   PACKAGE_PLAYBACK_CONTEXT *PkgContext = (PACKAGE_PLAYBACK_CONTEXT *)Context;
   ANIM_PACKAGE_STATE *Package;
   const ANIM_FRAME_DESC *Descriptor;
-  UINT8 *Payload = NULL;
-  UINTN PayloadSize;
   EFI_STATUS Status;
+  UINT64 TraceStart;
 
-  if (PkgContext == NULL || PkgContext->Package == NULL || Target == NULL) {
+  if (PkgContext == NULL || PkgContext->Package == NULL || Payload == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
@@ -837,133 +2957,227 @@ AbPackageFrameLoader(
     return EFI_INVALID_PARAMETER;
   }
   Descriptor = &Package->FrameTable[FrameIndex];
-  PayloadSize = Descriptor->Length;
 
-  Payload = AllocatePool(PayloadSize);
-  if (Payload == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Payload->Size = Descriptor->Length;
+  Payload->Format = Package->Header.PixelFormat;
+  Payload->SniffFormat = FALSE;
+
+  if (Package->Preload != NULL) {
+    // Already resident: there is nothing to read, the decode takes the bytes
+    // from the preloaded image.
+    Payload->Data = Package->Preload + Descriptor->Offset;
+    Payload->InPlace = FALSE;
+    Payload->Read.Status = EFI_SUCCESS;
+    return EFI_SUCCESS;
+  }
+  if (AbPrefixHoldsFrame(Package, FrameIndex)) {
+    Payload->Data = Package->Prefix + Package->Header.FrameDataOffset + Descriptor->Offset;
+    Payload->InPlace = FALSE;
+    Payload->Read.Status = EFI_SUCCESS;
+    return EFI_SUCCESS;
+  }
+
+  // Raw frames already are the decoded pixels: read them into the target.
+  Payload->InPlace = Package->Header.PixelFormat == AnimPixelFormatBgra32 &&
+      AbPayloadFitsTarget(Payload->Target, Descriptor->Length);
+  if (!Payload->InPlace && Descriptor->Length > Payload->Capacity) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  // Reads overlap only on separate handles: each one has its own position.
+  if (Payload->Handle == NULL) {
+    Status = PkgContext->Root->Open(
+        PkgContext->Root,
+        &Payload->Handle,
+        (CHAR16 *)PkgContext->Path,
+        EFI_FILE_MODE_READ,
+        0);
+    if (EFI_ERROR(Status)) {
+      Payload->Handle = NULL;
+      return Status;
+    }
   }
 
-  Status = AbReadFileChunk(
-      Package->Handle,
+  TraceStart = AbTraceBegin();
+  Status = AbAsyncReadIssue(
+      &Payload->Read,
+      Payload->Handle,
       (UINT64)Package->Header.FrameDataOffset + Descriptor->Offset,
-      Payload,
-      PayloadSize);
+      Payload->InPlace ? (VOID *)Payload->Target->Pixels : Payload->Data,
+      Descriptor->Length,
+      FALSE);
   if (EFI_ERROR(Status)) {
-    goto Cleanup;
+    return Status;
   }
+  AbTraceEnd("read", TraceStart, FrameIndex);
+  return EFI_SUCCESS;
+}
 
-  Status = AbDecodeFramePayload(Payload, PayloadSize, Package->Header.PixelFormat, Target);
-  if (EFI_ERROR(Status)) {
-    goto Cleanup;
+static UINT32
+AbPackageFrameDuration(
+    VOID *Context,
+    UINT32 FrameIndex) {
+  PACKAGE_PLAYBACK_CONTEXT *PkgContext = (PACKAGE_PLAYBACK_CONTEXT *)Context;
+
+  if (PkgContext == NULL || PkgContext->Package == NULL ||
+      FrameIndex >= PkgContext->Package->Header.FrameCount) {
+    return 0;
   }
+  return PkgContext->Package->FrameTable[FrameIndex].DurationUs;
+}
+
+// abtool pack points identical frames at one payload. A shared partial
+// payload only says the same pixels land again, so just full frames count.
+static BOOLEAN
+AbPackageFrameRepeats(
+    VOID *Context,
+    UINT32 Shown,
+    UINT32 FrameIndex) {
+  PACKAGE_PLAYBACK_CONTEXT *PkgContext = (PACKAGE_PLAYBACK_CONTEXT *)Context;
+  CONST ANIM_PACKAGE_STATE *Package;
+  CONST ANIM_FRAME_DESC *Table;
+  FRAME_RECT Rect;
 
-  if (DurationUs != NULL && Descriptor->DurationUs != 0) {
-    *DurationUs = Descriptor->DurationUs;
+  if (PkgContext == NULL || PkgContext->Package == NULL ||
+      Shown >= PkgContext->Package->Header.FrameCount ||
+      FrameIndex >= PkgContext->Package->Header.FrameCount) {
+    return FALSE;
   }
+  Package = PkgContext->Package;
+  if (Package->RectTable != NULL &&
+      (AbPackageFrameRegion(Context, Shown, &Rect) || AbPackageFrameRegion(Context, FrameIndex, &Rect))) {
+    return FALSE;
+  }
+  Table = Package->FrameTable;
+  return Table[Shown].Offset == Table[FrameIndex].Offset &&
+      Table[Shown].Length == Table[FrameIndex].Length;
+}
 
-Cleanup:
-  if (Payload != NULL) {
-    FreePool(Payload);
+static BOOLEAN
+AbPackageFrameRegion(
+    VOID *Context,
+    UINT32 FrameIndex,
+    FRAME_RECT *Rect) {
+  PACKAGE_PLAYBACK_CONTEXT *PkgContext = (PACKAGE_PLAYBACK_CONTEXT *)Context;
+  CONST ANIM_PACKAGE_STATE *Package;
+  CONST ANIM_FRAME_RECT *Source;
+
+  if (PkgContext == NULL || PkgContext->Package == NULL || PkgContext->Package->RectTable == NULL ||
+      FrameIndex >= PkgContext->Package->Header.FrameCount) {
+    return FALSE;
   }
-  return Status;
+  Package = PkgContext->Package;
+  Source = &Package->RectTable[FrameIndex];
+  if (Source->Width == Package->Header.LogicalWidth && Source->Height == Package->Header.LogicalHeight) {
+    return FALSE;
+  }
+  Rect->X = Source->X;
+  Rect->Y = Source->Y;
+  Rect->Width = Source->Width;
+  Rect->Height = Source->Height;
+  return TRUE;
 }
 
 static EFI_STATUS
 AbLooseFrameLoader(
     VOID *Context,
     UINT32 FrameIndex,
-    FRAME_BUFFER *Target,
-    UINT32 *DurationUs) {
+    FRAME_PAYLOAD *Payload) {
   LOOSE_PLAYBACK_CONTEXT *LooseContext = (LOOSE_PLAYBACK_CONTEXT *)Context;
+  const LOOSE_FRAME_DESC *Frame;
+  EFI_FILE_PROTOCOL *Directory;
   EFI_FILE_PROTOCOL *File = NULL;
-  EFI_FILE_INFO *Info = NULL;
-  UINT8 *Payload = NULL;
   UINTN PayloadSize;
   EFI_STATUS Status;
+  UINT64 TraceStart;
 
   if (LooseContext == NULL ||
       LooseContext->Manifest == NULL ||
       FrameIndex >= LooseContext->Manifest->FrameCount ||
-      Target == NULL) {
+      Payload == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  const LOOSE_FRAME_DESC *Frame = &LooseContext->Manifest->Frames[FrameIndex];
-  Status = LooseContext->Root->Open(
-      LooseContext->Root,
-      &File,
-      Frame->Path,
-      EFI_FILE_MODE_READ,
-      0);
-  if (EFI_ERROR(Status)) {
-    return Status;
-  }
-
-  Info = FileHandleGetInfo(File, &gEfiFileInfoGuid);
-  if (Info == NULL) {
-    Status = EFI_DEVICE_ERROR;
-    goto Cleanup;
-  }
-
-  if (Info->FileSize == 0 || Info->FileSize > AB_MAX_FRAME_SIZE_BYTES) {
-    Status = EFI_COMPROMISED_DATA;
-    goto Cleanup;
-  }
-
-  PayloadSize = (UINTN)Info->FileSize;
-  Payload = AllocatePool(PayloadSize);
-  if (Payload == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Cleanup;
+  // Capacity is the logical frame size plus header slack, so anything larger
+  // is not a frame of this animation.
+  Frame = &LooseContext->Manifest->Frames[FrameIndex];
+  if (Frame->FileSize == 0 || Frame->FileSize > Payload->Capacity) {
+    return EFI_COMPROMISED_DATA;
   }
 
-  Status = AbReadFileChunk(File, 0, Payload, PayloadSize);
+  // Sizes come from the load-time index; the lookup is a single name in an
+  // already open directory.
+  Directory = LooseContext->Manifest->Directories[Frame->Directory].Handle;
+  TraceStart = AbTraceBegin();
+  Status = Directory->Open(Directory, &File, (CHAR16 *)Frame->Name, EFI_FILE_MODE_READ, 0);
   if (EFI_ERROR(Status)) {
-    goto Cleanup;
+    return Status;
   }
+  AbTraceEnd("open", TraceStart, FrameIndex);
 
-  ANIM_PIXEL_FORMAT Format = AnimPixelFormatBmp32;
-  if (!AbIsBmpPayload(Payload, PayloadSize)) {
-    Format = AnimPixelFormatBgra32;
-  }
+  PayloadSize = (UINTN)Frame->FileSize;
+  Payload->Size = PayloadSize;
+  Payload->Format = AnimPixelFormatBmp32;
+  Payload->SniffFormat = TRUE;
+  Payload->InPlace = AbPayloadFitsTarget(Payload->Target, PayloadSize);
 
-  Status = AbDecodeFramePayload(Payload, PayloadSize, Format, Target);
+  // The read owns the handle from here and closes it on completion.
+  TraceStart = AbTraceBegin();
+  Status = AbAsyncReadIssue(
+      &Payload->Read,
+      File,
+      0,
+      Payload->InPlace ? (VOID *)Payload->Target->Pixels : Payload->Data,
+      PayloadSize,
+      TRUE);
   if (EFI_ERROR(Status)) {
-    goto Cleanup;
+    return Status;
   }
+  AbTraceEnd("read", TraceStart, FrameIndex);
+  return EFI_SUCCESS;
+}
 
-  if (DurationUs != NULL && Frame->DurationUs != 0) {
-    *DurationUs = Frame->DurationUs;
-  }
+static UINT32
+AbLooseFrameDuration(
+    VOID *Context,
+    UINT32 FrameIndex) {
+  LOOSE_PLAYBACK_CONTEXT *LooseContext = (LOOSE_PLAYBACK_CONTEXT *)Context;
 
-Cleanup:
-  if (Payload != NULL) {
-    FreePool(Payload);
-  }
-  if (Info != NULL) {
-    FreePool(Info);
+  if (LooseContext == NULL || LooseContext->Manifest == NULL ||
+      FrameIndex >= LooseContext->Manifest->FrameCount) {
+    return 0;
   }
-  if (File != NULL) {
-    File->Close(File);
-  }
-  return Status;
+  return LooseContext->Manifest->Frames[FrameIndex].DurationUs;
 }
 
-static EFI_STATUS
-AbDecodeFramePayload(
-    CONST UINT8 *Payload,
-    UINTN PayloadSize,
-    ANIM_PIXEL_FORMAT FormatHint,
-    FRAME_BUFFER *Target) {
-  if (Payload == NULL || Target == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
+// The same file listed again, e.g. to hold a pose.
+static BOOLEAN
+AbLooseFrameRepeats(
+    VOID *Context,
+    UINT32 Shown,
+    UINT32 FrameIndex) {
+  LOOSE_PLAYBACK_CONTEXT *LooseContext = (LOOSE_PLAYBACK_CONTEXT *)Context;
+  CONST LOOSE_FRAME_DESC *Frames;
 
-  if (FormatHint == AnimPixelFormatBgra32) {
-    return AbDecodeRawPayload(Payload, PayloadSize, Target);
+  if (LooseContext == NULL || LooseContext->Manifest == NULL ||
+      Shown >= LooseContext->Manifest->FrameCount ||
+      FrameIndex >= LooseContext->Manifest->FrameCount) {
+    return FALSE;
   }
-  return AbDecodeBmpPayload(Payload, PayloadSize, Target);
+  Frames = LooseContext->Manifest->Frames;
+  return Frames[Shown].Directory == Frames[FrameIndex].Directory &&
+      StriCmp(Frames[Shown].Name, Frames[FrameIndex].Name) == 0;
+}
+
+// TRUE when a raw BGRA32 payload of this size can be read straight into the
+// target's pixels, which needs rows without padding.
+static BOOLEAN
+AbPayloadFitsTarget(
+    CONST FRAME_BUFFER *Target,
+    UINTN PayloadSize) {
+  return Target != NULL &&
+      Target->PitchPixels == Target->Width &&
+      PayloadSize == (UINTN)Target->Width * Target->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
 }
 
 static EFI_STATUS
@@ -981,74 +3195,26 @@ AbDecodeRawPayload(
   return EFI_SUCCESS;
 }
 
+// Frames from the arena have no row padding, so the block decodes straight
+// into the pixels in one piece.
 static EFI_STATUS
-AbDecodeBmpPayload(
+AbDecodeLz4Payload(
     CONST UINT8 *Payload,
     UINTN PayloadSize,
     FRAME_BUFFER *Target) {
-  const BMP_IMAGE_HEADER *Bmp;
-  const BMP_FILE_HEADER *FileHeader;
-  const BMP_INFO_HEADER *Info;
-  CONST UINT8 *ImageBase;
-  UINT32 Row;
-  UINT32 Column;
-  UINT32 BytesPerPixel;
-  UINT32 RowSize;
-  BOOLEAN BottomUp;
-  INT32 Height;
-
-  if (PayloadSize < sizeof(BMP_IMAGE_HEADER)) {
-    return EFI_COMPROMISED_DATA;
-  }
-
-  Bmp = (const BMP_IMAGE_HEADER *)Payload;
-  FileHeader = &Bmp->BmpHeader.BmpFileHeader;
-  Info = &Bmp->BmpHeader.BmpInfoHeader;
-
-  if (FileHeader->CharB != 'B' || FileHeader->CharM != 'M') {
-    return EFI_UNSUPPORTED;
-  }
-
-  if (Info->BitPerPixel != 24 && Info->BitPerPixel != 32) {
-    return EFI_UNSUPPORTED;
-  }
-
-  Height = Info->PixelHeight;
-  if ((UINT32)Info->PixelWidth != Target->Width ||
-      ((Height < 0 ? -Height : Height) != (INT32)Target->Height)) {
-    return EFI_BAD_BUFFER_SIZE;
-  }
+  EFI_STATUS Status;
+  UINTN Expected;
+  UINTN Decoded;
 
-  if (Info->CompressionType != 0) {
+  if (Target->PitchPixels != Target->Width) {
     return EFI_UNSUPPORTED;
   }
-
-  if (FileHeader->ImageOffset >= PayloadSize) {
-    return EFI_COMPROMISED_DATA;
-  }
-
-  BytesPerPixel = Info->BitPerPixel / 8;
-  RowSize = ((Info->BitPerPixel * Target->Width + 31) / 32) * 4;
-  if ((UINT64)RowSize * Target->Height > PayloadSize) {
-    return EFI_COMPROMISED_DATA;
-  }
-
-  ImageBase = Payload + FileHeader->ImageOffset;
-  BottomUp = Info->PixelHeight > 0;
-
-  for (Row = 0; Row < Target->Height; ++Row) {
-    UINT32 SrcRow = BottomUp ? (Target->Height - 1 - Row) : Row;
-    CONST UINT8 *Src = ImageBase + (UINTN)SrcRow * RowSize;
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dst = Target->Pixels + (UINTN)Row * Target->PitchPixels;
-    for (Column = 0; Column < Target->Width; ++Column) {
-      CONST UINT8 *Pixel = Src + Column * BytesPerPixel;
-      Dst[Column].Blue = Pixel[0];
-      Dst[Column].Green = Pixel[1];
-      Dst[Column].Red = Pixel[2];
-      Dst[Column].Reserved = (BytesPerPixel == 4) ? Pixel[3] : 0xFF;
-    }
+  Expected = Target->Width * Target->Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  Status = AbLz4DecodeBlock(Payload, PayloadSize, (UINT8 *)Target->Pixels, Expected, &Decoded);
+  if (!EFI_ERROR(Status) && Decoded != Expected) {
+    Status = EFI_COMPROMISED_DATA;
   }
-  return EFI_SUCCESS;
+  return Status;
 }
 
 static EFI_STATUS
@@ -1080,11 +3246,20 @@ AbInitPlaybackDefaults(PLAYBACK_CONFIG *Config) {
   Config->LogicalWidth = 640;
   Config->LogicalHeight = 360;
   Config->FrameDurationUs = AB_DEFAULT_FRAME_DURATION;
+  Config->TargetFps = AB_DEFAULT_FPS;
   Config->LoopCount = 1;
   Config->AllowKeySkip = TRUE;
+  Config->AllowFrameDrop = TRUE;
+  Config->CacheFrames = TRUE;
+  Config->DirectFramebuffer = FALSE;
+  Config->SelectMode = TRUE;
+  Config->DecodeWorkers = AB_DEFAULT_DECODE_WORKERS;
+  Config->AsyncIo = TRUE;
   Config->MaxMemoryBytes = AB_DEFAULT_MAX_MEMORY_BYTES;
+  Config->PreloadPercent = AB_DEFAULT_PRELOAD_PERCENT;
   Config->MaxTotalDurationMs = 0;
   AsciiStrCpyS(Config->Scaling, sizeof(Config->Scaling), "letterbox");
+  AsciiStrCpyS(Config->ScaleFilter, sizeof(Config->ScaleFilter), "auto");
 }
 
 static VOID
@@ -1099,6 +3274,7 @@ AbInitPlaybackFromHeader(
   Config->LogicalHeight = Header->LogicalHeight;
   Config->LoopCount = Header->LoopCount;
   if (Header->TargetFps != 0) {
+    Config->TargetFps = Header->TargetFps;
     Config->FrameDurationUs = (UINT32)(1000000U / Header->TargetFps);
   }
   if (Config->FrameDurationUs == 0) {
@@ -1108,205 +3284,97 @@ AbInitPlaybackFromHeader(
 
 static VOID
 AbApplyManifestOverrides(
-    CHAR8 *Json,
+    CONST JSON_KEY_TABLE *Keys,
     PLAYBACK_CONFIG *Config) {
   UINT64 Value;
   CHAR8 Buffer[sizeof(Config->Scaling)];
   BOOLEAN BoolVal;
 
-  if (Json == NULL || Config == NULL) {
+  if (Keys == NULL || Config == NULL) {
     return;
   }
 
-  if (AbJsonReadUint(Json, "logical_width", &Value) && Value > 0) {
+  if (AbJsonGetUint(Keys, "logical_width", &Value) && Value > 0) {
     Config->LogicalWidth = (UINT32)MIN(Value, AB_MAX_FRAME_DIMENSION);
   }
-  if (AbJsonReadUint(Json, "logical_height", &Value) && Value > 0) {
+  if (AbJsonGetUint(Keys, "logical_height", &Value) && Value > 0) {
     Config->LogicalHeight = (UINT32)MIN(Value, AB_MAX_FRAME_DIMENSION);
   }
-  if (AbJsonReadUint(Json, "frame_duration_us", &Value) && Value > 0) {
+  if (AbJsonGetUint(Keys, "frame_duration_us", &Value) && Value > 0) {
+    // abtool writes the truncated 1000000 / fps here; keep the exact rate then.
+    if (Config->TargetFps == 0 || Value != 1000000U / Config->TargetFps) {
+      Config->TargetFps = 0;
+    }
     Config->FrameDurationUs = (UINT32)Value;
   }
-  if (AbJsonReadUint(Json, "loop_count", &Value)) {
+  if (AbJsonGetUint(Keys, "loop_count", &Value)) {
     Config->LoopCount = (UINT32)MIN(Value, AB_MAX_LOOP_COUNT);
   }
-  if (AbJsonReadUint(Json, "max_memory", &Value) && Value > 0) {
+  if (AbJsonGetUint(Keys, "max_memory", &Value) && Value > 0) {
     Config->MaxMemoryBytes = Value;
   }
-  if (AbJsonReadUint(Json, "max_total_duration_ms", &Value)) {
-    Config->MaxTotalDurationMs = (UINT32)Value;
-  }
-  if (AbJsonReadBool(Json, "allow_key_skip", &BoolVal)) {
-    Config->AllowKeySkip = BoolVal;
-  }
-  if (AbJsonReadString(Json, "scaling", Buffer, sizeof(Buffer))) {
-    AsciiStrCpyS(Config->Scaling, sizeof(Config->Scaling), Buffer);
-  }
-}
-
-static CHAR8 *
-AbJsonFindKey(
-    CHAR8 *Json,
-    CONST CHAR8 *Key) {
-  CHAR8 Pattern[64];
-
-  if (Json == NULL || Key == NULL) {
-    return NULL;
-  }
-  AsciiSPrint(Pattern, sizeof(Pattern), "\"%a\"", Key);
-  return AsciiStrStr(Json, Pattern);
-}
-
-static CHAR8 *
-AbSkipJsonNoise(CHAR8 *Ptr) {
-  if (Ptr == NULL) {
-    return NULL;
-  }
-  while (*Ptr != '\0' &&
-         (*Ptr == ' ' || *Ptr == '\t' || *Ptr == '\n' ||
-          *Ptr == '\r' || *Ptr == ':' || *Ptr == ',')) {
-    ++Ptr;
-  }
-  return Ptr;
-}
-
-static BOOLEAN
-AbJsonReadUint(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    UINT64 *Value) {
-  CHAR8 *KeyPtr;
-  CHAR8 *ValuePtr;
-  RETURN_STATUS ConvStatus;
-  UINTN KeyLength;
-
-  if (Value == NULL) {
-    return FALSE;
-  }
-  KeyPtr = AbJsonFindKey(Json, Key);
-  if (KeyPtr == NULL) {
-    return FALSE;
+  if (AbJsonGetUint(Keys, "preload_percent", &Value)) {
+    Config->PreloadPercent = (UINT32)MIN(Value, 100);
   }
-  KeyLength = AsciiStrLen(Key);
-  ValuePtr = AbSkipJsonNoise(KeyPtr + KeyLength + 2);
-  if (ValuePtr == NULL) {
-    return FALSE;
+  if (AbJsonGetUint(Keys, "max_total_duration_ms", &Value)) {
+    Config->MaxTotalDurationMs = (UINT32)Value;
   }
-  ConvStatus = AsciiStrDecimalToUint64S(ValuePtr, NULL, Value);
-  return !RETURN_ERROR(ConvStatus);
-}
-
-static BOOLEAN
-AbJsonReadBool(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    BOOLEAN *Value) {
-  CHAR8 *KeyPtr;
-  CHAR8 *ValuePtr;
-  UINTN KeyLength;
-
-  if (Value == NULL) {
-    return FALSE;
+  if (AbJsonGetUint(Keys, "decode_workers", &Value)) {
+    Config->DecodeWorkers = (UINT32)MIN(Value, AB_MAX_RING_DEPTH);
   }
-  KeyPtr = AbJsonFindKey(Json, Key);
-  if (KeyPtr == NULL) {
-    return FALSE;
+  if (AbJsonGetBool(Keys, "allow_key_skip", &BoolVal)) {
+    Config->AllowKeySkip = BoolVal;
   }
-  KeyLength = AsciiStrLen(Key);
-  ValuePtr = AbSkipJsonNoise(KeyPtr + KeyLength + 2);
-  if (ValuePtr == NULL) {
-    return FALSE;
+  if (AbJsonGetBool(Keys, "allow_frame_drop", &BoolVal)) {
+    Config->AllowFrameDrop = BoolVal;
   }
-  if (AsciiStrnCmp(ValuePtr, "true", 4) == 0) {
-    *Value = TRUE;
-    return TRUE;
+  if (AbJsonGetBool(Keys, "cache_frames", &BoolVal)) {
+    Config->CacheFrames = BoolVal;
   }
-  if (AsciiStrnCmp(ValuePtr, "false", 5) == 0) {
-    *Value = FALSE;
-    return TRUE;
+  if (AbJsonGetBool(Keys, "direct_framebuffer", &BoolVal)) {
+    Config->DirectFramebuffer = BoolVal;
   }
-  return FALSE;
-}
-
-static BOOLEAN
-AbJsonReadString(
-    CHAR8 *Json,
-    CONST CHAR8 *Key,
-    CHAR8 *Buffer,
-    UINTN BufferSize) {
-  CHAR8 *KeyPtr;
-  CHAR8 *ValuePtr;
-  UINTN Index;
-  UINTN KeyLength;
-
-  if (Buffer == NULL || BufferSize == 0) {
-    return FALSE;
+  if (AbJsonGetBool(Keys, "select_mode", &BoolVal)) {
+    Config->SelectMode = BoolVal;
   }
-
-  KeyPtr = AbJsonFindKey(Json, Key);
-  if (KeyPtr == NULL) {
-    return FALSE;
+  if (AbJsonGetBool(Keys, "async_io", &BoolVal)) {
+    Config->AsyncIo = BoolVal;
   }
-  KeyLength = AsciiStrLen(Key);
-  ValuePtr = AbSkipJsonNoise(KeyPtr + KeyLength + 2);
-  if (ValuePtr == NULL || *ValuePtr != '"') {
-    return FALSE;
+  if (AbJsonGetString(Keys, "scaling", Buffer, sizeof(Buffer))) {
+    AsciiStrCpyS(Config->Scaling, sizeof(Config->Scaling), Buffer);
   }
-  ++ValuePtr;
-  for (Index = 0; Index + 1 < BufferSize && ValuePtr[Index] != '\0'; ++Index) {
-    if (ValuePtr[Index] == '"') {
-      break;
-    }
-    Buffer[Index] = ValuePtr[Index];
+  if (AbJsonGetString(Keys, "scale_filter", Buffer, sizeof(Buffer))) {
+    AsciiStrCpyS(Config->ScaleFilter, sizeof(Config->ScaleFilter), Buffer);
   }
-  Buffer[Index] = '\0';
-  return TRUE;
 }
 
 static EFI_STATUS
 AbParseLooseFrames(
-    CHAR8 *Json,
+    CONST JSON_KEY_TABLE *Keys,
     CONST CHAR16 *ManifestPath,
     LOOSE_MANIFEST_STATE *Manifest) {
-  CHAR8 *FramesKey;
-  CHAR8 *ArrayStart;
-  CHAR8 *ArrayEnd;
-  CHAR8 *Cursor;
-  UINT32 ObjectCount = 0;
-  UINT32 Index = 0;
+  JSON_ARRAY_CURSOR Cursor;
+  JSON_KEY_TABLE Object;
   CHAR16 *BaseDirectory = NULL;
   EFI_STATUS Status = EFI_SUCCESS;
 
-  if (Json == NULL || Manifest == NULL) {
+  if (Keys == NULL || Manifest == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  FramesKey = AbJsonFindKey(Json, "frames");
-  if (FramesKey == NULL) {
-    return EFI_NOT_FOUND;
-  }
-
-  ArrayStart = AsciiStrStr(FramesKey, "[");
-  ArrayEnd = AsciiStrStr(FramesKey, "]");
-  if (ArrayStart == NULL || ArrayEnd == NULL || ArrayEnd <= ArrayStart) {
-    return EFI_COMPROMISED_DATA;
-  }
-
-  for (Cursor = ArrayStart; Cursor < ArrayEnd; ++Cursor) {
-    if (*Cursor == '{') {
-      ++ObjectCount;
-    }
+  // NOT_FOUND means "no list" and selects the pattern scan.
+  if (!AbJsonGetArray(Keys, "frames", &Cursor)) {
+    return (AbJsonFind(Keys, "frames") == NULL) ? EFI_NOT_FOUND : EFI_COMPROMISED_DATA;
   }
-
-  if (ObjectCount == 0) {
+  if (Cursor.Count == 0) {
     return EFI_NOT_FOUND;
   }
 
-  Manifest->Frames = AllocateZeroPool(sizeof(LOOSE_FRAME_DESC) * ObjectCount);
+  Manifest->Frames = AllocateZeroPool(sizeof(LOOSE_FRAME_DESC) * Cursor.Count);
   if (Manifest->Frames == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
-  Manifest->FrameCount = ObjectCount;
+  Manifest->FrameCount = Cursor.Count;
 
   BaseDirectory = AbExtractDirectory(ManifestPath);
   if (BaseDirectory == NULL) {
@@ -1314,38 +3382,15 @@ AbParseLooseFrames(
     goto Cleanup;
   }
 
-  Cursor = ArrayStart;
-  while (Cursor < ArrayEnd && Index < ObjectCount) {
-    CHAR8 *ObjectStart = AsciiStrStr(Cursor, "{");
-    CHAR8 *ObjectEnd;
-    CHAR8 *Segment;
-    UINTN SegmentLength;
-    if (ObjectStart == NULL || ObjectStart >= ArrayEnd) {
-      break;
-    }
-    ObjectEnd = AsciiStrStr(ObjectStart, "}");
-    if (ObjectEnd == NULL || ObjectEnd >= ArrayEnd) {
-      Status = EFI_COMPROMISED_DATA;
-      break;
-    }
-    SegmentLength = (UINTN)(ObjectEnd - ObjectStart + 1);
-    Segment = AllocateZeroPool(SegmentLength + 1);
-    if (Segment == NULL) {
-      Status = EFI_OUT_OF_RESOURCES;
-      break;
+  while (Cursor.Index < Cursor.Count) {
+    Status = AbJsonNextObject(&Cursor, &Object);
+    if (EFI_ERROR(Status)) {
+      goto Cleanup;
     }
-    CopyMem(Segment, ObjectStart, SegmentLength);
-    Status = AbParseFrameObject(Segment, BaseDirectory, &Manifest->Frames[Index]);
-    FreePool(Segment);
+    Status = AbParseFrameObject(&Object, BaseDirectory, &Manifest->Frames[Cursor.Index - 1]);
     if (EFI_ERROR(Status)) {
-      break;
+      goto Cleanup;
     }
-    Index++;
-    Cursor = ObjectEnd + 1;
-  }
-
-  if (!EFI_ERROR(Status) && Index != ObjectCount) {
-    Status = EFI_COMPROMISED_DATA;
   }
 
 Cleanup:
@@ -1360,20 +3405,19 @@ Cleanup:
 
 static EFI_STATUS
 AbParseFrameObject(
-    CHAR8 *ObjectJson,
+    CONST JSON_KEY_TABLE *Object,
     CONST CHAR16 *BaseDirectory,
     LOOSE_FRAME_DESC *Frame) {
   CHAR8 PathBuffer[256];
   UINT64 Duration = 0;
   CHAR16 *Relative = NULL;
-  EFI_STATUS Status = EFI_SUCCESS;
 
-  if (Frame == NULL || ObjectJson == NULL || BaseDirectory == NULL) {
+  if (Frame == NULL || Object == NULL || BaseDirectory == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  if (!AbJsonReadString(ObjectJson, "path", PathBuffer, sizeof(PathBuffer))) {
-    return EFI_NOT_FOUND;
+  if (!AbJsonGetString(Object, "path", PathBuffer, sizeof(PathBuffer))) {
+    return EFI_COMPROMISED_DATA;
   }
 
   Relative = AbAsciiPathToUnicode(PathBuffer);
@@ -1387,10 +3431,10 @@ AbParseFrameObject(
     return EFI_OUT_OF_RESOURCES;
   }
 
-  if (AbJsonReadUint(ObjectJson, "duration_us", &Duration)) {
+  if (AbJsonGetUint(Object, "duration_us", &Duration)) {
     Frame->DurationUs = (UINT32)Duration;
   }
-  return Status;
+  return EFI_SUCCESS;
 }
 
 static CHAR16 *
@@ -1552,10 +3596,39 @@ AbInitInputProtocols(VOID) {
   if (mTextInputEx != NULL) {
     return;
   }
-  gBS->LocateProtocol(
-      &gEfiSimpleTextInputExProtocolGuid,
-      NULL,
-      (VOID **)&mTextInputEx);
+  gBS->LocateProtocol(
+      &gEfiSimpleTextInputExProtocolGuid,
+      NULL,
+      (VOID **)&mTextInputEx);
+}
+
+// The key wait event lets frame waits halt and still react to a skip at once.
+static EFI_EVENT
+AbGetSkipEvent(BOOLEAN AllowSkip) {
+  if (!AllowSkip) {
+    return NULL;
+  }
+  AbInitInputProtocols();
+  if (mTextInputEx != NULL) {
+    return mTextInputEx->WaitForKeyEx;
+  }
+  if (gST != NULL && gST->ConIn != NULL) {
+    return gST->ConIn->WaitForKey;
+  }
+  return NULL;
+}
+
+static BOOLEAN
+AbWaitForFrame(
+    FRAME_SCHEDULER *Scheduler,
+    EFI_EVENT SkipEvent) {
+  // A signaled key event without a readable key (e.g. a toggle) keeps waiting.
+  while (AbSchedulerWaitForDeadline(Scheduler, SkipEvent)) {
+    if (AbUserRequestedSkip(TRUE)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
 }
 
 static VOID
@@ -1668,49 +3741,13 @@ AbIsBmpPayload(CONST UINT8 *Payload, UINTN Length) {
   return (Payload[0] == 'B' && Payload[1] == 'M');
 }
 
-static
-VOID
-AbComputeDestPosition(
-    GOP_STATE *State,
-    UINT32 FrameWidth,
-    UINT32 FrameHeight,
-    CONST CHAR8 *Scaling,
-    UINT32 *DestX,
-    UINT32 *DestY) {
-  UINT32 ScreenWidth;
-  UINT32 ScreenHeight;
-
-  if (State == NULL || State->Gop == NULL || DestX == NULL || DestY == NULL) {
-    return;
-  }
-
-  ScreenWidth = State->Gop->Mode->Information->HorizontalResolution;
-  ScreenHeight = State->Gop->Mode->Information->VerticalResolution;
-
-  if (ScreenWidth <= FrameWidth) {
-    *DestX = 0;
-  } else {
-    *DestX = (ScreenWidth - FrameWidth) / 2;
-  }
-
-  if (ScreenHeight <= FrameHeight) {
-    *DestY = 0;
-  } else {
-    *DestY = (ScreenHeight - FrameHeight) / 2;
-  }
-
-  if (Scaling != NULL && AsciiStrCmp(Scaling, "fill") == 0) {
-    *DestX = 0;
-    *DestY = 0;
-  }
-}
-
 static EFI_STATUS
 AbOpenRootFromPath(
     CONST CHAR16 *PathSpec,
-    EFI_FILE_PROTOCOL **Root) {
+    EFI_FILE_PROTOCOL **Root,
+    EFI_HANDLE *Volume) {
   EFI_STATUS Status;
-  CHAR16 PartitionSpec[32];
+  CHAR16 PartitionSpec[AB_PARTITION_SPEC_CHARS];
   CHAR16 FilePath[256];
   EFI_HANDLE PartitionHandle = NULL;
 
@@ -1730,201 +3767,238 @@ AbOpenRootFromPath(
   // If no partition spec, use default EFI partition
   if (PartitionSpec[0] == L'\0') {
     EFI_LOADED_IMAGE_PROTOCOL *LoadedImage = NULL;
-    EFI_HANDLE ImageHandle;
 
-    // Get current image handle
-    Status = gBS->HandleProtocol(
-        gImageHandle,
-        &gEfiLoadedImageProtocolGuid,
-        (VOID **)&LoadedImage);
+    Status = AbOpenRoot(gImageHandle, Root, &LoadedImage);
+    if (!EFI_ERROR(Status) && Volume != NULL) {
+      *Volume = LoadedImage->DeviceHandle;
+    }
+    return Status;
+  }
+
+  // Find partition by label or path. A match that will not open is marked
+  // and the lookup repeated, so the next volume with the same name is tried.
+  for (;;) {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem = NULL;
+    UINTN Index;
+
+    Status = AbFindPartitionByLabel(PartitionSpec, &PartitionHandle);
     if (EFI_ERROR(Status)) {
+      DEBUG((DEBUG_WARN, "Failed to find partition '%s': %r\n", PartitionSpec, Status));
       return Status;
     }
 
-    return AbOpenRoot(gImageHandle, Root, &LoadedImage);
-  }
-
-  // Find partition by label or path
-  Status = AbFindPartitionByLabel(PartitionSpec, &PartitionHandle);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_WARN, "Failed to find partition '%s': %r\n", PartitionSpec, Status));
-    return Status;
-  }
+    // Open file system on the partition
+    Status = gBS->HandleProtocol(
+        PartitionHandle,
+        &gEfiSimpleFileSystemProtocolGuid,
+        (VOID **)&FileSystem);
+    if (!EFI_ERROR(Status)) {
+      Status = FileSystem->OpenVolume(FileSystem, Root);
+    }
+    if (!EFI_ERROR(Status)) {
+      if (Volume != NULL) {
+        *Volume = PartitionHandle;
+      }
+      return EFI_SUCCESS;
+    }
 
-  // Open file system on the partition
-  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem = NULL;
-  Status = gBS->HandleProtocol(
-      PartitionHandle,
-      &gEfiSimpleFileSystemProtocolGuid,
-      (VOID **)&FileSystem);
-  if (EFI_ERROR(Status)) {
-    return Status;
+    DEBUG((DEBUG_WARN, "Partition '%s' matched but failed to open: %r\n", PartitionSpec, Status));
+    for (Index = 0; Index < mVolumeIndex.Count; ++Index) {
+      if (mVolumeIndex.Entries[Index].Handle == PartitionHandle) {
+        mVolumeIndex.Entries[Index].OpenFailed = TRUE;
+      }
+    }
   }
-
-  return FileSystem->OpenVolume(FileSystem, Root);
 }
 
+// Indexes every SimpleFileSystem handle from its device path, BlockIo and
+// PartitionInfo protocols. No volume is opened here.
 static EFI_STATUS
-AbEnumerateFatPartitions(
-    EFI_HANDLE **Handles,
-    UINTN *HandleCount) {
+AbBuildVolumeIndex(VOID) {
   EFI_STATUS Status;
-  UINTN BufferSize = 0;
-  EFI_HANDLE *HandleBuffer = NULL;
+  EFI_HANDLE *Handles = NULL;
+  UINTN HandleCount = 0;
+  UINTN Index;
+  UINT64 StartUs;
 
-  if (Handles == NULL || HandleCount == NULL) {
-    return EFI_INVALID_PARAMETER;
+  if (mVolumeIndex.Built) {
+    return mVolumeIndex.Count > 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
   }
 
-  *Handles = NULL;
-  *HandleCount = 0;
-
-  // Get all handles with SimpleFileSystem protocol
+  StartUs = AbClockNowUs();
   Status = gBS->LocateHandleBuffer(
       ByProtocol,
       &gEfiSimpleFileSystemProtocolGuid,
       NULL,
-      &BufferSize,
-      &HandleBuffer);
+      &HandleCount,
+      &Handles);
   if (EFI_ERROR(Status)) {
     return Status;
   }
 
-  // Filter FAT partitions (we'll check this by trying to open them)
-  EFI_HANDLE *FatHandles = NULL;
-  UINTN FatCount = 0;
-
-  FatHandles = AllocateZeroPool(BufferSize);
-  if (FatHandles == NULL) {
-    FreePool(HandleBuffer);
+  mVolumeIndex.Entries = AllocateZeroPool(HandleCount * sizeof(VOLUME_ENTRY));
+  if (mVolumeIndex.Entries == NULL) {
+    FreePool(Handles);
     return EFI_OUT_OF_RESOURCES;
   }
+  for (Index = 0; Index < HandleCount; ++Index) {
+    AbDescribeVolume(Handles[Index], &mVolumeIndex.Entries[Index]);
+  }
+  FreePool(Handles);
 
-  for (UINTN i = 0; i < BufferSize / sizeof(EFI_HANDLE); i++) {
-    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem = NULL;
-    EFI_FILE_PROTOCOL *Root = NULL;
+  mVolumeIndex.Count = HandleCount;
+  mVolumeIndex.Built = TRUE;
+  mVolumeIndex.BuildUs = AbClockNowUs() - StartUs;
+  return HandleCount > 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
 
-    Status = gBS->HandleProtocol(
-        HandleBuffer[i],
-        &gEfiSimpleFileSystemProtocolGuid,
-        (VOID **)&FileSystem);
-    if (EFI_ERROR(Status)) {
-      continue;
-    }
+static VOID
+AbDescribeVolume(
+    EFI_HANDLE Handle,
+    VOLUME_ENTRY *Entry) {
+  EFI_STATUS Status;
+  EFI_DEVICE_PATH_PROTOCOL *Node = NULL;
+  EFI_BLOCK_IO_PROTOCOL *BlockIo = NULL;
+  EFI_PARTITION_INFO_PROTOCOL *PartitionInfo = NULL;
+  HARDDRIVE_DEVICE_PATH *HardDrive;
 
-    Status = FileSystem->OpenVolume(FileSystem, &Root);
-    if (EFI_ERROR(Status)) {
-      continue;
+  Entry->Handle = Handle;
+
+  Status = gBS->HandleProtocol(Handle, &gEfiDevicePathProtocolGuid, (VOID **)&Node);
+  while (!EFI_ERROR(Status) && !IsDevicePathEnd(Node)) {
+    if (DevicePathType(Node) == MEDIA_DEVICE_PATH &&
+        DevicePathSubType(Node) == MEDIA_HARDDRIVE_DP) {
+      HardDrive = (HARDDRIVE_DEVICE_PATH *)Node;
+      UnicodeSPrint(Entry->LegacyName, sizeof(Entry->LegacyName), L"PART%02X", HardDrive->PartitionNumber);
+      if (HardDrive->SignatureType == SIGNATURE_TYPE_GUID) {
+        CopyMem(&Entry->PartitionGuid, HardDrive->Signature, sizeof(EFI_GUID));
+        Entry->HasGuid = TRUE;
+      }
+      break;
     }
+    Node = NextDevicePathNode(Node);
+  }
 
-    // Try to read a small file to verify it's accessible
-    EFI_FILE_PROTOCOL *TestFile = NULL;
-    Status = Root->Open(Root, &TestFile, L"\\", EFI_FILE_MODE_READ, 0);
+  if (Entry->LegacyName[0] == L'\0') {
+    Status = gBS->HandleProtocol(Handle, &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
     if (!EFI_ERROR(Status)) {
-      TestFile->Close(TestFile);
-      FatHandles[FatCount++] = HandleBuffer[i];
+      UnicodeSPrint(Entry->LegacyName, sizeof(Entry->LegacyName), L"BLK%08X", BlockIo->Media->MediaId);
     }
-
-    Root->Close(Root);
   }
 
-  FreePool(HandleBuffer);
-
-  if (FatCount == 0) {
-    FreePool(FatHandles);
-    return EFI_NOT_FOUND;
+  // UEFI 2.7+ partition drivers publish the GPT entry itself.
+  Status = gBS->HandleProtocol(Handle, &gEfiPartitionInfoProtocolGuid, (VOID **)&PartitionInfo);
+  if (!EFI_ERROR(Status) && PartitionInfo->Type == PARTITION_TYPE_GPT) {
+    StrnCpyS(Entry->GptName, ARRAY_SIZE(Entry->GptName), PartitionInfo->Info.Gpt.PartitionName,
+             ARRAY_SIZE(PartitionInfo->Info.Gpt.PartitionName));
+    if (!Entry->HasGuid) {
+      CopyGuid(&Entry->PartitionGuid, &PartitionInfo->Info.Gpt.UniquePartitionGUID);
+      Entry->HasGuid = TRUE;
+    }
   }
-
-  *Handles = FatHandles;
-  *HandleCount = FatCount;
-  return EFI_SUCCESS;
 }
 
-static EFI_STATUS
-AbFindPartitionByLabel(
-    CONST CHAR16 *Label,
-    EFI_HANDLE *Handle) {
+// Read once per volume, even when it fails, so a later lookup does not pay
+// for the same volume again.
+static VOID
+AbReadVolumeLabel(VOLUME_ENTRY *Entry) {
   EFI_STATUS Status;
-  EFI_HANDLE *Handles = NULL;
-  UINTN HandleCount = 0;
-  CHAR16 PartitionLabel[64];
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem = NULL;
+  EFI_FILE_PROTOCOL *Root = NULL;
+  UINT8 Buffer[SIZE_OF_EFI_FILE_SYSTEM_VOLUME_LABEL + AB_VOLUME_LABEL_CHARS * sizeof(CHAR16)];
+  UINTN BufferSize;
+  UINT64 StartUs;
 
-  if (Handle == NULL || Label == NULL) {
-    return EFI_INVALID_PARAMETER;
+  if (Entry->LabelRead) {
+    return;
   }
+  Entry->LabelRead = TRUE;
+  StartUs = AbClockNowUs();
 
-  *Handle = NULL;
-
-  Status = AbEnumerateFatPartitions(&Handles, &HandleCount);
-  if (EFI_ERROR(Status)) {
-    return Status;
+  Status = gBS->HandleProtocol(Entry->Handle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&FileSystem);
+  if (!EFI_ERROR(Status)) {
+    Status = FileSystem->OpenVolume(FileSystem, &Root);
   }
-
-  for (UINTN i = 0; i < HandleCount; i++) {
-    Status = AbGetPartitionLabel(Handles[i], PartitionLabel, sizeof(PartitionLabel));
+  if (!EFI_ERROR(Status)) {
+    ZeroMem(Buffer, sizeof(Buffer));
+    BufferSize = sizeof(Buffer) - sizeof(CHAR16);
+    Status = Root->GetInfo(Root, &gEfiFileSystemVolumeLabelInfoIdGuid, &BufferSize, Buffer);
     if (!EFI_ERROR(Status)) {
-      if (StrCmp(Label, PartitionLabel) == 0) {
-        *Handle = Handles[i];
-        FreePool(Handles);
-        return EFI_SUCCESS;
-      }
+      StrnCpyS(Entry->VolumeLabel, ARRAY_SIZE(Entry->VolumeLabel),
+               ((EFI_FILE_SYSTEM_VOLUME_LABEL *)Buffer)->VolumeLabel, AB_VOLUME_LABEL_CHARS - 1);
     }
+    Root->Close(Root);
   }
 
-  FreePool(Handles);
-  return EFI_NOT_FOUND;
+  mVolumeIndex.LabelsRead++;
+  mVolumeIndex.LabelUs += AbClockNowUs() - StartUs;
+}
+
+// FAT stores labels upper case and GPT names are typed by hand, so names
+// compare without case.
+static BOOLEAN
+AbStrEqualsNoCase(
+    CONST CHAR16 *First,
+    CONST CHAR16 *Second) {
+  while (*First != L'\0' && CharToUpper(*First) == CharToUpper(*Second)) {
+    ++First;
+    ++Second;
+  }
+  return *First == L'\0' && *Second == L'\0';
 }
 
+// A spec names a volume by partition GUID, GPT partition name, file system
+// label or the generated PARTxx/BLKxxxxxxxx name. Everything but the label
+// is checked first; labels are then read one volume at a time until one
+// matches. Volumes that already failed to open are passed over.
 static EFI_STATUS
-AbGetPartitionLabel(
-    EFI_HANDLE Handle,
-    CHAR16 *Label,
-    UINTN LabelSize) {
+AbFindPartitionByLabel(
+    CONST CHAR16 *Label,
+    EFI_HANDLE *Handle) {
   EFI_STATUS Status;
-  EFI_BLOCK_IO_PROTOCOL *BlockIo = NULL;
-  EFI_DEVICE_PATH_PROTOCOL *DevicePath = NULL;
-  EFI_DEVICE_PATH_PROTOCOL *Node = NULL;
+  VOLUME_ENTRY *Entry;
+  EFI_GUID Guid;
+  BOOLEAN IsGuid;
+  UINTN Index;
 
-  if (Label == NULL || LabelSize == 0) {
+  if (Handle == NULL || Label == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  Label[0] = L'\0';
+  *Handle = NULL;
 
-  // Try to get partition label from device path
-  Status = gBS->HandleProtocol(
-      Handle,
-      &gEfiDevicePathProtocolGuid,
-      (VOID **)&DevicePath);
+  Status = AbBuildVolumeIndex();
   if (EFI_ERROR(Status)) {
     return Status;
   }
 
-  Node = DevicePath;
-  while (!IsDevicePathEnd(Node)) {
-    if (DevicePathType(Node) == MEDIA_DEVICE_PATH &&
-        DevicePathSubType(Node) == MEDIA_PARTITION_DP) {
-      HARDDRIVE_DEVICE_PATH *HdNode = (HARDDRIVE_DEVICE_PATH *)Node;
-      // For now, return a generic label. In a full implementation,
-      // you might want to read the partition table or filesystem
-      UnicodeSPrint(Label, LabelSize, L"PART%02X", HdNode->PartitionNumber);
-      return EFI_SUCCESS;
+  IsGuid = !RETURN_ERROR(StrToGuid(Label, &Guid));
+  for (Index = 0; Index < mVolumeIndex.Count && *Handle == NULL; ++Index) {
+    Entry = &mVolumeIndex.Entries[Index];
+    if (Entry->OpenFailed) {
+      continue;
+    }
+    if ((IsGuid && Entry->HasGuid && CompareGuid(&Guid, &Entry->PartitionGuid)) ||
+        (Entry->GptName[0] != L'\0' && AbStrEqualsNoCase(Label, Entry->GptName)) ||
+        StrCmp(Label, Entry->LegacyName) == 0) {
+      *Handle = Entry->Handle;
     }
-    Node = NextDevicePathNode(Node);
   }
-
-  // Fallback: try to get from BlockIo
-  Status = gBS->HandleProtocol(
-      Handle,
-      &gEfiBlockIoProtocolGuid,
-      (VOID **)&BlockIo);
-  if (EFI_ERROR(Status)) {
-    return Status;
+  for (Index = 0; Index < mVolumeIndex.Count && *Handle == NULL; ++Index) {
+    Entry = &mVolumeIndex.Entries[Index];
+    if (Entry->OpenFailed) {
+      continue;
+    }
+    AbReadVolumeLabel(Entry);
+    if (Entry->VolumeLabel[0] != L'\0' && AbStrEqualsNoCase(Label, Entry->VolumeLabel)) {
+      *Handle = Entry->Handle;
+    }
   }
 
-  // Use media ID as label
-  UnicodeSPrint(Label, LabelSize, L"BLK%08X", BlockIo->Media->MediaId);
-  return EFI_SUCCESS;
+  DEBUG((DEBUG_INFO, "Volume '%s' %a: %u volumes indexed in %lu us, %u labels read in %lu us\n",
+         Label, *Handle != NULL ? "found" : "not found", (UINT32)mVolumeIndex.Count, mVolumeIndex.BuildUs,
+         mVolumeIndex.LabelsRead, mVolumeIndex.LabelUs));
+  return *Handle != NULL ? EFI_SUCCESS : EFI_NOT_FOUND;
 }
 
 static EFI_STATUS
@@ -1979,6 +4053,7 @@ AbLoadAnimationConfig(
   CHAR8 *Json = NULL;
   UINT32 Length = 0;
   CHAR8 PathBuffer[256];
+  JSON_KEY_TABLE Keys;
 
   if (Config == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -1996,8 +4071,13 @@ AbLoadAnimationConfig(
     return EFI_SUCCESS;
   }
 
-  // Parse config JSON
-  if (AbJsonReadString(Json, "animation_path", PathBuffer, sizeof(PathBuffer))) {
+  // A malformed file is treated like an empty one so defaults still apply.
+  if (EFI_ERROR(AbJsonTokenize(Json, Length, &Keys, NULL))) {
+    DEBUG((DEBUG_WARN, "config.json is not a JSON object, using defaults\n"));
+    Keys.Count = 0;
+  }
+
+  if (AbJsonGetString(&Keys, "animation_path", PathBuffer, sizeof(PathBuffer))) {
     Config->AnimationPath = AbAsciiPathToUnicode(PathBuffer);
     Config->UseCustomPartition = (StrStr(Config->AnimationPath, L":") != NULL);
   } else {
@@ -2005,7 +4085,7 @@ AbLoadAnimationConfig(
     Config->UseCustomPartition = FALSE;
   }
 
-  if (AbJsonReadString(Json, "manifest_path", PathBuffer, sizeof(PathBuffer))) {
+  if (AbJsonGetString(&Keys, "manifest_path", PathBuffer, sizeof(PathBuffer))) {
     Config->ManifestPath = AbAsciiPathToUnicode(PathBuffer);
     if (!Config->UseCustomPartition) {
       Config->UseCustomPartition = (StrStr(Config->ManifestPath, L":") != NULL);
@@ -2014,6 +4094,8 @@ AbLoadAnimationConfig(
     Config->ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
   }
 
+  AbJsonGetBool(&Keys, "trace", &Config->Trace);
+
   FreePool(Json);
   return EFI_SUCCESS;
 }
@@ -2035,6 +4117,290 @@ AbFreeAnimationConfig(ANIMATION_CONFIG *Config) {
   }
 
   Config->UseCustomPartition = FALSE;
+  Config->UsePlan = FALSE;
+  Config->SavePlan = FALSE;
+  Config->Trace = FALSE;
+}
+
+static VOID
+AbLoadConfigOrDefaults(
+    EFI_FILE_PROTOCOL *Root,
+    ANIMATION_CONFIG *Config) {
+  EFI_STATUS Status;
+
+  Status = AbLoadAnimationConfig(Root, Config);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "Failed to load animation config: %r\n", Status));
+    // Fall back to default behavior
+    Config->AnimationPath = AbDuplicateString(DEFAULT_PACKAGE_PATH);
+    Config->ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
+    Config->UseCustomPartition = FALSE;
+    Config->UsePlan = FALSE;
+    Config->Trace = FALSE;
+  }
+  // Only the package config.json resolves to gets a plan. A fallback that
+  // saved one would keep matching config.json and hide the configured
+  // package from every later boot.
+  Config->SavePlan = TRUE;
+}
+
+static VOID
+AbGetFileIdentity(
+    EFI_FILE_PROTOCOL *Root,
+    CONST CHAR16 *Path,
+    FILE_IDENTITY *Identity) {
+  EFI_STATUS Status;
+  EFI_FILE_PROTOCOL *File = NULL;
+  EFI_FILE_INFO *Info;
+
+  ZeroMem(Identity, sizeof(*Identity));
+  Identity->Size = MAX_UINT64;
+  if (Root == NULL) {
+    return;
+  }
+  Status = Root->Open(Root, &File, (CHAR16 *)Path, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  Info = FileHandleGetInfo(File, &gEfiFileInfoGuid);
+  if (Info != NULL) {
+    Identity->Size = Info->FileSize;
+    CopyMem(&Identity->Time, &Info->ModificationTime, sizeof(EFI_TIME));
+    FreePool(Info);
+  }
+  File->Close(File);
+}
+
+// The file the running image was loaded from. When it was not loaded from
+// a plain file path, the loaded image size stands in, which still catches
+// most rebuilds.
+static VOID
+AbGetImageIdentity(
+    EFI_FILE_PROTOCOL *Root,
+    CONST EFI_LOADED_IMAGE_PROTOCOL *LoadedImage,
+    FILE_IDENTITY *Identity) {
+  CONST FILEPATH_DEVICE_PATH *FilePath;
+
+  ZeroMem(Identity, sizeof(*Identity));
+  FilePath = (CONST FILEPATH_DEVICE_PATH *)LoadedImage->FilePath;
+  if (FilePath != NULL && DevicePathType(&FilePath->Header) == MEDIA_DEVICE_PATH &&
+      DevicePathSubType(&FilePath->Header) == MEDIA_FILEPATH_DP) {
+    AbGetFileIdentity(Root, FilePath->PathName, Identity);
+  }
+  if (Identity->Size == MAX_UINT64 || Identity->Size == 0) {
+    ZeroMem(Identity, sizeof(*Identity));
+    Identity->Size = LoadedImage->ImageSize;
+  }
+}
+
+static UINT32
+AbCrc32(
+    CONST VOID *Data,
+    UINTN Size) {
+  UINT32 Crc = 0;
+
+  if (Data == NULL || Size == 0 || EFI_ERROR(gBS->CalculateCrc32((VOID *)Data, Size, &Crc))) {
+    return 0;
+  }
+  return Crc;
+}
+
+// Accepts the plan only when it is well formed and config.json is the one
+// it was built from; the package itself is checked once it is open.
+static EFI_STATUS
+AbLoadBootPlan(ANIMATION_CONFIG *Config) {
+  EFI_STATUS Status;
+  BOOT_PLAN *Plan;
+  UINTN Size = AB_BOOT_PLAN_MAX_BYTES;
+  UINT32 Attributes;
+  EFI_DEVICE_PATH_PROTOCOL *Node;
+  UINTN Walked;
+  CONST CHAR16 *Path;
+
+  ZeroMem(Config, sizeof(*Config));
+  Plan = AllocateZeroPool(AB_BOOT_PLAN_MAX_BYTES);
+  if (Plan == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = gRT->GetVariable(AB_BOOT_PLAN_VARIABLE, &mBootPlanGuid, &Attributes, &Size, Plan);
+  if (EFI_ERROR(Status)) {
+    FreePool(Plan);
+    return Status;
+  }
+
+  Status = EFI_COMPROMISED_DATA;
+  if ((Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0 || Size < sizeof(BOOT_PLAN) ||
+      Plan->Version != AB_BOOT_PLAN_VERSION || Plan->Size != Size ||
+      Plan->PlaybackSize != sizeof(PLAYBACK_CONFIG) ||
+      Plan->DevicePathSize < sizeof(EFI_DEVICE_PATH_PROTOCOL) || Plan->PathSize < 2 * sizeof(CHAR16) ||
+      (Plan->PathSize % sizeof(CHAR16)) != 0 ||
+      (UINT64)sizeof(BOOT_PLAN) + Plan->DevicePathSize + Plan->PathSize != Size) {
+    goto Invalid;
+  }
+  // The device path has to end exactly where the plan says it does.
+  Node = (EFI_DEVICE_PATH_PROTOCOL *)(Plan + 1);
+  Walked = 0;
+  while (Walked + sizeof(EFI_DEVICE_PATH_PROTOCOL) <= Plan->DevicePathSize && !IsDevicePathEnd(Node)) {
+    if (DevicePathNodeLength(Node) < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+      goto Invalid;
+    }
+    Walked += DevicePathNodeLength(Node);
+    Node = NextDevicePathNode(Node);
+  }
+  if (Walked + sizeof(EFI_DEVICE_PATH_PROTOCOL) != Plan->DevicePathSize) {
+    goto Invalid;
+  }
+  Path = (CONST CHAR16 *)((UINT8 *)(Plan + 1) + Plan->DevicePathSize);
+  if (Path[Plan->PathSize / sizeof(CHAR16) - 1] != L'\0' || Path[0] == L'\0') {
+    goto Invalid;
+  }
+
+  if (CompareMem(&Plan->Image, &mImageIdentity, sizeof(FILE_IDENTITY)) != 0) {
+    DEBUG((DEBUG_INFO, "Boot plan: AnimeBoot.efi changed\n"));
+    Status = EFI_NOT_FOUND;
+    goto Invalid;
+  }
+  if (CompareMem(&Plan->Config, &mConfigIdentity, sizeof(FILE_IDENTITY)) != 0) {
+    DEBUG((DEBUG_INFO, "Boot plan: config.json changed\n"));
+    Status = EFI_NOT_FOUND;
+    goto Invalid;
+  }
+
+  Config->AnimationPath = AbDuplicateString(Path);
+  Config->ManifestPath = AbDuplicateString(DEFAULT_MANIFEST_PATH);
+  if (Config->AnimationPath == NULL || Config->ManifestPath == NULL) {
+    AbFreeAnimationConfig(Config);
+    FreePool(Plan);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Config->UsePlan = TRUE;
+  Config->Trace = Plan->Trace;
+  mBootPlan = Plan;
+  return EFI_SUCCESS;
+
+Invalid:
+  FreePool(Plan);
+  AbDeleteBootPlan();
+  return Status;
+}
+
+static EFI_STATUS
+AbOpenPlanVolume(EFI_FILE_PROTOCOL **Root) {
+  EFI_STATUS Status;
+  EFI_DEVICE_PATH_PROTOCOL *Remaining;
+  EFI_HANDLE Volume = NULL;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem = NULL;
+
+  if (mBootPlan == NULL) {
+    return EFI_NOT_STARTED;
+  }
+  // Only the exact volume will do, not one that merely shares a prefix.
+  Remaining = (EFI_DEVICE_PATH_PROTOCOL *)(mBootPlan + 1);
+  Status = gBS->LocateDevicePath(&gEfiSimpleFileSystemProtocolGuid, &Remaining, &Volume);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if (!IsDevicePathEnd(Remaining)) {
+    return EFI_NOT_FOUND;
+  }
+  Status = gBS->HandleProtocol(Volume, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&FileSystem);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  return FileSystem->OpenVolume(FileSystem, Root);
+}
+
+// Stands in for manifest parsing when the package header and manifest are
+// the ones the plan was built from. The frame table is validated either way.
+static EFI_STATUS
+AbApplyBootPlan(
+    ANIM_PACKAGE_STATE *Package,
+    PLAYBACK_CONFIG *Config) {
+  if (mBootPlan == NULL) {
+    return EFI_NOT_STARTED;
+  }
+  if (mBootPlan->Package.Size != Package->FileSize ||
+      CompareMem(&mBootPlan->Package.Time, &Package->ModificationTime, sizeof(EFI_TIME)) != 0 ||
+      mBootPlan->HeaderCrc != AbCrc32(&Package->Header, sizeof(Package->Header)) ||
+      mBootPlan->ManifestCrc != AbCrc32(Package->ManifestJson, Package->ManifestSize)) {
+    DEBUG((DEBUG_INFO, "Boot plan: package changed\n"));
+    return EFI_NOT_FOUND;
+  }
+  CopyMem(Config, &mBootPlan->Playback, sizeof(PLAYBACK_CONFIG));
+  return EFI_SUCCESS;
+}
+
+// Written only on a boot that had no usable plan, so the variable store
+// sees a write when an input changes rather than on every boot.
+static VOID
+AbSaveBootPlan(
+    EFI_HANDLE Volume,
+    CONST CHAR16 *FilePath,
+    CONST ANIM_PACKAGE_STATE *Package,
+    CONST PLAYBACK_CONFIG *Config,
+    BOOLEAN Trace) {
+  EFI_STATUS Status;
+  EFI_DEVICE_PATH_PROTOCOL *DevicePath;
+  BOOT_PLAN *Plan;
+  UINTN DevicePathSize;
+  UINTN PathSize;
+  UINTN Size;
+  UINT64 SetupUs;
+
+  SetupUs = AbClockNowUs() - mStartUs;
+  DevicePath = DevicePathFromHandle(Volume);
+  if (DevicePath == NULL) {
+    return;
+  }
+  DevicePathSize = GetDevicePathSize(DevicePath);
+  PathSize = StrSize(FilePath);
+  Size = sizeof(BOOT_PLAN) + DevicePathSize + PathSize;
+  if (Size > AB_BOOT_PLAN_MAX_BYTES) {
+    return;
+  }
+  Plan = AllocateZeroPool(Size);
+  if (Plan == NULL) {
+    return;
+  }
+
+  Plan->Version = AB_BOOT_PLAN_VERSION;
+  Plan->Size = (UINT32)Size;
+  Plan->DevicePathSize = (UINT32)DevicePathSize;
+  Plan->PathSize = (UINT32)PathSize;
+  Plan->PlaybackSize = sizeof(PLAYBACK_CONFIG);
+  CopyMem(&Plan->Image, &mImageIdentity, sizeof(FILE_IDENTITY));
+  CopyMem(&Plan->Config, &mConfigIdentity, sizeof(FILE_IDENTITY));
+  Plan->Package.Size = Package->FileSize;
+  CopyMem(&Plan->Package.Time, &Package->ModificationTime, sizeof(EFI_TIME));
+  Plan->HeaderCrc = AbCrc32(&Package->Header, sizeof(Package->Header));
+  Plan->ManifestCrc = AbCrc32(Package->ManifestJson, Package->ManifestSize);
+  Plan->Trace = Trace;
+  Plan->SetupUs = SetupUs;
+  CopyMem(&Plan->Playback, Config, sizeof(PLAYBACK_CONFIG));
+  CopyMem(Plan + 1, DevicePath, DevicePathSize);
+  CopyMem((UINT8 *)(Plan + 1) + DevicePathSize, FilePath, PathSize);
+
+  Status = gRT->SetVariable(
+      AB_BOOT_PLAN_VARIABLE,
+      &mBootPlanGuid,
+      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+      Size,
+      Plan);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_WARN, "Boot plan not saved: %r\n", Status));
+  } else {
+    DEBUG((DEBUG_INFO, "Boot plan saved (%u bytes), playback set up %lu us after start\n", (UINT32)Size, SetupUs));
+  }
+  FreePool(Plan);
+}
+
+static VOID
+AbDeleteBootPlan(VOID) {
+  if (mBootPlan != NULL) {
+    FreePool(mBootPlan);
+    mBootPlan = NULL;
+  }
+  gRT->SetVariable(AB_BOOT_PLAN_VARIABLE, &mBootPlanGuid, 0, 0, NULL);
 }
 
 
@@ -0,0 +1,13 @@
+// No splash frame. Replace this file with the output of
+//   abtool poster <package.anim> AnimeBootPkg/Application/AnimeBoot/SplashFrame.c
+// to show a poster frame before the animation is loaded.
+
+#include "SplashFrame.h"
+
+CONST UINT32  gAbSplashWidth = 0;
+CONST UINT32  gAbSplashHeight = 0;
+CONST BOOLEAN gAbSplashSelectMode = FALSE;
+CONST CHAR8   gAbSplashScaling[16] = "letterbox";
+CONST CHAR8   gAbSplashScaleFilter[16] = "auto";
+CONST UINT32  gAbSplashSize = 0;
+CONST UINT8   gAbSplashData[1] = { 0 };
@@ -0,0 +1,24 @@
+#ifndef ANIMEBOOT_SPLASH_FRAME_H_
+#define ANIMEBOOT_SPLASH_FRAME_H_
+
+#include <Uefi.h>
+
+// Poster frame linked into AnimeBoot.efi and shown before any file is read.
+// SplashFrame.c is replaced by the output of `abtool poster`; the copy in
+// the tree carries no frame (gAbSplashSize is 0).
+//
+// gAbSplashData is one LZ4 block expanding to gAbSplashWidth x
+// gAbSplashHeight top-down BGRA32 pixels, as in an LZ4 package frame.
+
+// Upper bound on what a poster may add to the binary.
+#define AB_MAX_SPLASH_BYTES  (256U * 1024U)
+
+extern CONST UINT32  gAbSplashWidth;
+extern CONST UINT32  gAbSplashHeight;
+extern CONST BOOLEAN gAbSplashSelectMode;
+extern CONST CHAR8   gAbSplashScaling[16];
+extern CONST CHAR8   gAbSplashScaleFilter[16];
+extern CONST UINT32  gAbSplashSize;
+extern CONST UINT8   gAbSplashData[];
+
+#endif  // ANIMEBOOT_SPLASH_FRAME_H_
@@ -17,10 +17,12 @@ typedef struct {
   UINT32  FrameDataOffset;
   UINT32  LogicalWidth;
   UINT32  LogicalHeight;
-  UINT32  PixelFormat;      // 0 = BGRA32 raw, 1 = BMP 32bpp
+  UINT32  PixelFormat;      // ANIM_PIXEL_FORMAT
   UINT32  TargetFps;
   UINT32  LoopCount;
-  UINT32  Reserved[6];
+  UINT32  RectTableOffset;  // ANIM_FRAME_RECT per frame, 1.1+ with ANIM_PACKAGE_FLAG_FRAME_RECTS
+  UINT32  HotPrefixSize;    // 1.2+ with ANIM_PACKAGE_FLAG_HOT_PREFIX
+  UINT32  Reserved[4];
 } ANIM_PACKAGE_HEADER;
 
 typedef struct {
@@ -29,15 +31,33 @@ typedef struct {
   UINT32 DurationUs;
 } ANIM_FRAME_DESC;
 
+// Where a frame's payload goes on the screen image; the rest keeps what the
+// previous frame left there. The payload is a Width x Height image.
+typedef struct {
+  UINT16 X;
+  UINT16 Y;
+  UINT16 Width;
+  UINT16 Height;
+} ANIM_FRAME_RECT;
+
 #pragma pack(pop)
 
 #define ANIM_PACKAGE_MAGIC       "ABANIM\0"
 #define ANIM_PACKAGE_VERSION_MAJ 1
-#define ANIM_PACKAGE_VERSION_MIN 0
+#define ANIM_PACKAGE_VERSION_MIN 2
+
+#define ANIM_PACKAGE_FLAG_MANIFEST     BIT0
+#define ANIM_PACKAGE_FLAG_RAW_FRAMES   BIT1
+#define ANIM_PACKAGE_FLAG_FRAME_RECTS  BIT2   // Frame 0 full size, later frames partial
+// Header, manifest, tables and frame 0 fill the first HotPrefixSize bytes,
+// a whole number of sectors, so a single read is enough to show frame 0.
+#define ANIM_PACKAGE_FLAG_HOT_PREFIX   BIT3
 
 typedef enum {
-  AnimPixelFormatBgra32 = 0,
-  AnimPixelFormatBmp32  = 1
+  AnimPixelFormatBgra32    = 0,
+  AnimPixelFormatBmp32     = 1,
+  AnimPixelFormatLz4Bgra32 = 2,   // LZ4 block of a top-down, unpadded BGRA32 frame
+  AnimPixelFormatCount
 } ANIM_PIXEL_FORMAT;
 
 typedef struct {
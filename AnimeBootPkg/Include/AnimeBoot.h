@@ -17,12 +17,6 @@
 
 #include "AnimFormat.h"
 
-typedef struct {
-  EFI_GRAPHICS_OUTPUT_PROTOCOL *Gop;
-  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *OriginalMode;
-  UINT32 OriginalModeIndex;
-} GOP_STATE;
-
 typedef struct {
   UINT32 Width;
   UINT32 Height;
@@ -30,6 +24,58 @@ typedef struct {
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels;
 } FRAME_BUFFER;
 
+// Copy of what the last blit put on screen, used to send only changed tiles.
+typedef struct {
+  FRAME_BUFFER *Shadow;
+  UINT32 DestX;
+  UINT32 DestY;
+  UINT8  *TileMap;
+  UINT32 TilesX;
+  UINT32 TilesY;
+  UINT32 FullBlits;
+  UINT32 PartialBlits;
+  UINT32 SkippedBlits;
+  UINT32 RectsSent;
+  UINT64 PixelsSent;
+  UINT64 PixelsPresented;
+} DIRTY_TRACKER;
+
+// Mode framebuffer as captured when direct writes were enabled.
+typedef struct {
+  UINT8  *Base;
+  UINTN  Size;
+  UINT32 Mode;
+  UINT32 Width;
+  UINT32 Height;
+  UINT32 PixelsPerScanLine;
+  UINT32 BytesPerPixel;
+  EFI_GRAPHICS_PIXEL_FORMAT Format;
+  UINT8  Shift[3];           // Red, green, blue position for PixelBitMask
+  UINT8  Bits[3];
+  UINT8  *RowBuffer;         // One converted scanline for non-BGR formats
+} LINEAR_FRAMEBUFFER;
+
+typedef struct {
+  UINT32 Frames;
+  UINT64 TotalUs;
+  UINT64 MaxUs;
+} BLIT_TIMING;
+
+typedef struct {
+  EFI_GRAPHICS_OUTPUT_PROTOCOL *Gop;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *OriginalMode;
+  UINT32 OriginalModeIndex;
+  UINT32 PanelWidth;         // EDID preferred timing, 0 when unknown
+  UINT32 PanelHeight;
+  UINT32 ModeSwitches;
+  UINT64 ModeSwitchUs;       // Total time spent in SetMode
+  DIRTY_TRACKER Dirty;
+  BOOLEAN DirectWrite;
+  LINEAR_FRAMEBUFFER Linear;
+  BLIT_TIMING GopTiming;
+  BLIT_TIMING DirectTiming;
+} GOP_STATE;
+
 typedef struct {
   EFI_FILE_PROTOCOL *Root;
   CHAR16 *BasePath;
@@ -39,6 +85,9 @@ typedef struct {
   CHAR16 *AnimationPath;     // Path to animation file (can include partition spec)
   CHAR16 *ManifestPath;      // Path to manifest file (can include partition spec)
   BOOLEAN UseCustomPartition; // Whether to use custom partition instead of EFI partition
+  BOOLEAN UsePlan;           // Volume, path and playback settings come from the boot plan
+  BOOLEAN SavePlan;          // Record a boot plan once playback is set up
+  BOOLEAN Trace;             // Write a phase trace to \EFI\AnimeBoot\trace.json
 } ANIMATION_CONFIG;
 
 #endif  // ANIMEBOOT_MAIN_H_
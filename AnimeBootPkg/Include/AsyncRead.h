@@ -0,0 +1,58 @@
+#ifndef ANIMEBOOT_ASYNC_READ_H_
+#define ANIMEBOOT_ASYNC_READ_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+//
+// One outstanding file read. On revision 2 file protocols the read is issued
+// through ReadEx with an event token and completes in the background;
+// otherwise it is a plain blocking Read that is already complete on return.
+//
+typedef struct {
+  EFI_FILE_PROTOCOL *File;
+  BOOLEAN           CloseFile;   // Close File once the read has completed
+  BOOLEAN           Pending;
+  EFI_STATUS        Status;      // Final status once no longer Pending
+  UINTN             Length;
+  UINT64            IssuedUs;
+  EFI_FILE_IO_TOKEN Token;       // Token.Event is created once and reused
+} ASYNC_READ;
+
+typedef struct {
+  UINT32 Reads;
+  UINT32 AsyncReads;
+  UINT64 Bytes;
+  UINT64 InFlightUs;         // Wall time with at least one read outstanding
+  UINT64 ReadUs;             // Sum of issue-to-completion times
+  UINT64 BlockedUs;          // Time the caller spent waiting on reads
+} ASYNC_READ_STATS;
+
+VOID
+AbAsyncReadReset(BOOLEAN AllowAsync);
+
+EFI_STATUS
+AbAsyncReadIssue(
+  ASYNC_READ *Read,
+  EFI_FILE_PROTOCOL *File,
+  UINT64 Offset,
+  VOID *Buffer,
+  UINTN Length,
+  BOOLEAN CloseFile
+  );
+
+// TRUE once the read is no longer pending; Read->Status then holds the result.
+BOOLEAN
+AbAsyncReadPoll(ASYNC_READ *Read);
+
+EFI_STATUS
+AbAsyncReadWait(ASYNC_READ *Read);
+
+// Waits out a pending read and releases the token event.
+VOID
+AbAsyncReadFree(ASYNC_READ *Read);
+
+VOID
+AbAsyncReadGetStats(ASYNC_READ_STATS *Stats);
+
+#endif  // ANIMEBOOT_ASYNC_READ_H_
@@ -0,0 +1,39 @@
+#ifndef ANIMEBOOT_BMP_DECODE_H_
+#define ANIMEBOOT_BMP_DECODE_H_
+
+#include "AnimeBoot.h"
+
+typedef enum {
+  AbBmpKernelCopy32 = 0,     // 32bpp rows are already BGRA: one CopyMem each
+  AbBmpKernelExpand24,       // 24bpp, portable scalar loop
+  AbBmpKernelExpand24Ssse3,  // 24bpp, PSHUFB eight pixels per step (X64)
+  AbBmpKernelCount
+} AB_BMP_KERNEL;
+
+typedef struct {
+  UINT32 Frames;
+  UINT64 Bytes;              // Decoded BGRA bytes
+  UINT64 Cycles;             // AbClockCycles spent in the kernel
+} BMP_KERNEL_STATS;
+
+// Picks the 24bpp kernel for this CPU. Call on the BSP before decoding.
+VOID
+AbBmpDecodeInit(VOID);
+
+CONST CHAR8 *
+AbBmpKernelName(AB_BMP_KERNEL Kernel);
+
+//
+// Decodes an uncompressed 24/32bpp BMP, top-down or bottom-up, whose size
+// matches Target. Pure CPU work, safe to run on an AP. Kernel reports which
+// row kernel did the work.
+//
+EFI_STATUS
+AbBmpDecode(
+  CONST UINT8 *Payload,
+  UINTN PayloadSize,
+  FRAME_BUFFER *Target,
+  AB_BMP_KERNEL *Kernel
+  );
+
+#endif  // ANIMEBOOT_BMP_DECODE_H_
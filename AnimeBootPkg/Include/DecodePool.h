@@ -0,0 +1,55 @@
+#ifndef ANIMEBOOT_DECODE_POOL_H_
+#define ANIMEBOOT_DECODE_POOL_H_
+
+#include <Uefi.h>
+
+// Pure CPU work: may run on an AP, so no boot services, DEBUG or pool calls.
+typedef EFI_STATUS (*DECODE_ROUTINE)(VOID *Job);
+
+typedef enum {
+  AbDecodeTaskIdle = 0,
+  AbDecodeTaskQueued,
+  AbDecodeTaskRunning,
+  AbDecodeTaskDone
+} AB_DECODE_TASK_STATE;
+
+typedef struct {
+  DECODE_ROUTINE      Routine;
+  VOID                *Job;
+  volatile UINT32     State;   // AB_DECODE_TASK_STATE
+  volatile EFI_STATUS Status;
+  UINT32              QueueIndex;
+} DECODE_TASK;
+
+typedef struct {
+  UINT32 Workers;            // APs taking tasks, 0 when decoding on the BSP
+  UINT32 DecodedOnAps;
+  UINT32 DecodedOnBsp;
+} DECODE_POOL_STATS;
+
+//
+// Parks up to MaxWorkers application processors in a polling loop that takes
+// decode tasks from a small shared queue. The BSP keeps doing file I/O and
+// blits; without MP services every task simply runs inline on submit.
+//
+EFI_STATUS
+AbDecodePoolStart(UINT32 MaxWorkers);
+
+VOID
+AbDecodePoolStop(VOID);
+
+VOID
+AbDecodeSubmit(
+  DECODE_TASK *Task,
+  DECODE_ROUTINE Routine,
+  VOID *Job
+  );
+
+// Runs the task on the BSP if no AP has claimed it yet.
+EFI_STATUS
+AbDecodeWait(DECODE_TASK *Task);
+
+VOID
+AbDecodePoolGetStats(DECODE_POOL_STATS *Stats);
+
+#endif  // ANIMEBOOT_DECODE_POOL_H_
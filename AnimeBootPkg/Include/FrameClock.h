@@ -0,0 +1,106 @@
+#ifndef ANIMEBOOT_FRAME_CLOCK_H_
+#define ANIMEBOOT_FRAME_CLOCK_H_
+
+#include <Uefi.h>
+
+typedef enum {
+  AbClockSourceNone = 0,
+  AbClockSourceTsc,
+  AbClockSourceTimestamp
+} AB_CLOCK_SOURCE;
+
+//
+// Absolute-deadline presentation scheduler. Deadlines are accumulated from
+// the nominal frame durations rather than from the time a frame actually
+// went out, so decode/blit cost never stretches the timeline.
+//
+typedef struct {
+  BOOLEAN Started;
+  BOOLEAN AllowDrop;
+  UINT32  TargetFps;          // 0 = use FrameDurationUs as-is
+  UINT32  FrameDurationUs;
+  UINT32  FpsRemainder;       // carried fraction of 1000000 / TargetFps
+  UINT32  ConsecutiveDrops;
+  UINT64  StartUs;
+  UINT64  NextDeadlineUs;
+  UINT32  FramesPresented;
+  UINT32  FramesLate;
+  UINT32  FramesDropped;
+  UINT32  Resyncs;
+  UINT64  MaxLatenessUs;
+  EFI_EVENT Timer;            // One-shot timer for halting until a deadline
+  UINT64  WakeSlackUs;        // How early to wake before spinning to the deadline
+  UINT64  HaltedUs;
+} FRAME_SCHEDULER;
+
+EFI_STATUS
+AbClockInit(VOID);
+
+AB_CLOCK_SOURCE
+AbClockSource(VOID);
+
+UINT64
+AbClockNowUs(VOID);
+
+// Raw cycle counter, safe to read on an AP; 0 where there is none.
+UINT64
+AbClockCycles(VOID);
+
+// Converts an AbClockCycles interval on the BSP, 0 if its rate is unknown.
+UINT64
+AbClockCyclesToUs(UINT64 Cycles);
+
+VOID
+AbSchedulerInit(
+  FRAME_SCHEDULER *Scheduler,
+  UINT32 TargetFps,
+  UINT32 FrameDurationUs,
+  BOOLEAN AllowDrop
+  );
+
+UINT32
+AbSchedulerResolveDuration(
+  FRAME_SCHEDULER *Scheduler,
+  UINT32 DurationUs
+  );
+
+BOOLEAN
+AbSchedulerShouldDrop(
+  FRAME_SCHEDULER *Scheduler,
+  UINT32 DurationUs
+  );
+
+VOID
+AbSchedulerDropFrame(
+  FRAME_SCHEDULER *Scheduler,
+  UINT32 DurationUs
+  );
+
+VOID
+AbSchedulerFree(FRAME_SCHEDULER *Scheduler);
+
+BOOLEAN
+AbSchedulerWaitForDeadline(
+  FRAME_SCHEDULER *Scheduler,
+  EFI_EVENT WakeEvent
+  );
+
+VOID
+AbSchedulerFramePresented(
+  FRAME_SCHEDULER *Scheduler,
+  UINT32 DurationUs
+  );
+
+UINT64
+AbSchedulerTimeToDeadlineUs(FRAME_SCHEDULER *Scheduler);
+
+UINT64
+AbSchedulerElapsedUs(FRAME_SCHEDULER *Scheduler);
+
+BOOLEAN
+AbSchedulerBudgetExhausted(
+  FRAME_SCHEDULER *Scheduler,
+  UINT64 BudgetUs
+  );
+
+#endif  // ANIMEBOOT_FRAME_CLOCK_H_
@@ -0,0 +1,67 @@
+#ifndef ANIMEBOOT_FRAME_SCALER_H_
+#define ANIMEBOOT_FRAME_SCALER_H_
+
+#include "AnimeBoot.h"
+#include "DisplayMath.h"
+
+typedef enum {
+  AbScaleModeLetterbox = 0,
+  AbScaleModeCenter,
+  AbScaleModeFill
+} AB_SCALE_MODE;
+
+typedef enum {
+  AbScaleFilterAuto = 0,     // Replicate on integer ratios, bilinear otherwise
+  AbScaleFilterNearest,
+  AbScaleFilterBilinear
+} AB_SCALE_FILTER;
+
+//
+// Maps logical frames onto the screen. Index and weight tables are built once
+// per playback; each frame is then resampled into a screen-sized staging
+// buffer whose Output window (View) is what gets presented.
+//
+typedef struct {
+  BOOLEAN         Active;    // FALSE when frames can be blitted unscaled
+  AB_SCALE_FILTER Filter;
+  FRAME_RECT      Source;    // Window of the logical frame that is shown
+  FRAME_RECT      Output;    // Where it lands on screen
+  UINT32          ReplicateX;  // Integer factors, 0 when resampling
+  UINT32          ReplicateY;
+  UINT32          *ColIndex;   // Per output column: source X
+  UINT16          *ColWeight;  // Bilinear weight of ColIndex + 1, 0..256
+  UINT32          *RowIndex;   // Per output row: source Y
+  UINT16          *RowWeight;
+  UINT32          *HorzRows[2];  // Bilinear: source rows already filtered in X
+  UINT32          HorzRowIndex[2];
+  FRAME_BUFFER    *Staging;
+  FRAME_BUFFER    View;
+} FRAME_SCALER;
+
+AB_SCALE_MODE
+AbScaleModeFromName(CONST CHAR8 *Name);
+
+AB_SCALE_FILTER
+AbScaleFilterFromName(CONST CHAR8 *Name);
+
+EFI_STATUS
+AbScalerInit(
+  FRAME_SCALER *Scaler,
+  UINT32 ScreenWidth,
+  UINT32 ScreenHeight,
+  UINT32 FrameWidth,
+  UINT32 FrameHeight,
+  AB_SCALE_MODE Mode,
+  AB_SCALE_FILTER Filter
+  );
+
+VOID
+AbScaleFrame(
+  FRAME_SCALER *Scaler,
+  CONST FRAME_BUFFER *Frame
+  );
+
+VOID
+AbScalerFree(FRAME_SCALER *Scaler);
+
+#endif  // ANIMEBOOT_FRAME_SCALER_H_
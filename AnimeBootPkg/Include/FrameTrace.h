@@ -0,0 +1,50 @@
+#ifndef ANIMEBOOT_FRAME_TRACE_H_
+#define ANIMEBOOT_FRAME_TRACE_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define AB_TRACE_NO_ARG  0xFFFFFFFFU
+
+//
+// Phase timestamps for Chrome/Perfetto ("traceEvents", complete events).
+// Events recorded before AbTraceStart/AbTraceStop land in a small static
+// buffer so startup phases are kept once config.json turns tracing on; they
+// stay pinned while per-frame events wrap around the rest of the ring.
+//
+typedef struct {
+  CONST CHAR8 *Name;         // Must be a string literal
+  UINT64      StartUs;
+  UINT64      DurationUs;
+  UINT32      Arg;           // Frame index, or AB_TRACE_NO_ARG
+} TRACE_EVENT;
+
+EFI_STATUS
+AbTraceStart(UINT32 Capacity);
+
+VOID
+AbTraceStop(VOID);
+
+UINT64
+AbTraceBegin(VOID);
+
+VOID
+AbTraceEnd(
+  CONST CHAR8 *Name,
+  UINT64 StartUs,
+  UINT32 Arg
+  );
+
+VOID
+AbTraceInstant(
+  CONST CHAR8 *Name,
+  UINT32 Arg
+  );
+
+EFI_STATUS
+AbTraceFlush(
+  EFI_FILE_PROTOCOL *Root,
+  CONST CHAR16 *Path
+  );
+
+#endif  // ANIMEBOOT_FRAME_TRACE_H_
@@ -2,6 +2,12 @@
 #define ANIMEBOOT_GOP_BLITTER_H_
 
 #include "AnimeBoot.h"
+#include "DisplayMath.h"
+
+#define AB_DIRTY_TILE_WIDTH         64U
+#define AB_DIRTY_TILE_HEIGHT        16U
+#define AB_MAX_DIRTY_RECTS          32U
+#define AB_DIRTY_FULL_BLIT_PERCENT  50U
 
 EFI_STATUS
 AbInitGopState(GOP_STATE *State);
@@ -9,6 +15,13 @@ AbInitGopState(GOP_STATE *State);
 VOID
 AbRestoreGopState(GOP_STATE *State);
 
+EFI_STATUS
+AbSelectGopMode(
+  GOP_STATE *State,
+  UINT32 FrameWidth,
+  UINT32 FrameHeight
+  );
+
 EFI_STATUS
 AbAllocateFrameBuffer(
   UINT32 Width,
@@ -29,6 +42,41 @@ AbBlitFrame(
   UINT32 DestY
   );
 
+EFI_STATUS
+AbBlitFrameDirty(
+  GOP_STATE *State,
+  FRAME_BUFFER *Frame,
+  UINT32 DestX,
+  UINT32 DestY
+  );
+
+// Bytes AbBlitFrameDirty keeps allocated (shadow and tile map) while it
+// tracks frames of this size.
+UINT64
+AbDirtyTrackerFootprint(
+  UINT32 Width,
+  UINT32 Height
+  );
+
+// Sends only Rect of Frame, for callers that already know what changed.
+EFI_STATUS
+AbBlitFrameRect(
+  GOP_STATE *State,
+  FRAME_BUFFER *Frame,
+  CONST FRAME_RECT *Rect,
+  UINT32 DestX,
+  UINT32 DestY
+  );
+
+VOID
+AbResetDirtyTracking(GOP_STATE *State);
+
+EFI_STATUS
+AbEnableDirectWrite(GOP_STATE *State);
+
+VOID
+AbDisableDirectWrite(GOP_STATE *State);
+
 VOID
 AbSwapBuffers(
   FRAME_BUFFER **Front,
@@ -0,0 +1,116 @@
+#ifndef ANIMEBOOT_JSON_TOKEN_H_
+#define ANIMEBOOT_JSON_TOKEN_H_
+
+#include <Uefi.h>
+
+#define AB_JSON_MAX_KEYS   32
+#define AB_JSON_MAX_DEPTH  64
+
+typedef enum {
+  JsonString,
+  JsonNumber,
+  JsonTrue,
+  JsonFalse,
+  JsonNull,
+  JsonObject,
+  JsonArray
+} JSON_TYPE;
+
+//
+// One member of an object. Name and Value point into the document, which
+// must outlive the table; nothing is copied or terminated.
+//
+typedef struct {
+  CONST CHAR8 *Name;
+  UINT32      NameLength;
+  JSON_TYPE   Type;
+  CONST CHAR8 *Value;        // Strings: after the opening quote; containers: the bracket
+  UINT32      ValueLength;   // Strings: raw bytes before the closing quote; containers: through the closing bracket
+  UINT32      Count;         // Arrays: element count
+} JSON_KEY;
+
+typedef struct {
+  JSON_KEY Keys[AB_JSON_MAX_KEYS];
+  UINT32   Count;
+  UINT32   Dropped;          // Members past AB_JSON_MAX_KEYS, not recorded
+} JSON_KEY_TABLE;
+
+typedef struct {
+  CONST CHAR8 *Next;
+  CONST CHAR8 *End;          // The closing bracket
+  UINT32      Index;
+  UINT32      Count;
+} JSON_ARRAY_CURSOR;
+
+//
+// Tokenizes the object at the start of Json (leading whitespace allowed) in
+// one pass, recording its members in Table. Nested objects and arrays are
+// checked for balance and string-aware, so brackets or key names inside
+// strings never confuse them, and are recorded as a single member. Nothing is
+// allocated. Fails with EFI_COMPROMISED_DATA on malformed input; Consumed,
+// when given, receives the bytes up to and including the closing brace.
+//
+EFI_STATUS
+AbJsonTokenize(
+  CONST CHAR8 *Json,
+  UINTN Length,
+  JSON_KEY_TABLE *Table,
+  UINTN *Consumed
+  );
+
+//
+// Returns the first member called Name, or NULL.
+//
+CONST JSON_KEY *
+AbJsonFind(
+  CONST JSON_KEY_TABLE *Table,
+  CONST CHAR8 *Name
+  );
+
+//
+// Typed reads. Each returns FALSE, leaving the output untouched, when the
+// member is missing or has another type. Numbers must be non-negative
+// integers that fit in 64 bits. Strings have their escapes decoded and must
+// fit in BufferSize including the terminator.
+//
+BOOLEAN
+AbJsonGetUint(
+  CONST JSON_KEY_TABLE *Table,
+  CONST CHAR8 *Name,
+  UINT64 *Value
+  );
+
+BOOLEAN
+AbJsonGetBool(
+  CONST JSON_KEY_TABLE *Table,
+  CONST CHAR8 *Name,
+  BOOLEAN *Value
+  );
+
+BOOLEAN
+AbJsonGetString(
+  CONST JSON_KEY_TABLE *Table,
+  CONST CHAR8 *Name,
+  CHAR8 *Buffer,
+  UINTN BufferSize
+  );
+
+BOOLEAN
+AbJsonGetArray(
+  CONST JSON_KEY_TABLE *Table,
+  CONST CHAR8 *Name,
+  JSON_ARRAY_CURSOR *Cursor
+  );
+
+//
+// Tokenizes the next element of an array of objects into Object, in place.
+// Returns EFI_NOT_FOUND after the last element and EFI_COMPROMISED_DATA if
+// an element is not an object.
+//
+EFI_STATUS
+AbJsonNextObject(
+  JSON_ARRAY_CURSOR *Cursor,
+  JSON_KEY_TABLE *Object
+  );
+
+#endif  // ANIMEBOOT_JSON_TOKEN_H_
@@ -0,0 +1,29 @@
+#ifndef ANIMEBOOT_LZ4_DECODE_H_
+#define ANIMEBOOT_LZ4_DECODE_H_
+
+#include <Uefi.h>
+
+typedef struct {
+  UINT32 Frames;
+  UINT64 InputBytes;         // Compressed bytes consumed
+  UINT64 OutputBytes;        // BGRA bytes produced
+  UINT64 Cycles;             // AbClockCycles spent decoding
+} LZ4_DECODE_STATS;
+
+//
+// Decodes one LZ4 block (the raw block format, no frame header or checksums)
+// into Destination. Every literal run, match offset and match length is
+// checked against both buffers, so a corrupt block fails with
+// EFI_COMPROMISED_DATA instead of reading or writing out of bounds. Pure CPU
+// work, safe to run on an AP.
+//
+EFI_STATUS
+AbLz4DecodeBlock(
+  CONST UINT8 *Source,
+  UINTN SourceSize,
+  UINT8 *Destination,
+  UINTN DestinationSize,
+  UINTN *DecodedSize
+  );
+
+#endif  // ANIMEBOOT_LZ4_DECODE_H_
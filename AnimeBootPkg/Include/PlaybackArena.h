@@ -0,0 +1,54 @@
+#ifndef ANIMEBOOT_PLAYBACK_ARENA_H_
+#define ANIMEBOOT_PLAYBACK_ARENA_H_
+
+#include "AnimeBoot.h"
+
+#define AB_ARENA_ALIGNMENT  64U
+
+// Bytes one allocation of Size takes from the arena, padding included.
+#define AB_ARENA_FOOTPRINT(Size)  ALIGN_VALUE((UINT64)(Size), AB_ARENA_ALIGNMENT)
+
+//
+// Per-playback bump allocator. All frame and payload memory is reserved from
+// AllocatePages once before the first frame and released in one piece at the
+// end, so the playback loop never touches the pool. Nothing is zeroed: every
+// buffer handed out is fully overwritten before it is read.
+//
+typedef struct {
+  UINT8  *Base;
+  UINTN  Pages;
+  UINT64 Size;
+  UINT64 Used;               // Only grows, so it is also the high-water mark
+} PLAYBACK_ARENA;
+
+EFI_STATUS
+AbArenaInit(
+  PLAYBACK_ARENA *Arena,
+  UINT64 Size
+  );
+
+VOID
+AbArenaFree(PLAYBACK_ARENA *Arena);
+
+// Cache-line aligned; NULL once the reservation is used up.
+VOID *
+AbArenaAlloc(
+  PLAYBACK_ARENA *Arena,
+  UINT64 Size
+  );
+
+UINT64
+AbArenaFrameFootprint(
+  UINT32 Width,
+  UINT32 Height
+  );
+
+EFI_STATUS
+AbArenaAllocFrame(
+  PLAYBACK_ARENA *Arena,
+  UINT32 Width,
+  UINT32 Height,
+  FRAME_BUFFER **Frame
+  );
+
+#endif  // ANIMEBOOT_PLAYBACK_ARENA_H_
@@ -0,0 +1,168 @@
+#include "AsyncRead.h"
+#include "FrameClock.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+static BOOLEAN          mAllowAsync = TRUE;
+static UINT32           mInFlight = 0;
+static UINT64           mBusySinceUs = 0;
+static ASYNC_READ_STATS mStats;
+
+static VOID
+AbAsyncReadStarted(UINT64 NowUs) {
+  if (mInFlight++ == 0) {
+    mBusySinceUs = NowUs;
+  }
+}
+
+static VOID
+AbAsyncReadRelease(ASYNC_READ *Read) {
+  if (Read->CloseFile && Read->File != NULL) {
+    Read->File->Close(Read->File);
+  }
+  Read->File = NULL;
+  Read->CloseFile = FALSE;
+}
+
+static VOID
+AbAsyncReadComplete(
+    ASYNC_READ *Read,
+    EFI_STATUS Status,
+    UINTN Bytes) {
+  UINT64 NowUs;
+
+  NowUs = AbClockNowUs();
+  if (!EFI_ERROR(Status) && Bytes != Read->Length) {
+    Status = EFI_DEVICE_ERROR;
+  }
+  Read->Status = Status;
+  Read->Pending = FALSE;
+
+  mStats.ReadUs += NowUs - Read->IssuedUs;
+  if (!EFI_ERROR(Status)) {
+    mStats.Bytes += Bytes;
+  }
+  if (--mInFlight == 0) {
+    mStats.InFlightUs += NowUs - mBusySinceUs;
+  }
+  AbAsyncReadRelease(Read);
+}
+
+VOID
+AbAsyncReadReset(BOOLEAN AllowAsync) {
+  mAllowAsync = AllowAsync;
+  mInFlight = 0;
+  mBusySinceUs = 0;
+  ZeroMem(&mStats, sizeof(mStats));
+}
+
+EFI_STATUS
+AbAsyncReadIssue(
+    ASYNC_READ *Read,
+    EFI_FILE_PROTOCOL *File,
+    UINT64 Offset,
+    VOID *Buffer,
+    UINTN Length,
+    BOOLEAN CloseFile) {
+  EFI_STATUS Status;
+  UINTN Bytes;
+  UINT64 StartUs;
+
+  if (Read == NULL || File == NULL || Buffer == NULL || Read->Pending) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Read->File = File;
+  Read->CloseFile = CloseFile;
+  Read->Length = Length;
+  Read->Status = EFI_NOT_READY;
+
+  Status = File->SetPosition(File, Offset);
+  if (EFI_ERROR(Status)) {
+    AbAsyncReadRelease(Read);
+    Read->Status = Status;
+    return Status;
+  }
+
+  StartUs = AbClockNowUs();
+  Read->IssuedUs = StartUs;
+  mStats.Reads++;
+
+  if (mAllowAsync && File->Revision >= EFI_FILE_PROTOCOL_REVISION2) {
+    if (Read->Token.Event == NULL &&
+        EFI_ERROR(gBS->CreateEvent(0, 0, NULL, NULL, &Read->Token.Event))) {
+      Read->Token.Event = NULL;
+    }
+    if (Read->Token.Event != NULL) {
+      Read->Token.Status = EFI_NOT_READY;
+      Read->Token.BufferSize = Length;
+      Read->Token.Buffer = Buffer;
+      Status = File->ReadEx(File, &Read->Token);
+      if (!EFI_ERROR(Status)) {
+        Read->Pending = TRUE;
+        mStats.AsyncReads++;
+        AbAsyncReadStarted(StartUs);
+        return EFI_SUCCESS;
+      }
+      // Revision 2 is advertised but ReadEx is refused; stay synchronous.
+      mAllowAsync = FALSE;
+    }
+  }
+
+  AbAsyncReadStarted(StartUs);
+  Bytes = Length;
+  Status = File->Read(File, &Bytes, Buffer);
+  AbAsyncReadComplete(Read, Status, Bytes);
+  mStats.BlockedUs += AbClockNowUs() - StartUs;
+  return Read->Status;
+}
+
+BOOLEAN
+AbAsyncReadPoll(ASYNC_READ *Read) {
+  if (!Read->Pending) {
+    return TRUE;
+  }
+  if (gBS->CheckEvent(Read->Token.Event) != EFI_SUCCESS) {
+    return FALSE;
+  }
+  AbAsyncReadComplete(Read, Read->Token.Status, Read->Token.BufferSize);
+  return TRUE;
+}
+
+EFI_STATUS
+AbAsyncReadWait(ASYNC_READ *Read) {
+  UINT64 StartUs;
+  UINTN Index;
+
+  if (AbAsyncReadPoll(Read)) {
+    return Read->Status;
+  }
+
+  StartUs = AbClockNowUs();
+  gBS->WaitForEvent(1, &Read->Token.Event, &Index);
+  mStats.BlockedUs += AbClockNowUs() - StartUs;
+  AbAsyncReadComplete(Read, Read->Token.Status, Read->Token.BufferSize);
+  return Read->Status;
+}
+
+VOID
+AbAsyncReadFree(ASYNC_READ *Read) {
+  if (Read == NULL) {
+    return;
+  }
+  if (Read->Pending) {
+    AbAsyncReadWait(Read);
+  }
+  AbAsyncReadRelease(Read);
+  if (Read->Token.Event != NULL) {
+    gBS->CloseEvent(Read->Token.Event);
+    Read->Token.Event = NULL;
+  }
+}
+
+VOID
+AbAsyncReadGetStats(ASYNC_READ_STATS *Stats) {
+  CopyMem(Stats, &mStats, sizeof(mStats));
+}
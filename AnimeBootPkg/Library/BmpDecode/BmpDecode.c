@@ -0,0 +1,207 @@
+#include "BmpDecode.h"
+
+#include <IndustryStandard/Bmp.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (_MSC_VER))
+#define AB_BMP_HAVE_SSSE3  1
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#define AB_BMP_MIN_INFO_HEADER_SIZE  40U
+#define AB_CPUID_ECX_SSSE3           BIT9
+
+static AB_BMP_KERNEL mExpand24 = AbBmpKernelExpand24;
+
+#ifdef AB_BMP_HAVE_SSSE3
+// Four BGR triplets to four BGRA pixels; alpha is OR-ed in afterwards.
+static CONST UINT8 mBgrShuffle[16] = {
+  0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80
+};
+static CONST UINT8 mAlphaMask[16] = {
+  0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF
+};
+#endif
+
+static VOID
+AbBmpExpand24(
+    CONST UINT8 *Source,
+    UINT32 *Dest,
+    UINTN Count) {
+  UINTN Index;
+
+  for (Index = 0; Index < Count; ++Index, Source += 3) {
+    Dest[Index] = (UINT32)Source[0] |
+        ((UINT32)Source[1] << 8) |
+        ((UINT32)Source[2] << 16) |
+        0xFF000000U;
+  }
+}
+
+#ifdef AB_BMP_HAVE_SSSE3
+static VOID
+AbBmpExpand24Ssse3(
+    CONST UINT8 *Source,
+    UINT32 *Dest,
+    UINTN Count) {
+  UINTN Steps;
+
+  // Each step converts 24 bytes but loads 28, so the last two pixels of a
+  // row always go through the scalar tail and nothing past the row is read.
+  Steps = (Count >= 2) ? (Count - 2) / 8 : 0;
+  if (Steps > 0) {
+#if defined (__GNUC__)
+    CONST UINT8 *In = Source;
+    UINT32 *Out = Dest;
+    UINTN Left = Steps;
+
+    __asm__ __volatile__ (
+        "movdqu (%[shuffle]), %%xmm6\n\t"
+        "movdqu (%[alpha]), %%xmm7\n\t"
+        "1:\n\t"
+        "movdqu (%[in]), %%xmm0\n\t"
+        "movdqu 12(%[in]), %%xmm1\n\t"
+        "pshufb %%xmm6, %%xmm0\n\t"
+        "pshufb %%xmm6, %%xmm1\n\t"
+        "por %%xmm7, %%xmm0\n\t"
+        "por %%xmm7, %%xmm1\n\t"
+        "movdqu %%xmm0, (%[out])\n\t"
+        "movdqu %%xmm1, 16(%[out])\n\t"
+        "add $24, %[in]\n\t"
+        "add $32, %[out]\n\t"
+        "dec %[left]\n\t"
+        "jnz 1b\n\t"
+        : [in] "+r" (In), [out] "+r" (Out), [left] "+r" (Left)
+        : [shuffle] "r" (mBgrShuffle), [alpha] "r" (mAlphaMask)
+        : "xmm0", "xmm1", "xmm6", "xmm7", "memory", "cc");
+#else
+    __m128i Shuffle = _mm_loadu_si128((CONST __m128i *)mBgrShuffle);
+    __m128i Alpha = _mm_loadu_si128((CONST __m128i *)mAlphaMask);
+    UINTN Step;
+
+    for (Step = 0; Step < Steps; ++Step) {
+      __m128i Lo = _mm_loadu_si128((CONST __m128i *)(Source + Step * 24));
+      __m128i Hi = _mm_loadu_si128((CONST __m128i *)(Source + Step * 24 + 12));
+      _mm_storeu_si128((__m128i *)(Dest + Step * 8), _mm_or_si128(_mm_shuffle_epi8(Lo, Shuffle), Alpha));
+      _mm_storeu_si128((__m128i *)(Dest + Step * 8 + 4), _mm_or_si128(_mm_shuffle_epi8(Hi, Shuffle), Alpha));
+    }
+#endif
+  }
+  AbBmpExpand24(Source + Steps * 24, Dest + Steps * 8, Count - Steps * 8);
+}
+#endif
+
+VOID
+AbBmpDecodeInit(VOID) {
+#ifdef AB_BMP_HAVE_SSSE3
+  UINT32 Ecx;
+
+  AsmCpuid(1, NULL, NULL, &Ecx, NULL);
+  mExpand24 = ((Ecx & AB_CPUID_ECX_SSSE3) != 0) ? AbBmpKernelExpand24Ssse3 : AbBmpKernelExpand24;
+#else
+  mExpand24 = AbBmpKernelExpand24;
+#endif
+}
+
+CONST CHAR8 *
+AbBmpKernelName(AB_BMP_KERNEL Kernel) {
+  switch (Kernel) {
+    case AbBmpKernelCopy32:
+      return "copy32";
+    case AbBmpKernelExpand24:
+      return "expand24";
+    case AbBmpKernelExpand24Ssse3:
+      return "expand24-ssse3";
+    default:
+      return "none";
+  }
+}
+
+EFI_STATUS
+AbBmpDecode(
+    CONST UINT8 *Payload,
+    UINTN PayloadSize,
+    FRAME_BUFFER *Target,
+    AB_BMP_KERNEL *Kernel) {
+  CONST BMP_IMAGE_HEADER *Bmp;
+  CONST UINT8 *Source;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dest;
+  INT32 Height;
+  INTN SourceStride;
+  UINTN RowSize;
+  UINTN RowBytes;
+  UINT32 Row;
+
+  if (Payload == NULL || Target == NULL || Kernel == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (PayloadSize < sizeof(BMP_IMAGE_HEADER)) {
+    return EFI_COMPROMISED_DATA;
+  }
+
+  Bmp = (CONST BMP_IMAGE_HEADER *)Payload;
+  if (Bmp->CharB != 'B' || Bmp->CharM != 'M') {
+    return EFI_UNSUPPORTED;
+  }
+  if (Bmp->HeaderSize < AB_BMP_MIN_INFO_HEADER_SIZE ||
+      (Bmp->BitPerPixel != 24 && Bmp->BitPerPixel != 32) ||
+      Bmp->CompressionType != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  // Negative heights mark top-down images.
+  Height = (INT32)Bmp->PixelHeight;
+  if (Bmp->PixelWidth != Target->Width ||
+      Height == MIN_INT32 ||
+      (UINT32)((Height < 0) ? -Height : Height) != Target->Height) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  RowSize = (((UINTN)Bmp->BitPerPixel * Target->Width + 31) / 32) * 4;
+  if (Bmp->ImageOffset >= PayloadSize ||
+      (UINT64)RowSize * Target->Height > PayloadSize - Bmp->ImageOffset) {
+    return EFI_COMPROMISED_DATA;
+  }
+
+  Source = Payload + Bmp->ImageOffset;
+  SourceStride = (INTN)RowSize;
+  if (Height > 0) {
+    Source += RowSize * (Target->Height - 1);
+    SourceStride = -SourceStride;
+  }
+  Dest = Target->Pixels;
+  RowBytes = (UINTN)Target->Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
+  if (Bmp->BitPerPixel == 32) {
+    *Kernel = AbBmpKernelCopy32;
+    if (Height < 0 && Target->PitchPixels == Target->Width) {
+      CopyMem(Dest, Source, RowBytes * Target->Height);
+      return EFI_SUCCESS;
+    }
+    for (Row = 0; Row < Target->Height; ++Row) {
+      CopyMem(Dest, Source, RowBytes);
+      Source += SourceStride;
+      Dest += Target->PitchPixels;
+    }
+    return EFI_SUCCESS;
+  }
+
+  *Kernel = mExpand24;
+  for (Row = 0; Row < Target->Height; ++Row) {
+#ifdef AB_BMP_HAVE_SSSE3
+    if (mExpand24 == AbBmpKernelExpand24Ssse3) {
+      AbBmpExpand24Ssse3(Source, (UINT32 *)Dest, Target->Width);
+    } else {
+      AbBmpExpand24(Source, (UINT32 *)Dest, Target->Width);
+    }
+#else
+    AbBmpExpand24(Source, (UINT32 *)Dest, Target->Width);
+#endif
+    Source += SourceStride;
+    Dest += Target->PitchPixels;
+  }
+  return EFI_SUCCESS;
+}
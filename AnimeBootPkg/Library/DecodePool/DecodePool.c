@@ -0,0 +1,192 @@
+#include "DecodePool.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/MpService.h>
+
+// Comfortably above the ring depth, so submitting never has to wait.
+#define AB_DECODE_QUEUE_SIZE  16U
+
+static EFI_MP_SERVICES_PROTOCOL *mMp = NULL;
+static EFI_EVENT                 mWorkersDone = NULL;
+static UINT32                    mMaxWorkers = 0;
+static UINT32                    mWorkers = 0;
+static volatile UINT32           mJoined = 0;
+static volatile UINT32           mQuit = 0;
+static volatile UINT32           mDecodedOnAps = 0;
+static UINT32                    mDecodedOnBsp = 0;
+static DECODE_TASK *volatile     mQueue[AB_DECODE_QUEUE_SIZE];
+
+static VOID
+AbDecodeRun(DECODE_TASK *Task) {
+  Task->State = AbDecodeTaskRunning;
+  Task->Status = Task->Routine(Task->Job);
+  MemoryFence();
+  Task->State = AbDecodeTaskDone;
+}
+
+// Whoever swaps the queue entry back to NULL owns the task, AP or BSP.
+static BOOLEAN
+AbDecodeClaim(
+    UINT32 Index,
+    DECODE_TASK *Task) {
+  return InterlockedCompareExchangePointer(
+      (VOID *volatile *)&mQueue[Index], Task, NULL) == Task;
+}
+
+static VOID
+EFIAPI
+AbDecodeWorker(VOID *Buffer) {
+  DECODE_TASK *Task;
+  UINT32 Index;
+
+  // StartupAllAPs wakes every enabled AP; the surplus leaves at once.
+  if (InterlockedIncrement(&mJoined) > mMaxWorkers) {
+    return;
+  }
+
+  while (mQuit == 0) {
+    for (Index = 0; Index < AB_DECODE_QUEUE_SIZE; Index++) {
+      Task = mQueue[Index];
+      if (Task != NULL && AbDecodeClaim(Index, Task)) {
+        AbDecodeRun(Task);
+        InterlockedIncrement(&mDecodedOnAps);
+      }
+    }
+    CpuPause();
+  }
+}
+
+EFI_STATUS
+AbDecodePoolStart(UINT32 MaxWorkers) {
+  EFI_STATUS Status;
+  EFI_MP_SERVICES_PROTOCOL *Mp = NULL;
+  UINTN Processors;
+  UINTN Enabled;
+
+  if (mMp != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  ZeroMem((VOID *)mQueue, sizeof(mQueue));
+  mWorkers = 0;
+  mJoined = 0;
+  mQuit = 0;
+  mDecodedOnAps = 0;
+  mDecodedOnBsp = 0;
+  if (MaxWorkers == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (VOID **)&Mp);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = Mp->GetNumberOfProcessors(Mp, &Processors, &Enabled);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if (Enabled < 2) {
+    return EFI_NOT_STARTED;
+  }
+
+  Status = gBS->CreateEvent(0, 0, NULL, NULL, &mWorkersDone);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  mMaxWorkers = (UINT32)MIN((UINTN)MaxWorkers, Enabled - 1);
+  MemoryFence();
+
+  // Non-blocking: the APs stay in AbDecodeWorker until AbDecodePoolStop.
+  Status = Mp->StartupAllAPs(Mp, AbDecodeWorker, FALSE, mWorkersDone, 0, NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    gBS->CloseEvent(mWorkersDone);
+    mWorkersDone = NULL;
+    return Status;
+  }
+
+  mMp = Mp;
+  mWorkers = mMaxWorkers;
+  return EFI_SUCCESS;
+}
+
+VOID
+AbDecodePoolStop(VOID) {
+  UINTN Index;
+
+  if (mMp == NULL) {
+    mWorkers = 0;
+    return;
+  }
+
+  mQuit = 1;
+  MemoryFence();
+
+  // The MP driver notices finished APs on its own timer, so this can take
+  // up to one of its polling periods.
+  gBS->WaitForEvent(1, &mWorkersDone, &Index);
+  gBS->CloseEvent(mWorkersDone);
+  mWorkersDone = NULL;
+  mMp = NULL;
+  mWorkers = 0;
+}
+
+VOID
+AbDecodeSubmit(
+    DECODE_TASK *Task,
+    DECODE_ROUTINE Routine,
+    VOID *Job) {
+  UINT32 Index;
+
+  Task->Routine = Routine;
+  Task->Job = Job;
+  Task->Status = EFI_NOT_READY;
+
+  if (mWorkers > 0) {
+    // Only the BSP fills entries, so a NULL seen here stays free.
+    for (Index = 0; Index < AB_DECODE_QUEUE_SIZE; Index++) {
+      if (mQueue[Index] == NULL) {
+        Task->QueueIndex = Index;
+        Task->State = AbDecodeTaskQueued;
+        MemoryFence();
+        mQueue[Index] = Task;
+        return;
+      }
+    }
+  }
+
+  AbDecodeRun(Task);
+  mDecodedOnBsp++;
+}
+
+EFI_STATUS
+AbDecodeWait(DECODE_TASK *Task) {
+  EFI_STATUS Status;
+
+  if (Task->State == AbDecodeTaskIdle) {
+    return EFI_NOT_STARTED;
+  }
+
+  if (Task->State == AbDecodeTaskQueued && AbDecodeClaim(Task->QueueIndex, Task)) {
+    AbDecodeRun(Task);
+    mDecodedOnBsp++;
+  }
+  while (Task->State != AbDecodeTaskDone) {
+    CpuPause();
+  }
+  MemoryFence();
+
+  Status = Task->Status;
+  Task->State = AbDecodeTaskIdle;
+  return Status;
+}
+
+VOID
+AbDecodePoolGetStats(DECODE_POOL_STATS *Stats) {
+  Stats->Workers = mWorkers;
+  Stats->DecodedOnAps = mDecodedOnAps;
+  Stats->DecodedOnBsp = mDecodedOnBsp;
+}
@@ -0,0 +1,406 @@
+#include "FrameClock.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/Timestamp.h>
+
+#define AB_CLOCK_CALIBRATION_US        10000U
+#define AB_SCHEDULER_LATE_TOLERANCE_US 2000U
+#define AB_SCHEDULER_RESYNC_US         500000U
+#define AB_SCHEDULER_MAX_DROPS         4U
+#define AB_SCHEDULER_POLL_US           1000U
+#define AB_SCHEDULER_WAKE_MARGIN_US    1000U
+// Typical platform timer tick; refined from observed timer overshoot.
+#define AB_SCHEDULER_INITIAL_SLACK_US  10000U
+
+static AB_CLOCK_SOURCE         mClockSource = AbClockSourceNone;
+static BOOLEAN                 mClockReady = FALSE;
+static UINT64                  mClockFrequency = 0;
+static UINT64                  mClockEndValue = 0;
+static UINT64                  mClockLastTicks = 0;
+static UINT64                  mClockElapsedTicks = 0;
+static UINT64                  mSoftwareUs = 0;
+static EFI_TIMESTAMP_PROTOCOL *mTimestamp = NULL;
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+static BOOLEAN
+AbHasInvariantTsc(VOID) {
+  UINT32 MaxExtended;
+  UINT32 Edx;
+
+  AsmCpuid(0x80000000, &MaxExtended, NULL, NULL, NULL);
+  if (MaxExtended < 0x80000007) {
+    return FALSE;
+  }
+  AsmCpuid(0x80000007, NULL, NULL, NULL, &Edx);
+  return (Edx & BIT8) != 0;
+}
+
+static UINT64
+AbCalibrateTsc(VOID) {
+  UINT64 Start;
+  UINT64 End;
+
+  Start = AsmReadTsc();
+  gBS->Stall(AB_CLOCK_CALIBRATION_US);
+  End = AsmReadTsc();
+  if (End <= Start) {
+    return 0;
+  }
+  return DivU64x32(MultU64x32(End - Start, 1000000U), AB_CLOCK_CALIBRATION_US);
+}
+#endif
+
+static UINT64
+AbClockReadTicks(VOID) {
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  if (mClockSource == AbClockSourceTsc) {
+    return AsmReadTsc();
+  }
+#endif
+  if (mClockSource == AbClockSourceTimestamp) {
+    return mTimestamp->GetTimestamp();
+  }
+  return 0;
+}
+
+EFI_STATUS
+AbClockInit(VOID) {
+  EFI_STATUS Status;
+  EFI_TIMESTAMP_PROPERTIES Properties;
+  BOOLEAN InvariantTsc = FALSE;
+
+  if (mClockReady) {
+    return EFI_SUCCESS;
+  }
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  InvariantTsc = AbHasInvariantTsc();
+  if (InvariantTsc) {
+    mClockFrequency = AbCalibrateTsc();
+    if (mClockFrequency != 0) {
+      mClockSource = AbClockSourceTsc;
+    }
+  }
+#endif
+
+  if (mClockSource == AbClockSourceNone) {
+    Status = gBS->LocateProtocol(&gEfiTimestampProtocolGuid, NULL, (VOID **)&mTimestamp);
+    if (!EFI_ERROR(Status) &&
+        !EFI_ERROR(mTimestamp->GetProperties(&Properties)) &&
+        Properties.Frequency != 0) {
+      mClockSource = AbClockSourceTimestamp;
+      mClockFrequency = Properties.Frequency;
+      mClockEndValue = Properties.EndValue;
+    }
+  }
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  // A variant TSC is still far better than summing nominal durations.
+  if (mClockSource == AbClockSourceNone && !InvariantTsc) {
+    mClockFrequency = AbCalibrateTsc();
+    if (mClockFrequency != 0) {
+      mClockSource = AbClockSourceTsc;
+    }
+  }
+#endif
+
+  mClockReady = TRUE;
+  if (mClockSource == AbClockSourceNone) {
+    DEBUG((DEBUG_WARN, "No usable monotonic clock, timing falls back to Stall\n"));
+    return EFI_UNSUPPORTED;
+  }
+
+  mClockLastTicks = AbClockReadTicks();
+  mClockElapsedTicks = 0;
+  DEBUG((DEBUG_INFO, "Clock source %u at %lu Hz (invariant TSC: %u)\n",
+         mClockSource, mClockFrequency, InvariantTsc));
+  return EFI_SUCCESS;
+}
+
+AB_CLOCK_SOURCE
+AbClockSource(VOID) {
+  return mClockSource;
+}
+
+UINT64
+AbClockNowUs(VOID) {
+  UINT64 Ticks;
+  UINT64 Seconds;
+  UINT64 Remainder;
+
+  if (!mClockReady) {
+    AbClockInit();
+  }
+  if (mClockSource == AbClockSourceNone) {
+    return mSoftwareUs;
+  }
+
+  Ticks = AbClockReadTicks();
+  if (Ticks >= mClockLastTicks) {
+    mClockElapsedTicks += Ticks - mClockLastTicks;
+  } else if (mClockEndValue != 0) {
+    mClockElapsedTicks += (mClockEndValue - mClockLastTicks) + Ticks + 1;
+  }
+  mClockLastTicks = Ticks;
+
+  Seconds = DivU64x64Remainder(mClockElapsedTicks, mClockFrequency, &Remainder);
+  return MultU64x32(Seconds, 1000000U) +
+      DivU64x64Remainder(MultU64x32(Remainder, 1000000U), mClockFrequency, NULL);
+}
+
+UINT64
+AbClockCycles(VOID) {
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  return AsmReadTsc();
+#else
+  return 0;
+#endif
+}
+
+UINT64
+AbClockCyclesToUs(UINT64 Cycles) {
+  if (mClockSource != AbClockSourceTsc || mClockFrequency == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder(MultU64x32(Cycles, 1000000U), mClockFrequency, NULL);
+}
+
+static VOID
+AbClockStallUs(UINT64 Microseconds) {
+  if (Microseconds == 0) {
+    return;
+  }
+  gBS->Stall((UINTN)Microseconds);
+  if (mClockSource == AbClockSourceNone) {
+    mSoftwareUs += Microseconds;
+  }
+}
+
+// Halts on a one-shot timer until shortly before the deadline, then stalls in
+// short slices for precision. Returns TRUE as soon as WakeEvent is signaled.
+static BOOLEAN
+AbSchedulerWaitUntil(
+    FRAME_SCHEDULER *Scheduler,
+    UINT64 DeadlineUs,
+    EFI_EVENT WakeEvent) {
+  EFI_STATUS Status;
+  EFI_EVENT Events[2];
+  UINTN Index;
+  UINT64 Now;
+  UINT64 Remaining;
+  UINT64 Target;
+  UINT64 Overshoot;
+
+  for (;;) {
+    if (WakeEvent != NULL && !EFI_ERROR(gBS->CheckEvent(WakeEvent))) {
+      return TRUE;
+    }
+    Now = AbClockNowUs();
+    if (Now >= DeadlineUs) {
+      return FALSE;
+    }
+    Remaining = DeadlineUs - Now;
+
+    if (Scheduler->Timer == NULL || mClockSource == AbClockSourceNone ||
+        Remaining <= Scheduler->WakeSlackUs + AB_SCHEDULER_POLL_US) {
+      AbClockStallUs(MIN(Remaining, AB_SCHEDULER_POLL_US));
+      continue;
+    }
+
+    Target = DeadlineUs - Scheduler->WakeSlackUs;
+    Status = gBS->SetTimer(Scheduler->Timer, TimerRelative, MultU64x32(Target - Now, 10));
+    if (!EFI_ERROR(Status)) {
+      Events[0] = Scheduler->Timer;
+      Events[1] = WakeEvent;
+      Status = gBS->WaitForEvent((WakeEvent != NULL) ? 2 : 1, Events, &Index);
+    }
+    if (EFI_ERROR(Status)) {
+      // Not at TPL_APPLICATION or no timer support: keep stalling instead.
+      gBS->CloseEvent(Scheduler->Timer);
+      Scheduler->Timer = NULL;
+      continue;
+    }
+
+    Now = AbClockNowUs();
+    Scheduler->HaltedUs += Remaining - ((Now < DeadlineUs) ? (DeadlineUs - Now) : 0);
+    if (Index != 0) {
+      gBS->SetTimer(Scheduler->Timer, TimerCancel, 0);
+      return TRUE;
+    }
+    // Timer events fire on the platform tick, so learn how late they run.
+    Overshoot = (Now > Target) ? (Now - Target) : 0;
+    if (Overshoot + AB_SCHEDULER_WAKE_MARGIN_US > Scheduler->WakeSlackUs) {
+      Scheduler->WakeSlackUs = Overshoot + AB_SCHEDULER_WAKE_MARGIN_US;
+    } else {
+      Scheduler->WakeSlackUs = (Scheduler->WakeSlackUs * 7 + Overshoot + AB_SCHEDULER_WAKE_MARGIN_US) / 8;
+    }
+  }
+}
+
+VOID
+AbSchedulerInit(
+    FRAME_SCHEDULER *Scheduler,
+    UINT32 TargetFps,
+    UINT32 FrameDurationUs,
+    BOOLEAN AllowDrop) {
+  if (Scheduler == NULL) {
+    return;
+  }
+  AbClockInit();
+  ZeroMem(Scheduler, sizeof(*Scheduler));
+  Scheduler->TargetFps = TargetFps;
+  Scheduler->FrameDurationUs = FrameDurationUs;
+  Scheduler->AllowDrop = AllowDrop;
+  Scheduler->WakeSlackUs = AB_SCHEDULER_INITIAL_SLACK_US;
+  if (EFI_ERROR(gBS->CreateEvent(EVT_TIMER, 0, NULL, NULL, &Scheduler->Timer))) {
+    Scheduler->Timer = NULL;
+  }
+}
+
+VOID
+AbSchedulerFree(FRAME_SCHEDULER *Scheduler) {
+  if (Scheduler == NULL || Scheduler->Timer == NULL) {
+    return;
+  }
+  gBS->SetTimer(Scheduler->Timer, TimerCancel, 0);
+  gBS->CloseEvent(Scheduler->Timer);
+  Scheduler->Timer = NULL;
+}
+
+UINT32
+AbSchedulerResolveDuration(
+    FRAME_SCHEDULER *Scheduler,
+    UINT32 DurationUs) {
+  UINT32 Total;
+
+  if (Scheduler == NULL || DurationUs != 0) {
+    return DurationUs;
+  }
+  if (Scheduler->TargetFps == 0) {
+    return Scheduler->FrameDurationUs;
+  }
+  // Carry the remainder so N frames at TargetFps span exactly N/TargetFps s.
+  Total = 1000000U + Scheduler->FpsRemainder;
+  Scheduler->FpsRemainder = Total % Scheduler->TargetFps;
+  return Total / Scheduler->TargetFps;
+}
+
+BOOLEAN
+AbSchedulerShouldDrop(
+    FRAME_SCHEDULER *Scheduler,
+    UINT32 DurationUs) {
+  if (Scheduler == NULL || !Scheduler->Started || !Scheduler->AllowDrop) {
+    return FALSE;
+  }
+  if (Scheduler->ConsecutiveDrops >= AB_SCHEDULER_MAX_DROPS) {
+    return FALSE;
+  }
+  // Only drop a frame whose whole display slot has already gone by.
+  return AbClockNowUs() >= Scheduler->NextDeadlineUs + DurationUs;
+}
+
+VOID
+AbSchedulerDropFrame(
+    FRAME_SCHEDULER *Scheduler,
+    UINT32 DurationUs) {
+  if (Scheduler == NULL) {
+    return;
+  }
+  Scheduler->NextDeadlineUs += DurationUs;
+  Scheduler->ConsecutiveDrops++;
+  Scheduler->FramesDropped++;
+}
+
+BOOLEAN
+AbSchedulerWaitForDeadline(
+    FRAME_SCHEDULER *Scheduler,
+    EFI_EVENT WakeEvent) {
+  UINT64 Now;
+
+  if (Scheduler == NULL) {
+    return FALSE;
+  }
+  if (!Scheduler->Started) {
+    // The timeline starts when the first frame is ready to go out.
+    Now = AbClockNowUs();
+    Scheduler->Started = TRUE;
+    Scheduler->StartUs = Now;
+    Scheduler->NextDeadlineUs = Now;
+    return FALSE;
+  }
+  return AbSchedulerWaitUntil(Scheduler, Scheduler->NextDeadlineUs, WakeEvent);
+}
+
+VOID
+AbSchedulerFramePresented(
+    FRAME_SCHEDULER *Scheduler,
+    UINT32 DurationUs) {
+  UINT64 Now;
+  UINT64 Lateness;
+
+  if (Scheduler == NULL) {
+    return;
+  }
+  Now = AbClockNowUs();
+  Lateness = (Now > Scheduler->NextDeadlineUs) ? (Now - Scheduler->NextDeadlineUs) : 0;
+  if (Lateness > AB_SCHEDULER_LATE_TOLERANCE_US) {
+    Scheduler->FramesLate++;
+  }
+  if (Lateness > Scheduler->MaxLatenessUs) {
+    Scheduler->MaxLatenessUs = Lateness;
+  }
+
+  if (Lateness > AB_SCHEDULER_RESYNC_US) {
+    // A long stall (media spin-up, mode switch) would otherwise cause a burst
+    // of drops; restart the timeline from the frame that just went out.
+    Scheduler->NextDeadlineUs = Now + DurationUs;
+    Scheduler->Resyncs++;
+  } else {
+    Scheduler->NextDeadlineUs += DurationUs;
+  }
+  Scheduler->ConsecutiveDrops = 0;
+  Scheduler->FramesPresented++;
+}
+
+UINT64
+AbSchedulerTimeToDeadlineUs(FRAME_SCHEDULER *Scheduler) {
+  UINT64 Now;
+
+  if (Scheduler == NULL || !Scheduler->Started) {
+    return 0;
+  }
+  Now = AbClockNowUs();
+  return (Now < Scheduler->NextDeadlineUs) ? (Scheduler->NextDeadlineUs - Now) : 0;
+}
+
+UINT64
+AbSchedulerElapsedUs(FRAME_SCHEDULER *Scheduler) {
+  if (Scheduler == NULL || !Scheduler->Started) {
+    return 0;
+  }
+  return AbClockNowUs() - Scheduler->StartUs;
+}
+
+BOOLEAN
+AbSchedulerBudgetExhausted(
+    FRAME_SCHEDULER *Scheduler,
+    UINT64 BudgetUs) {
+  UINT64 Elapsed;
+
+  if (Scheduler == NULL || !Scheduler->Started || BudgetUs == 0) {
+    return FALSE;
+  }
+  Elapsed = AbSchedulerElapsedUs(Scheduler);
+  if (Elapsed >= BudgetUs) {
+    return TRUE;
+  }
+  if (Scheduler->NextDeadlineUs - Scheduler->StartUs < BudgetUs) {
+    return FALSE;
+  }
+  // The frame on screen would outlast the budget; cut it at the budget.
+  AbSchedulerWaitUntil(Scheduler, Scheduler->StartUs + BudgetUs, NULL);
+  return TRUE;
+}
@@ -0,0 +1,449 @@
+#include "FrameScaler.h"
+#include "GopBlitter.h"
+
+#include <Library/DebugLib.h>
+
+#define AB_SCALE_WEIGHT_ONE  256U
+
+static VOID
+AbCalcFillRect(
+    UINT32 ScreenWidth,
+    UINT32 ScreenHeight,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight,
+    FRAME_RECT *Source);
+
+static VOID
+AbBuildAxisTable(
+    UINT32 SourceStart,
+    UINT32 SourceLength,
+    UINT32 OutputLength,
+    BOOLEAN Bilinear,
+    UINT32 *Index,
+    UINT16 *Weight);
+
+static VOID
+AbScaleReplicate(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame);
+
+static VOID
+AbScaleNearest(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame);
+
+static VOID
+AbScaleBilinear(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame);
+
+static CONST UINT32 *
+AbFilterSourceRow(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame,
+    UINT32 SourceY,
+    CONST UINT32 *Keep);
+
+static UINT32
+AbLerpPixel(
+    UINT32 A,
+    UINT32 B,
+    UINT32 Weight);
+
+AB_SCALE_MODE
+AbScaleModeFromName(CONST CHAR8 *Name) {
+  if (Name != NULL && AsciiStrCmp(Name, "fill") == 0) {
+    return AbScaleModeFill;
+  }
+  if (Name != NULL && AsciiStrCmp(Name, "center") == 0) {
+    return AbScaleModeCenter;
+  }
+  return AbScaleModeLetterbox;
+}
+
+AB_SCALE_FILTER
+AbScaleFilterFromName(CONST CHAR8 *Name) {
+  if (Name != NULL && AsciiStrCmp(Name, "nearest") == 0) {
+    return AbScaleFilterNearest;
+  }
+  if (Name != NULL && AsciiStrCmp(Name, "bilinear") == 0) {
+    return AbScaleFilterBilinear;
+  }
+  return AbScaleFilterAuto;
+}
+
+EFI_STATUS
+AbScalerInit(
+    FRAME_SCALER *Scaler,
+    UINT32 ScreenWidth,
+    UINT32 ScreenHeight,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight,
+    AB_SCALE_MODE Mode,
+    AB_SCALE_FILTER Filter) {
+  EFI_STATUS Status;
+  FRAME_RECT *Source;
+  FRAME_RECT *Output;
+  BOOLEAN Bilinear;
+
+  if (Scaler == NULL || ScreenWidth == 0 || ScreenHeight == 0 ||
+      FrameWidth == 0 || FrameHeight == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  ZeroMem(Scaler, sizeof(*Scaler));
+  Source = &Scaler->Source;
+  Output = &Scaler->Output;
+
+  Source->Width = FrameWidth;
+  Source->Height = FrameHeight;
+  switch (Mode) {
+    case AbScaleModeFill:
+      AbCalcFillRect(ScreenWidth, ScreenHeight, FrameWidth, FrameHeight, Source);
+      Output->Width = ScreenWidth;
+      Output->Height = ScreenHeight;
+      break;
+    case AbScaleModeCenter:
+      // 1:1, cropped to the screen when the frame is larger.
+      Source->Width = MIN(FrameWidth, ScreenWidth);
+      Source->Height = MIN(FrameHeight, ScreenHeight);
+      Source->X = (FrameWidth - Source->Width) / 2;
+      Source->Y = (FrameHeight - Source->Height) / 2;
+      Output->Width = Source->Width;
+      Output->Height = Source->Height;
+      Output->X = (ScreenWidth - Output->Width) / 2;
+      Output->Y = (ScreenHeight - Output->Height) / 2;
+      break;
+    default:
+      Status = AbCalcLetterboxRect(ScreenWidth, ScreenHeight, FrameWidth, FrameHeight, Output);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      break;
+  }
+  if (Output->Width == 0 || Output->Height == 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  if (Output->Width == FrameWidth && Output->Height == FrameHeight &&
+      Source->Width == FrameWidth && Source->Height == FrameHeight) {
+    // Nothing to resample: the caller blits frames straight to Output.
+    return EFI_SUCCESS;
+  }
+
+  if (Output->Width % Source->Width == 0 && Output->Height % Source->Height == 0) {
+    Scaler->ReplicateX = Output->Width / Source->Width;
+    Scaler->ReplicateY = Output->Height / Source->Height;
+    if (Filter == AbScaleFilterBilinear && (Scaler->ReplicateX != 1 || Scaler->ReplicateY != 1)) {
+      Scaler->ReplicateX = 0;
+      Scaler->ReplicateY = 0;
+    }
+  }
+  if (Filter == AbScaleFilterAuto) {
+    Filter = AbScaleFilterBilinear;
+  }
+  if (Source->Width < 2 || Source->Height < 2) {
+    Filter = AbScaleFilterNearest;
+  }
+  Scaler->Filter = Filter;
+  Bilinear = (Filter == AbScaleFilterBilinear);
+
+  Status = AbAllocateFrameBuffer(ScreenWidth, ScreenHeight, &Scaler->Staging);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Scaler->View.Width = Output->Width;
+  Scaler->View.Height = Output->Height;
+  Scaler->View.PitchPixels = Scaler->Staging->PitchPixels;
+  Scaler->View.Pixels = Scaler->Staging->Pixels +
+      (UINTN)Output->Y * Scaler->Staging->PitchPixels + Output->X;
+
+  if (Scaler->ReplicateX == 0) {
+    Scaler->ColIndex = AllocatePool(Output->Width * sizeof(UINT32));
+    Scaler->ColWeight = AllocatePool(Output->Width * sizeof(UINT16));
+    Scaler->RowIndex = AllocatePool(Output->Height * sizeof(UINT32));
+    Scaler->RowWeight = AllocatePool(Output->Height * sizeof(UINT16));
+    if (Scaler->ColIndex == NULL || Scaler->ColWeight == NULL ||
+        Scaler->RowIndex == NULL || Scaler->RowWeight == NULL) {
+      AbScalerFree(Scaler);
+      return EFI_OUT_OF_RESOURCES;
+    }
+    AbBuildAxisTable(Source->X, Source->Width, Output->Width, Bilinear, Scaler->ColIndex, Scaler->ColWeight);
+    AbBuildAxisTable(Source->Y, Source->Height, Output->Height, Bilinear, Scaler->RowIndex, Scaler->RowWeight);
+    if (Bilinear) {
+      Scaler->HorzRows[0] = AllocatePool(Output->Width * sizeof(UINT32));
+      Scaler->HorzRows[1] = AllocatePool(Output->Width * sizeof(UINT32));
+      if (Scaler->HorzRows[0] == NULL || Scaler->HorzRows[1] == NULL) {
+        AbScalerFree(Scaler);
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+  }
+
+  Scaler->Active = TRUE;
+  DEBUG((DEBUG_INFO, "Scaling %ux%u+%u+%u -> %ux%u at %u,%u (%a)\n",
+         Source->Width, Source->Height, Source->X, Source->Y,
+         Output->Width, Output->Height, Output->X, Output->Y,
+         (Scaler->ReplicateX != 0) ? "replicate" : (Bilinear ? "bilinear" : "nearest")));
+  return EFI_SUCCESS;
+}
+
+VOID
+AbScaleFrame(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame) {
+  if (Scaler == NULL || !Scaler->Active || Frame == NULL || Frame->Pixels == NULL) {
+    return;
+  }
+  if (Scaler->ReplicateX != 0) {
+    AbScaleReplicate(Scaler, Frame);
+  } else if (Scaler->Filter == AbScaleFilterBilinear) {
+    AbScaleBilinear(Scaler, Frame);
+  } else {
+    AbScaleNearest(Scaler, Frame);
+  }
+}
+
+VOID
+AbScalerFree(FRAME_SCALER *Scaler) {
+  if (Scaler == NULL) {
+    return;
+  }
+  if (Scaler->ColIndex != NULL) {
+    FreePool(Scaler->ColIndex);
+  }
+  if (Scaler->ColWeight != NULL) {
+    FreePool(Scaler->ColWeight);
+  }
+  if (Scaler->RowIndex != NULL) {
+    FreePool(Scaler->RowIndex);
+  }
+  if (Scaler->RowWeight != NULL) {
+    FreePool(Scaler->RowWeight);
+  }
+  if (Scaler->HorzRows[0] != NULL) {
+    FreePool(Scaler->HorzRows[0]);
+  }
+  if (Scaler->HorzRows[1] != NULL) {
+    FreePool(Scaler->HorzRows[1]);
+  }
+  AbFreeFrameBuffer(&Scaler->Staging);
+  ZeroMem(Scaler, sizeof(*Scaler));
+}
+
+// Largest window of the frame with the screen's aspect ratio, centered.
+static VOID
+AbCalcFillRect(
+    UINT32 ScreenWidth,
+    UINT32 ScreenHeight,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight,
+    FRAME_RECT *Source) {
+  if ((UINT64)FrameWidth * ScreenHeight > (UINT64)ScreenWidth * FrameHeight) {
+    Source->Height = FrameHeight;
+    Source->Width = (UINT32)MAX(DivU64x32((UINT64)FrameHeight * ScreenWidth, ScreenHeight), 1);
+  } else {
+    Source->Width = FrameWidth;
+    Source->Height = (UINT32)MAX(DivU64x32((UINT64)FrameWidth * ScreenHeight, ScreenWidth), 1);
+  }
+  Source->X = (FrameWidth - Source->Width) / 2;
+  Source->Y = (FrameHeight - Source->Height) / 2;
+}
+
+// Samples at pixel centres. Bilinear entries are 24.8 fixed point split into
+// an index and the weight of the next pixel; Index + 1 is always in range.
+static VOID
+AbBuildAxisTable(
+    UINT32 SourceStart,
+    UINT32 SourceLength,
+    UINT32 OutputLength,
+    BOOLEAN Bilinear,
+    UINT32 *Index,
+    UINT16 *Weight) {
+  UINT32 Out;
+  INT64 Position;
+  INT64 Last;
+
+  Last = (INT64)(SourceLength - 1) * AB_SCALE_WEIGHT_ONE;
+  for (Out = 0; Out < OutputLength; ++Out) {
+    if (!Bilinear) {
+      Index[Out] = SourceStart +
+          (UINT32)DivU64x32((UINT64)(2 * Out + 1) * SourceLength, 2 * OutputLength);
+      Weight[Out] = 0;
+      continue;
+    }
+    Position = (INT64)DivU64x32((UINT64)(2 * Out + 1) * SourceLength * AB_SCALE_WEIGHT_ONE, 2 * OutputLength) -
+        AB_SCALE_WEIGHT_ONE / 2;
+    Position = MAX(Position, 0);
+    Position = MIN(Position, Last);
+    Index[Out] = (UINT32)(Position / AB_SCALE_WEIGHT_ONE);
+    Weight[Out] = (UINT16)(Position % AB_SCALE_WEIGHT_ONE);
+    if (Index[Out] == SourceLength - 1) {
+      Index[Out]--;
+      Weight[Out] = AB_SCALE_WEIGHT_ONE;
+    }
+    Index[Out] += SourceStart;
+  }
+}
+
+static VOID
+AbScaleReplicate(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame) {
+  CONST FRAME_RECT *Source = &Scaler->Source;
+  CONST UINT32 *Src;
+  UINT32 *Dst;
+  UINT32 Pitch = Scaler->View.PitchPixels;
+  UINT32 RowBytes = Scaler->Output.Width * sizeof(UINT32);
+  UINT32 Factor = Scaler->ReplicateX;
+  UINT32 SourceY;
+  UINT32 X;
+  UINT32 Copy;
+
+  for (SourceY = 0; SourceY < Source->Height; ++SourceY) {
+    Src = (CONST UINT32 *)(Frame->Pixels + (UINTN)(Source->Y + SourceY) * Frame->PitchPixels + Source->X);
+    Dst = (UINT32 *)(Scaler->View.Pixels + (UINTN)SourceY * Scaler->ReplicateY * Pitch);
+    switch (Factor) {
+      case 1:
+        CopyMem(Dst, Src, RowBytes);
+        break;
+      case 2:
+        for (X = 0; X < Source->Width; ++X) {
+          Dst[2 * X] = Src[X];
+          Dst[2 * X + 1] = Src[X];
+        }
+        break;
+      case 3:
+        for (X = 0; X < Source->Width; ++X) {
+          Dst[3 * X] = Src[X];
+          Dst[3 * X + 1] = Src[X];
+          Dst[3 * X + 2] = Src[X];
+        }
+        break;
+      default:
+        for (X = 0; X < Source->Width; ++X) {
+          for (Copy = 0; Copy < Factor; ++Copy) {
+            Dst[Factor * X + Copy] = Src[X];
+          }
+        }
+        break;
+    }
+    for (Copy = 1; Copy < Scaler->ReplicateY; ++Copy) {
+      CopyMem(Dst + (UINTN)Copy * Pitch, Dst, RowBytes);
+    }
+  }
+}
+
+static VOID
+AbScaleNearest(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame) {
+  CONST UINT32 *Src;
+  UINT32 *Dst;
+  UINT32 Pitch = Scaler->View.PitchPixels;
+  UINT32 Width = Scaler->Output.Width;
+  UINT32 OutY;
+  UINT32 X;
+
+  for (OutY = 0; OutY < Scaler->Output.Height; ++OutY) {
+    Dst = (UINT32 *)(Scaler->View.Pixels + (UINTN)OutY * Pitch);
+    if (OutY > 0 && Scaler->RowIndex[OutY] == Scaler->RowIndex[OutY - 1]) {
+      CopyMem(Dst, Dst - Pitch, Width * sizeof(UINT32));
+      continue;
+    }
+    Src = (CONST UINT32 *)(Frame->Pixels + (UINTN)Scaler->RowIndex[OutY] * Frame->PitchPixels);
+    for (X = 0; X < Width; ++X) {
+      Dst[X] = Src[Scaler->ColIndex[X]];
+    }
+  }
+}
+
+static VOID
+AbScaleBilinear(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame) {
+  CONST UINT32 *Top;
+  CONST UINT32 *Bottom;
+  UINT32 *Dst;
+  UINT32 Pitch = Scaler->View.PitchPixels;
+  UINT32 Width = Scaler->Output.Width;
+  UINT32 OutY;
+  UINT32 X;
+  UINT32 Weight;
+
+  // Each source row is filtered in X once and shared by the output rows using it.
+  Scaler->HorzRowIndex[0] = MAX_UINT32;
+  Scaler->HorzRowIndex[1] = MAX_UINT32;
+
+  for (OutY = 0; OutY < Scaler->Output.Height; ++OutY) {
+    Dst = (UINT32 *)(Scaler->View.Pixels + (UINTN)OutY * Pitch);
+    if (OutY > 0 && Scaler->RowIndex[OutY] == Scaler->RowIndex[OutY - 1] &&
+        Scaler->RowWeight[OutY] == Scaler->RowWeight[OutY - 1]) {
+      CopyMem(Dst, Dst - Pitch, Width * sizeof(UINT32));
+      continue;
+    }
+    Weight = Scaler->RowWeight[OutY];
+    Top = AbFilterSourceRow(Scaler, Frame, Scaler->RowIndex[OutY], NULL);
+    if (Weight == 0) {
+      CopyMem(Dst, Top, Width * sizeof(UINT32));
+      continue;
+    }
+    Bottom = AbFilterSourceRow(Scaler, Frame, Scaler->RowIndex[OutY] + 1, Top);
+    if (Weight == AB_SCALE_WEIGHT_ONE) {
+      CopyMem(Dst, Bottom, Width * sizeof(UINT32));
+      continue;
+    }
+    for (X = 0; X < Width; ++X) {
+      Dst[X] = AbLerpPixel(Top[X], Bottom[X], Weight);
+    }
+  }
+}
+
+static CONST UINT32 *
+AbFilterSourceRow(
+    FRAME_SCALER *Scaler,
+    CONST FRAME_BUFFER *Frame,
+    UINT32 SourceY,
+    CONST UINT32 *Keep) {
+  CONST UINT32 *Src;
+  UINT32 *Out;
+  UINT32 Slot;
+  UINT32 X;
+  UINT32 Column;
+
+  for (Slot = 0; Slot < 2; ++Slot) {
+    if (Scaler->HorzRowIndex[Slot] == SourceY) {
+      return Scaler->HorzRows[Slot];
+    }
+  }
+  if (Keep != NULL) {
+    Slot = (Scaler->HorzRows[0] == Keep) ? 1 : 0;
+  } else {
+    // Evict the lower row; the higher one is likely the next row's top.
+    Slot = (Scaler->HorzRowIndex[0] == MAX_UINT32 ||
+            (Scaler->HorzRowIndex[1] != MAX_UINT32 &&
+             Scaler->HorzRowIndex[0] < Scaler->HorzRowIndex[1])) ? 0 : 1;
+  }
+  Out = Scaler->HorzRows[Slot];
+  Src = (CONST UINT32 *)(Frame->Pixels + (UINTN)SourceY * Frame->PitchPixels);
+  for (X = 0; X < Scaler->Output.Width; ++X) {
+    Column = Scaler->ColIndex[X];
+    Out[X] = AbLerpPixel(Src[Column], Src[Column + 1], Scaler->ColWeight[X]);
+  }
+  Scaler->HorzRowIndex[Slot] = SourceY;
+  return Out;
+}
+
+// Blends two BGRA pixels two channels at a time; Weight is B's share of 256.
+static UINT32
+AbLerpPixel(
+    UINT32 A,
+    UINT32 B,
+    UINT32 Weight) {
+  UINT32 Inverse = AB_SCALE_WEIGHT_ONE - Weight;
+  UINT32 RedBlue;
+  UINT32 GreenAlpha;
+
+  RedBlue = (((A & 0x00FF00FF) * Inverse + (B & 0x00FF00FF) * Weight) >> 8) & 0x00FF00FF;
+  GreenAlpha = (((A >> 8) & 0x00FF00FF) * Inverse + ((B >> 8) & 0x00FF00FF) * Weight) & 0xFF00FF00;
+  return RedBlue | GreenAlpha;
+}
@@ -0,0 +1,263 @@
+#include "FrameTrace.h"
+#include "FrameClock.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/FileHandleLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+
+#define AB_TRACE_EARLY_EVENTS  32U
+#define AB_TRACE_INSTANT       MAX_UINT64
+#define AB_TRACE_WRITE_CHUNK   4096U
+#define AB_TRACE_LINE_MAX      192U
+
+typedef enum {
+  AbTraceModePending = 0,    // Until config.json has been read
+  AbTraceModeOn,
+  AbTraceModeOff
+} AB_TRACE_MODE;
+
+typedef struct {
+  EFI_FILE_PROTOCOL *File;
+  CHAR8             Buffer[AB_TRACE_WRITE_CHUNK];
+  UINTN             Used;
+  UINT64            Written;
+  EFI_STATUS        Status;
+} TRACE_WRITER;
+
+static AB_TRACE_MODE mTraceMode = AbTraceModePending;
+static TRACE_EVENT   mEarlyEvents[AB_TRACE_EARLY_EVENTS];
+static TRACE_EVENT  *mEvents = mEarlyEvents;
+static UINT32        mCapacity = AB_TRACE_EARLY_EVENTS;
+static UINT32        mPinned = 0;    // Startup events, never overwritten
+static UINT32        mHead = 0;      // Next slot of the wrapping part
+static UINT32        mCount = 0;
+static UINT32        mOverwritten = 0;
+
+static VOID
+AbTraceRecord(
+    CONST CHAR8 *Name,
+    UINT64 StartUs,
+    UINT64 DurationUs,
+    UINT32 Arg) {
+  TRACE_EVENT *Event;
+
+  Event = &mEvents[mPinned + mHead];
+  Event->Name = Name;
+  Event->StartUs = StartUs;
+  Event->DurationUs = DurationUs;
+  Event->Arg = Arg;
+
+  mHead = (mPinned + mHead + 1 == mCapacity) ? 0 : mHead + 1;
+  if (mCount < mCapacity - mPinned) {
+    mCount++;
+  } else {
+    mOverwritten++;
+  }
+}
+
+// Index 0 is the oldest event; pinned events come first.
+static CONST TRACE_EVENT *
+AbTraceEventAt(UINT32 Index) {
+  UINT32 RingSize;
+
+  if (Index < mPinned) {
+    return &mEvents[Index];
+  }
+  RingSize = mCapacity - mPinned;
+  return &mEvents[mPinned + (mHead + RingSize - mCount + Index - mPinned) % RingSize];
+}
+
+EFI_STATUS
+AbTraceStart(UINT32 Capacity) {
+  TRACE_EVENT *Events;
+  UINT32 Index;
+  UINT32 Kept;
+
+  if (mTraceMode == AbTraceModeOn) {
+    return EFI_SUCCESS;
+  }
+  if (mTraceMode == AbTraceModeOff || Capacity < 2 * AB_TRACE_EARLY_EVENTS) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Allocate the whole ring up front so recording never touches the pool.
+  Events = AllocateZeroPool((UINTN)Capacity * sizeof(TRACE_EVENT));
+  if (Events == NULL) {
+    AbTraceStop();
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  // Startup phases stay at the front; only per-frame events wrap.
+  Kept = mPinned + mCount;
+  for (Index = 0; Index < Kept; Index++) {
+    CopyMem(&Events[Index], AbTraceEventAt(Index), sizeof(TRACE_EVENT));
+  }
+
+  mEvents = Events;
+  mCapacity = Capacity;
+  mPinned = Kept;
+  mHead = 0;
+  mCount = 0;
+  mTraceMode = AbTraceModeOn;
+  return EFI_SUCCESS;
+}
+
+VOID
+AbTraceStop(VOID) {
+  if (mEvents != mEarlyEvents) {
+    FreePool(mEvents);
+  }
+  mEvents = mEarlyEvents;
+  mCapacity = AB_TRACE_EARLY_EVENTS;
+  mPinned = 0;
+  mHead = 0;
+  mCount = 0;
+  mOverwritten = 0;
+  mTraceMode = AbTraceModeOff;
+}
+
+UINT64
+AbTraceBegin(VOID) {
+  if (mTraceMode == AbTraceModeOff) {
+    return 0;
+  }
+  return AbClockNowUs();
+}
+
+VOID
+AbTraceEnd(
+    CONST CHAR8 *Name,
+    UINT64 StartUs,
+    UINT32 Arg) {
+  UINT64 NowUs;
+
+  if (mTraceMode == AbTraceModeOff) {
+    return;
+  }
+  NowUs = AbClockNowUs();
+  AbTraceRecord(Name, StartUs, NowUs > StartUs ? NowUs - StartUs : 0, Arg);
+}
+
+VOID
+AbTraceInstant(
+    CONST CHAR8 *Name,
+    UINT32 Arg) {
+  if (mTraceMode == AbTraceModeOff) {
+    return;
+  }
+  AbTraceRecord(Name, AbClockNowUs(), AB_TRACE_INSTANT, Arg);
+}
+
+static VOID
+AbTraceWriterFlush(TRACE_WRITER *Writer) {
+  UINTN Size;
+
+  if (Writer->Used == 0 || EFI_ERROR(Writer->Status)) {
+    return;
+  }
+  Size = Writer->Used;
+  Writer->Status = Writer->File->Write(Writer->File, &Size, Writer->Buffer);
+  if (!EFI_ERROR(Writer->Status) && Size != Writer->Used) {
+    Writer->Status = EFI_VOLUME_FULL;
+  }
+  Writer->Written += Size;
+  Writer->Used = 0;
+}
+
+static VOID
+AbTraceWrite(
+    TRACE_WRITER *Writer,
+    CONST CHAR8 *Text) {
+  UINTN Length;
+
+  Length = AsciiStrLen(Text);
+  if (Writer->Used + Length > sizeof(Writer->Buffer)) {
+    AbTraceWriterFlush(Writer);
+  }
+  CopyMem(Writer->Buffer + Writer->Used, Text, Length);
+  Writer->Used += Length;
+}
+
+static VOID
+AbTraceWriteEvent(
+    TRACE_WRITER *Writer,
+    CONST TRACE_EVENT *Event) {
+  CHAR8 Line[AB_TRACE_LINE_MAX];
+  UINTN Length;
+
+  if (Event->DurationUs == AB_TRACE_INSTANT) {
+    Length = AsciiSPrint(Line, sizeof(Line),
+        ",\n{\"name\":\"%a\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":%lu",
+        Event->Name, Event->StartUs);
+  } else {
+    Length = AsciiSPrint(Line, sizeof(Line),
+        ",\n{\"name\":\"%a\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%lu",
+        Event->Name, Event->StartUs, Event->DurationUs);
+  }
+  if (Event->Arg != AB_TRACE_NO_ARG) {
+    AsciiSPrint(Line + Length, sizeof(Line) - Length,
+        ",\"args\":{\"frame\":%u}}", Event->Arg);
+  } else {
+    AsciiStrCatS(Line, sizeof(Line), "}");
+  }
+  AbTraceWrite(Writer, Line);
+}
+
+EFI_STATUS
+AbTraceFlush(
+    EFI_FILE_PROTOCOL *Root,
+    CONST CHAR16 *Path) {
+  EFI_STATUS Status;
+  TRACE_WRITER *Writer;
+  CHAR8 Line[AB_TRACE_LINE_MAX];
+  UINT32 Index;
+
+  if (mTraceMode != AbTraceModeOn) {
+    return EFI_NOT_STARTED;
+  }
+  if (Root == NULL || Path == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Writer = AllocateZeroPool(sizeof(TRACE_WRITER));
+  if (Writer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = Root->Open(Root, &Writer->File, (CHAR16 *)Path,
+      EFI_FILE_MODE_CREATE | EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (EFI_ERROR(Status)) {
+    goto Cleanup;
+  }
+
+  AbTraceWrite(Writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  AbTraceWrite(Writer,
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"AnimeBoot\"}}");
+  for (Index = 0; Index < mPinned + mCount; Index++) {
+    AbTraceWriteEvent(Writer, AbTraceEventAt(Index));
+  }
+  AsciiSPrint(Line, sizeof(Line),
+      "\n],\"otherData\":{\"events\":\"%u\",\"overwritten\":\"%u\"}}\n",
+      mPinned + mCount, mOverwritten);
+  AbTraceWrite(Writer, Line);
+  AbTraceWriterFlush(Writer);
+
+  // The file may be left over from a longer run.
+  if (!EFI_ERROR(Writer->Status)) {
+    Writer->Status = FileHandleSetSize(Writer->File, Writer->Written);
+  }
+  Status = Writer->Status;
+  Writer->File->Close(Writer->File);
+
+  if (!EFI_ERROR(Status)) {
+    DEBUG((DEBUG_INFO, "AnimeBoot: Trace %u events (%u overwritten) -> %s\n",
+        mPinned + mCount, mOverwritten, Path));
+  }
+
+Cleanup:
+  FreePool(Writer);
+  return Status;
+}
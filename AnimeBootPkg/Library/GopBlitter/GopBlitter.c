@@ -1,4 +1,111 @@
 #include "GopBlitter.h"
+#include "FrameClock.h"
+
+#include <Library/DebugLib.h>
+#include <Protocol/EdidActive.h>
+#include <Protocol/EdidDiscovered.h>
+
+#if defined (_MSC_VER) && (defined (MDE_CPU_IA32) || defined (MDE_CPU_X64))
+#include <intrin.h>
+#endif
+
+// Bridging gaps and accepting a little overdraw is cheaper than another Blt call.
+#define AB_DIRTY_MERGE_GAP_TILES    1U
+#define AB_DIRTY_MERGE_SLACK_TILES  4U
+
+#define AB_EDID_MIN_SIZE            128U
+#define AB_EDID_DTD_OFFSET          54U
+
+// Mode scores compare by downscale, panel aspect, scaling class, then native
+// timing; the output pixel count only breaks ties and never justifies a switch.
+#define AB_MODE_SCORE_DOWNSCALE     BIT52
+#define AB_MODE_SCORE_ASPECT        BIT51
+#define AB_MODE_SCORE_CLASS_SHIFT   48
+#define AB_MODE_SCORE_NOT_NATIVE    BIT47
+#define AB_MODE_SCORE_SWITCH_MASK   (~(BIT47 - 1))
+
+static VOID
+AbReadPanelTiming(GOP_STATE *State);
+
+static UINT64
+AbScoreMode(
+    GOP_STATE *State,
+    CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight);
+
+static EFI_STATUS
+AbSetModeTimed(
+    GOP_STATE *State,
+    UINT32 ModeNumber);
+
+static VOID
+AbFreeDirtyShadow(DIRTY_TRACKER *Dirty);
+
+static UINT32
+AbCollectDirtyTiles(
+    DIRTY_TRACKER *Dirty,
+    FRAME_BUFFER *Frame);
+
+static BOOLEAN
+AbBuildDirtyRects(
+    DIRTY_TRACKER *Dirty,
+    FRAME_BUFFER *Frame,
+    FRAME_RECT *Rects,
+    UINT32 *RectCount);
+
+static VOID
+AbCopyFrameRect(
+    FRAME_BUFFER *Dest,
+    FRAME_BUFFER *Source,
+    CONST FRAME_RECT *Rect);
+
+static EFI_STATUS
+AbSendRect(
+    GOP_STATE *State,
+    FRAME_BUFFER *Frame,
+    CONST FRAME_RECT *Source,
+    UINT32 DestX,
+    UINT32 DestY);
+
+static EFI_STATUS
+AbWriteLinearRect(
+    LINEAR_FRAMEBUFFER *Linear,
+    FRAME_BUFFER *Frame,
+    CONST FRAME_RECT *Source,
+    UINT32 DestX,
+    UINT32 DestY);
+
+static VOID
+AbFenceDirectWrite(GOP_STATE *State);
+
+static UINT32
+AbScaleChannel(
+    UINT8 Value,
+    UINT8 Shift,
+    UINT8 Bits);
+
+static VOID
+AbConvertRow(
+    LINEAR_FRAMEBUFFER *Linear,
+    CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Source,
+    UINT32 Count);
+
+static VOID
+AbStreamStore(
+    UINTN *Dest,
+    UINTN Value);
+
+static VOID
+AbStreamCopy(
+    UINT8 *Dest,
+    CONST UINT8 *Source,
+    UINTN Length);
+
+static VOID
+AbRecordBlitTime(
+    GOP_STATE *State,
+    UINT64 StartUs);
 
 EFI_STATUS
 AbInitGopState(GOP_STATE *State) {
@@ -6,6 +113,7 @@ AbInitGopState(GOP_STATE *State) {
   if (State == NULL) {
     return EFI_INVALID_PARAMETER;
   }
+  ZeroMem(State, sizeof(*State));
   Status = gBS->LocateProtocol(
       &gEfiGraphicsOutputProtocolGuid,
       NULL,
@@ -15,6 +123,7 @@ AbInitGopState(GOP_STATE *State) {
   }
   State->OriginalMode = State->Gop->Mode->Information;
   State->OriginalModeIndex = State->Gop->Mode->Mode;
+  AbReadPanelTiming(State);
   return EFI_SUCCESS;
 }
 
@@ -23,7 +132,59 @@ AbRestoreGopState(GOP_STATE *State) {
   if (State == NULL || State->Gop == NULL) {
     return;
   }
-  State->Gop->SetMode(State->Gop, State->OriginalModeIndex);
+  AbResetDirtyTracking(State);
+  AbDisableDirectWrite(State);
+  // SetMode is slow and blanks some panels; skip it when nothing changed.
+  if (State->Gop->Mode->Mode != State->OriginalModeIndex) {
+    AbSetModeTimed(State, State->OriginalModeIndex);
+  }
+}
+
+EFI_STATUS
+AbSelectGopMode(
+    GOP_STATE *State,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight) {
+  EFI_STATUS Status;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+  UINTN InfoSize;
+  UINT32 ModeNumber;
+  UINT32 CurrentMode;
+  UINT32 BestMode;
+  UINT64 CurrentScore;
+  UINT64 BestScore;
+  UINT64 Score;
+
+  if (State == NULL || State->Gop == NULL || FrameWidth == 0 || FrameHeight == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CurrentMode = State->Gop->Mode->Mode;
+  CurrentScore = AbScoreMode(State, State->Gop->Mode->Information, FrameWidth, FrameHeight);
+  BestMode = CurrentMode;
+  BestScore = CurrentScore;
+
+  for (ModeNumber = 0; ModeNumber < State->Gop->Mode->MaxMode; ++ModeNumber) {
+    if (ModeNumber == CurrentMode) {
+      continue;
+    }
+    Status = State->Gop->QueryMode(State->Gop, ModeNumber, &InfoSize, &Info);
+    if (EFI_ERROR(Status)) {
+      continue;
+    }
+    Score = AbScoreMode(State, Info, FrameWidth, FrameHeight);
+    FreePool(Info);
+    if (Score < BestScore) {
+      BestScore = Score;
+      BestMode = ModeNumber;
+    }
+  }
+
+  if (BestMode == CurrentMode ||
+      (BestScore & AB_MODE_SCORE_SWITCH_MASK) >= (CurrentScore & AB_MODE_SCORE_SWITCH_MASK)) {
+    return EFI_SUCCESS;
+  }
+  return AbSetModeTimed(State, BestMode);
 }
 
 EFI_STATUS
@@ -73,22 +234,715 @@ AbBlitFrame(
     FRAME_BUFFER *Frame,
     UINT32 DestX,
     UINT32 DestY) {
+  EFI_STATUS Status;
+  FRAME_RECT Full;
+  UINT64 StartUs;
+
   if (State == NULL || State->Gop == NULL || Frame == NULL || Frame->Pixels == NULL) {
     return EFI_INVALID_PARAMETER;
   }
+  Full.X = 0;
+  Full.Y = 0;
+  Full.Width = Frame->Width;
+  Full.Height = Frame->Height;
+  StartUs = AbClockNowUs();
+  Status = AbSendRect(State, Frame, &Full, DestX, DestY);
+  AbFenceDirectWrite(State);
+  if (!EFI_ERROR(Status)) {
+    AbRecordBlitTime(State, StartUs);
+  }
+  return Status;
+}
+
+UINT64
+AbDirtyTrackerFootprint(
+    UINT32 Width,
+    UINT32 Height) {
+  UINT64 Tiles;
+
+  Tiles = (UINT64)((Width + AB_DIRTY_TILE_WIDTH - 1) / AB_DIRTY_TILE_WIDTH) *
+      ((Height + AB_DIRTY_TILE_HEIGHT - 1) / AB_DIRTY_TILE_HEIGHT);
+  return sizeof(FRAME_BUFFER) + (UINT64)Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL) + Tiles;
+}
+
+EFI_STATUS
+AbBlitFrameDirty(
+    GOP_STATE *State,
+    FRAME_BUFFER *Frame,
+    UINT32 DestX,
+    UINT32 DestY) {
+  EFI_STATUS Status;
+  DIRTY_TRACKER *Dirty;
+  FRAME_RECT Rects[AB_MAX_DIRTY_RECTS];
+  FRAME_RECT Full;
+  UINT32 RectCount;
+  UINT32 DirtyTiles;
+  UINT32 Index;
+  UINT64 FramePixels;
+  UINT64 StartUs;
+
+  if (State == NULL || State->Gop == NULL || Frame == NULL || Frame->Pixels == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dirty = &State->Dirty;
+  FramePixels = (UINT64)Frame->Width * Frame->Height;
+  Dirty->PixelsPresented += FramePixels;
+
+  if (Dirty->Shadow != NULL &&
+      (Dirty->Shadow->Width != Frame->Width || Dirty->Shadow->Height != Frame->Height ||
+       Dirty->DestX != DestX || Dirty->DestY != DestY)) {
+    AbFreeDirtyShadow(Dirty);
+  }
+
+  if (Dirty->Shadow != NULL) {
+    DirtyTiles = AbCollectDirtyTiles(Dirty, Frame);
+    if (DirtyTiles == 0) {
+      Dirty->SkippedBlits++;
+      return EFI_SUCCESS;
+    }
+    if ((UINT64)DirtyTiles * 100 < (UINT64)Dirty->TilesX * Dirty->TilesY * AB_DIRTY_FULL_BLIT_PERCENT &&
+        AbBuildDirtyRects(Dirty, Frame, Rects, &RectCount)) {
+      StartUs = AbClockNowUs();
+      Status = EFI_SUCCESS;
+      for (Index = 0; Index < RectCount; ++Index) {
+        Status = AbSendRect(State, Frame, &Rects[Index], DestX + Rects[Index].X, DestY + Rects[Index].Y);
+        if (EFI_ERROR(Status)) {
+          break;
+        }
+        AbCopyFrameRect(Dirty->Shadow, Frame, &Rects[Index]);
+        Dirty->PixelsSent += (UINT64)Rects[Index].Width * Rects[Index].Height;
+      }
+      // One fence covers every rect of the frame.
+      AbFenceDirectWrite(State);
+      if (EFI_ERROR(Status)) {
+        AbFreeDirtyShadow(Dirty);
+        return Status;
+      }
+      AbRecordBlitTime(State, StartUs);
+      Dirty->RectsSent += RectCount;
+      Dirty->PartialBlits++;
+      return EFI_SUCCESS;
+    }
+  }
+
+  Status = AbBlitFrame(State, Frame, DestX, DestY);
+  if (EFI_ERROR(Status)) {
+    AbFreeDirtyShadow(Dirty);
+    return Status;
+  }
+  Dirty->FullBlits++;
+  Dirty->RectsSent++;
+  Dirty->PixelsSent += FramePixels;
+
+  if (Dirty->Shadow == NULL) {
+    // Without a shadow every frame is a full blit, which is still correct.
+    Dirty->TilesX = (Frame->Width + AB_DIRTY_TILE_WIDTH - 1) / AB_DIRTY_TILE_WIDTH;
+    Dirty->TilesY = (Frame->Height + AB_DIRTY_TILE_HEIGHT - 1) / AB_DIRTY_TILE_HEIGHT;
+    Dirty->TileMap = AllocatePool(Dirty->TilesX * Dirty->TilesY);
+    if (Dirty->TileMap == NULL ||
+        EFI_ERROR(AbAllocateFrameBuffer(Frame->Width, Frame->Height, &Dirty->Shadow))) {
+      AbFreeDirtyShadow(Dirty);
+      return EFI_SUCCESS;
+    }
+    Dirty->DestX = DestX;
+    Dirty->DestY = DestY;
+  }
+  Full.X = 0;
+  Full.Y = 0;
+  Full.Width = Frame->Width;
+  Full.Height = Frame->Height;
+  AbCopyFrameRect(Dirty->Shadow, Frame, &Full);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AbBlitFrameRect(
+    GOP_STATE *State,
+    FRAME_BUFFER *Frame,
+    CONST FRAME_RECT *Rect,
+    UINT32 DestX,
+    UINT32 DestY) {
+  EFI_STATUS Status;
+  DIRTY_TRACKER *Dirty;
+  UINT64 StartUs;
+
+  if (State == NULL || State->Gop == NULL || Frame == NULL || Frame->Pixels == NULL ||
+      Rect == NULL || Rect->Width == 0 || Rect->Height == 0 ||
+      Rect->Width > Frame->Width || Rect->Height > Frame->Height ||
+      Rect->X > Frame->Width - Rect->Width || Rect->Y > Frame->Height - Rect->Height) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dirty = &State->Dirty;
+  Dirty->PixelsPresented += (UINT64)Frame->Width * Frame->Height;
+  StartUs = AbClockNowUs();
+  Status = AbSendRect(State, Frame, Rect, DestX + Rect->X, DestY + Rect->Y);
+  AbFenceDirectWrite(State);
+  if (EFI_ERROR(Status)) {
+    AbFreeDirtyShadow(Dirty);
+    return Status;
+  }
+  AbRecordBlitTime(State, StartUs);
+
+  // Keep a shadow in step with the screen so a later dirty blit stays valid.
+  if (Dirty->Shadow != NULL) {
+    if (Dirty->Shadow->Width == Frame->Width && Dirty->Shadow->Height == Frame->Height &&
+        Dirty->DestX == DestX && Dirty->DestY == DestY) {
+      AbCopyFrameRect(Dirty->Shadow, Frame, Rect);
+    } else {
+      AbFreeDirtyShadow(Dirty);
+    }
+  }
+  if (Rect->Width == Frame->Width && Rect->Height == Frame->Height) {
+    Dirty->FullBlits++;
+  } else {
+    Dirty->PartialBlits++;
+  }
+  Dirty->RectsSent++;
+  Dirty->PixelsSent += (UINT64)Rect->Width * Rect->Height;
+  return EFI_SUCCESS;
+}
+
+VOID
+AbResetDirtyTracking(GOP_STATE *State) {
+  if (State == NULL) {
+    return;
+  }
+  AbFreeDirtyShadow(&State->Dirty);
+  ZeroMem(&State->Dirty, sizeof(State->Dirty));
+  ZeroMem(&State->GopTiming, sizeof(State->GopTiming));
+  ZeroMem(&State->DirectTiming, sizeof(State->DirectTiming));
+}
+
+EFI_STATUS
+AbEnableDirectWrite(GOP_STATE *State) {
+  EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+  LINEAR_FRAMEBUFFER *Linear;
+  UINT32 Masks[3];
+  UINT32 AllMasks;
+  UINT32 Channel;
+  UINT64 Span;
+
+  if (State == NULL || State->Gop == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  AbDisableDirectWrite(State);
+
+  Mode = State->Gop->Mode;
+  Info = Mode->Information;
+  if (Info->PixelFormat >= PixelBltOnly || Mode->FrameBufferBase == 0 ||
+      Info->HorizontalResolution == 0 || Info->VerticalResolution == 0 ||
+      Info->PixelsPerScanLine < Info->HorizontalResolution) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Linear = &State->Linear;
+  Linear->Base = (UINT8 *)(UINTN)Mode->FrameBufferBase;
+  Linear->Size = Mode->FrameBufferSize;
+  Linear->Mode = Mode->Mode;
+  Linear->Width = Info->HorizontalResolution;
+  Linear->Height = Info->VerticalResolution;
+  Linear->PixelsPerScanLine = Info->PixelsPerScanLine;
+  Linear->Format = Info->PixelFormat;
+  Linear->BytesPerPixel = sizeof(UINT32);
+
+  if (Linear->Format == PixelBitMask) {
+    Masks[0] = Info->PixelInformation.RedMask;
+    Masks[1] = Info->PixelInformation.GreenMask;
+    Masks[2] = Info->PixelInformation.BlueMask;
+    if (Masks[0] == 0 || Masks[1] == 0 || Masks[2] == 0) {
+      ZeroMem(Linear, sizeof(*Linear));
+      return EFI_UNSUPPORTED;
+    }
+    for (Channel = 0; Channel < 3; ++Channel) {
+      Linear->Shift[Channel] = (UINT8)LowBitSet32(Masks[Channel]);
+      Linear->Bits[Channel] = (UINT8)(HighBitSet32(Masks[Channel]) - Linear->Shift[Channel] + 1);
+    }
+    AllMasks = Masks[0] | Masks[1] | Masks[2] | Info->PixelInformation.ReservedMask;
+    Linear->BytesPerPixel = (UINT32)(HighBitSet32(AllMasks) + 8) / 8;
+  }
+
+  Span = ((UINT64)Linear->PixelsPerScanLine * (Linear->Height - 1) + Linear->Width) *
+      Linear->BytesPerPixel;
+  if (Linear->Size != 0 && Span > Linear->Size) {
+    ZeroMem(Linear, sizeof(*Linear));
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Linear->Format != PixelBlueGreenRedReserved8BitPerColor) {
+    Linear->RowBuffer = AllocatePool(Linear->Width * sizeof(UINT32));
+    if (Linear->RowBuffer == NULL) {
+      ZeroMem(Linear, sizeof(*Linear));
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  State->DirectWrite = TRUE;
+  DEBUG((DEBUG_INFO, "Direct framebuffer writes: %ux%u, %u pixels/line, format %u, %u bytes/pixel\n",
+         Linear->Width, Linear->Height, Linear->PixelsPerScanLine, Linear->Format, Linear->BytesPerPixel));
+  return EFI_SUCCESS;
+}
+
+VOID
+AbDisableDirectWrite(GOP_STATE *State) {
+  if (State == NULL) {
+    return;
+  }
+  if (State->Linear.RowBuffer != NULL) {
+    FreePool(State->Linear.RowBuffer);
+  }
+  ZeroMem(&State->Linear, sizeof(State->Linear));
+  State->DirectWrite = FALSE;
+}
+
+// Preferred timing = first detailed timing descriptor of the base EDID block.
+static VOID
+AbReadPanelTiming(GOP_STATE *State) {
+  EFI_STATUS Status;
+  EFI_HANDLE *Handles = NULL;
+  UINTN HandleCount = 0;
+  UINTN Index;
+  VOID *Gop;
+  EFI_EDID_ACTIVE_PROTOCOL *Edid = NULL;
+  CONST UINT8 *Dtd;
+  static CONST UINT8 EdidHeader[8] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+  Status = gBS->LocateHandleBuffer(ByProtocol, &gEfiGraphicsOutputProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+  for (Index = 0; Index < HandleCount; ++Index) {
+    if (EFI_ERROR(gBS->HandleProtocol(Handles[Index], &gEfiGraphicsOutputProtocolGuid, &Gop)) ||
+        Gop != (VOID *)State->Gop) {
+      continue;
+    }
+    // Both protocols share one layout; Active reflects any platform override.
+    if (EFI_ERROR(gBS->HandleProtocol(Handles[Index], &gEfiEdidActiveProtocolGuid, (VOID **)&Edid)) &&
+        EFI_ERROR(gBS->HandleProtocol(Handles[Index], &gEfiEdidDiscoveredProtocolGuid, (VOID **)&Edid))) {
+      Edid = NULL;
+    }
+    break;
+  }
+  FreePool(Handles);
+
+  if (Edid == NULL || Edid->Edid == NULL || Edid->SizeOfEdid < AB_EDID_MIN_SIZE ||
+      CompareMem(Edid->Edid, EdidHeader, sizeof(EdidHeader)) != 0) {
+    return;
+  }
+  Dtd = Edid->Edid + AB_EDID_DTD_OFFSET;
+  if (Dtd[0] == 0 && Dtd[1] == 0) {
+    // Zero pixel clock: a display descriptor, not a timing.
+    return;
+  }
+  State->PanelWidth = Dtd[2] | ((UINT32)(Dtd[4] & 0xF0) << 4);
+  State->PanelHeight = Dtd[5] | ((UINT32)(Dtd[7] & 0xF0) << 4);
+  DEBUG((DEBUG_INFO, "EDID preferred timing %ux%u\n", State->PanelWidth, State->PanelHeight));
+}
+
+// Lower is better. Modes larger than the panel's native timing are never chosen.
+static UINT64
+AbScoreMode(
+    GOP_STATE *State,
+    CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info,
+    UINT32 FrameWidth,
+    UINT32 FrameHeight) {
+  FRAME_RECT Rect;
+  UINT64 Score = 0;
+  UINT64 Class;
+  UINT32 Width = Info->HorizontalResolution;
+  UINT32 Height = Info->VerticalResolution;
+
+  if (EFI_ERROR(AbCalcLetterboxRect(Width, Height, FrameWidth, FrameHeight, &Rect))) {
+    return MAX_UINT64;
+  }
+  if (State->PanelWidth != 0 && (Width > State->PanelWidth || Height > State->PanelHeight)) {
+    return MAX_UINT64;
+  }
+
+  if (Width < FrameWidth || Height < FrameHeight) {
+    Score |= AB_MODE_SCORE_DOWNSCALE;
+  }
+  // 0 = shown 1:1, 1 = integer replication, 2 = resampled.
+  if (Rect.Width == FrameWidth && Rect.Height == FrameHeight) {
+    Class = 0;
+  } else if (Rect.Width % FrameWidth == 0 && Rect.Height % FrameHeight == 0) {
+    Class = 1;
+  } else {
+    Class = 2;
+  }
+  Score |= LShiftU64(Class, AB_MODE_SCORE_CLASS_SHIFT);
+  if (State->PanelWidth != 0 && (Width != State->PanelWidth || Height != State->PanelHeight)) {
+    Score |= AB_MODE_SCORE_NOT_NATIVE;
+    // The panel stretches non-native modes to full screen.
+    if ((UINT64)Width * State->PanelHeight != (UINT64)Height * State->PanelWidth) {
+      Score |= AB_MODE_SCORE_ASPECT;
+    }
+  }
+  return Score | ((UINT64)Rect.Width * Rect.Height);
+}
+
+static EFI_STATUS
+AbSetModeTimed(
+    GOP_STATE *State,
+    UINT32 ModeNumber) {
+  EFI_STATUS Status;
+  UINT32 PreviousMode;
+  UINT64 StartUs;
+  UINT64 Elapsed;
+
+  PreviousMode = State->Gop->Mode->Mode;
+  StartUs = AbClockNowUs();
+  Status = State->Gop->SetMode(State->Gop, ModeNumber);
+  Elapsed = AbClockNowUs() - StartUs;
+  State->ModeSwitches++;
+  State->ModeSwitchUs += Elapsed;
+  DEBUG((DEBUG_INFO, "GOP mode %u -> %u (%ux%u): %r in %lu us\n",
+         PreviousMode,
+         ModeNumber,
+         State->Gop->Mode->Information->HorizontalResolution,
+         State->Gop->Mode->Information->VerticalResolution,
+         Status,
+         Elapsed));
+  return Status;
+}
+
+static VOID
+AbFreeDirtyShadow(DIRTY_TRACKER *Dirty) {
+  AbFreeFrameBuffer(&Dirty->Shadow);
+  if (Dirty->TileMap != NULL) {
+    FreePool(Dirty->TileMap);
+    Dirty->TileMap = NULL;
+  }
+  Dirty->TilesX = 0;
+  Dirty->TilesY = 0;
+}
+
+static UINT32
+AbCollectDirtyTiles(
+    DIRTY_TRACKER *Dirty,
+    FRAME_BUFFER *Frame) {
+  UINT32 TileX;
+  UINT32 TileY;
+  UINT32 Row;
+  UINT32 RowEnd;
+  UINT32 Count = 0;
+  UINT8 *MapRow;
+
+  ZeroMem(Dirty->TileMap, Dirty->TilesX * Dirty->TilesY);
+  for (TileY = 0; TileY < Dirty->TilesY; ++TileY) {
+    MapRow = Dirty->TileMap + TileY * Dirty->TilesX;
+    RowEnd = MIN((TileY + 1) * AB_DIRTY_TILE_HEIGHT, Frame->Height);
+    for (Row = TileY * AB_DIRTY_TILE_HEIGHT; Row < RowEnd; ++Row) {
+      CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *New = Frame->Pixels + (UINTN)Row * Frame->PitchPixels;
+      CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Old = Dirty->Shadow->Pixels + (UINTN)Row * Dirty->Shadow->PitchPixels;
+      for (TileX = 0; TileX < Dirty->TilesX; ++TileX) {
+        UINT32 X = TileX * AB_DIRTY_TILE_WIDTH;
+        UINT32 Width = MIN(AB_DIRTY_TILE_WIDTH, Frame->Width - X);
+        if (MapRow[TileX] != 0) {
+          continue;
+        }
+        if (CompareMem(New + X, Old + X, Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) != 0) {
+          MapRow[TileX] = 1;
+          Count++;
+        }
+      }
+    }
+  }
+  return Count;
+}
+
+// Turns the tile map into at most AB_MAX_DIRTY_RECTS pixel rectangles.
+// Returns FALSE when the damage is too fragmented to be worth it.
+static BOOLEAN
+AbBuildDirtyRects(
+    DIRTY_TRACKER *Dirty,
+    FRAME_BUFFER *Frame,
+    FRAME_RECT *Rects,
+    UINT32 *RectCount) {
+  UINT32 Count = 0;
+  UINT32 TileX;
+  UINT32 TileY;
+  UINT32 Index;
+  UINT32 Other;
+  BOOLEAN Merged;
+
+  // Horizontal runs per tile row, grown downwards into the rect above.
+  for (TileY = 0; TileY < Dirty->TilesY; ++TileY) {
+    CONST UINT8 *MapRow = Dirty->TileMap + TileY * Dirty->TilesX;
+    TileX = 0;
+    while (TileX < Dirty->TilesX) {
+      FRAME_RECT Run;
+      UINT32 Last;
+      if (MapRow[TileX] == 0) {
+        TileX++;
+        continue;
+      }
+      Run.X = TileX;
+      Last = TileX;
+      for (TileX++; TileX < Dirty->TilesX; ++TileX) {
+        if (MapRow[TileX] != 0) {
+          Last = TileX;
+        } else if (TileX - Last > AB_DIRTY_MERGE_GAP_TILES) {
+          break;
+        }
+      }
+      Run.Y = TileY;
+      Run.Width = Last - Run.X + 1;
+      Run.Height = 1;
+
+      Merged = FALSE;
+      for (Index = 0; Index < Count; ++Index) {
+        FRAME_RECT *Rect = &Rects[Index];
+        if (Rect->Y + Rect->Height == TileY &&
+            Run.X <= Rect->X + Rect->Width + AB_DIRTY_MERGE_GAP_TILES &&
+            Rect->X <= Run.X + Run.Width + AB_DIRTY_MERGE_GAP_TILES) {
+          UINT32 Right = MAX(Rect->X + Rect->Width, Run.X + Run.Width);
+          Rect->X = MIN(Rect->X, Run.X);
+          Rect->Width = Right - Rect->X;
+          Rect->Height++;
+          Merged = TRUE;
+          break;
+        }
+      }
+      if (!Merged) {
+        if (Count == AB_MAX_DIRTY_RECTS) {
+          return FALSE;
+        }
+        Rects[Count++] = Run;
+      }
+    }
+  }
+
+  // Fold together rects whose bounding box costs little more than both.
+  do {
+    Merged = FALSE;
+    for (Index = 0; Index < Count && !Merged; ++Index) {
+      for (Other = Index + 1; Other < Count; ++Other) {
+        FRAME_RECT *A = &Rects[Index];
+        FRAME_RECT *B = &Rects[Other];
+        UINT32 Left = MIN(A->X, B->X);
+        UINT32 Top = MIN(A->Y, B->Y);
+        UINT32 Right = MAX(A->X + A->Width, B->X + B->Width);
+        UINT32 Bottom = MAX(A->Y + A->Height, B->Y + B->Height);
+        if ((Right - Left) * (Bottom - Top) <=
+            A->Width * A->Height + B->Width * B->Height + AB_DIRTY_MERGE_SLACK_TILES) {
+          A->X = Left;
+          A->Y = Top;
+          A->Width = Right - Left;
+          A->Height = Bottom - Top;
+          Rects[Other] = Rects[--Count];
+          Merged = TRUE;
+          break;
+        }
+      }
+    }
+  } while (Merged);
+
+  for (Index = 0; Index < Count; ++Index) {
+    FRAME_RECT *Rect = &Rects[Index];
+    UINT32 Right = MIN((Rect->X + Rect->Width) * AB_DIRTY_TILE_WIDTH, Frame->Width);
+    UINT32 Bottom = MIN((Rect->Y + Rect->Height) * AB_DIRTY_TILE_HEIGHT, Frame->Height);
+    Rect->X *= AB_DIRTY_TILE_WIDTH;
+    Rect->Y *= AB_DIRTY_TILE_HEIGHT;
+    Rect->Width = Right - Rect->X;
+    Rect->Height = Bottom - Rect->Y;
+  }
+  *RectCount = Count;
+  return TRUE;
+}
+
+static VOID
+AbCopyFrameRect(
+    FRAME_BUFFER *Dest,
+    FRAME_BUFFER *Source,
+    CONST FRAME_RECT *Rect) {
+  UINT32 Row;
+
+  for (Row = Rect->Y; Row < Rect->Y + Rect->Height; ++Row) {
+    CopyMem(
+        Dest->Pixels + (UINTN)Row * Dest->PitchPixels + Rect->X,
+        Source->Pixels + (UINTN)Row * Source->PitchPixels + Rect->X,
+        Rect->Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
+}
+
+static EFI_STATUS
+AbSendRect(
+    GOP_STATE *State,
+    FRAME_BUFFER *Frame,
+    CONST FRAME_RECT *Source,
+    UINT32 DestX,
+    UINT32 DestY) {
+  if (State->DirectWrite && State->Gop->Mode->Mode != State->Linear.Mode) {
+    // Someone switched modes under us; the captured layout is stale.
+    DEBUG((DEBUG_WARN, "GOP mode changed, falling back to Blt\n"));
+    AbDisableDirectWrite(State);
+  }
+  if (State->DirectWrite) {
+    return AbWriteLinearRect(&State->Linear, Frame, Source, DestX, DestY);
+  }
   return State->Gop->Blt(
       State->Gop,
       Frame->Pixels,
       EfiBltBufferToVideo,
-      0,
-      0,
+      Source->X,
+      Source->Y,
       DestX,
       DestY,
-      Frame->Width,
-      Frame->Height,
+      Source->Width,
+      Source->Height,
       Frame->PitchPixels * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
 }
 
+static EFI_STATUS
+AbWriteLinearRect(
+    LINEAR_FRAMEBUFFER *Linear,
+    FRAME_BUFFER *Frame,
+    CONST FRAME_RECT *Source,
+    UINT32 DestX,
+    UINT32 DestY) {
+  CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *SourceRow;
+  UINT8 *DestRow;
+  UINT32 Row;
+
+  // Same bounds Blt would enforce; nothing is written past the visible mode.
+  if (DestX > Linear->Width || Source->Width > Linear->Width - DestX ||
+      DestY > Linear->Height || Source->Height > Linear->Height - DestY) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Row = 0; Row < Source->Height; ++Row) {
+    SourceRow = Frame->Pixels + (UINTN)(Source->Y + Row) * Frame->PitchPixels + Source->X;
+    DestRow = Linear->Base +
+        ((UINTN)(DestY + Row) * Linear->PixelsPerScanLine + DestX) * Linear->BytesPerPixel;
+    if (Linear->Format == PixelBlueGreenRedReserved8BitPerColor) {
+      AbStreamCopy(DestRow, (CONST UINT8 *)SourceRow, Source->Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    } else {
+      // Swizzle into cached memory first so VRAM only ever sees full stores.
+      AbConvertRow(Linear, SourceRow, Source->Width);
+      AbStreamCopy(DestRow, Linear->RowBuffer, Source->Width * Linear->BytesPerPixel);
+    }
+  }
+  return EFI_SUCCESS;
+}
+
+// Streaming stores are weakly ordered; callers fence once after the last
+// rect of a frame rather than after each one.
+static VOID
+AbFenceDirectWrite(GOP_STATE *State) {
+  if (!State->DirectWrite) {
+    return;
+  }
+#if defined (__GNUC__) && (defined (MDE_CPU_IA32) || defined (MDE_CPU_X64))
+  __asm__ __volatile__ ("sfence" ::: "memory");
+#elif defined (_MSC_VER) && (defined (MDE_CPU_IA32) || defined (MDE_CPU_X64))
+  _mm_sfence();
+#else
+  MemoryFence();
+#endif
+}
+
+static UINT32
+AbScaleChannel(
+    UINT8 Value,
+    UINT8 Shift,
+    UINT8 Bits) {
+  if (Bits >= 8) {
+    return ((UINT32)Value << (Bits - 8)) << Shift;
+  }
+  return ((UINT32)Value >> (8 - Bits)) << Shift;
+}
+
+static VOID
+AbConvertRow(
+    LINEAR_FRAMEBUFFER *Linear,
+    CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Source,
+    UINT32 Count) {
+  UINT32 *Out32 = (UINT32 *)Linear->RowBuffer;
+  UINT8 *Out = Linear->RowBuffer;
+  UINT32 Index;
+  UINT32 Value;
+  UINT32 Byte;
+
+  if (Linear->Format == PixelRedGreenBlueReserved8BitPerColor) {
+    for (Index = 0; Index < Count; ++Index) {
+      Out32[Index] = (UINT32)Source[Index].Red |
+          ((UINT32)Source[Index].Green << 8) |
+          ((UINT32)Source[Index].Blue << 16);
+    }
+    return;
+  }
+
+  for (Index = 0; Index < Count; ++Index) {
+    Value = AbScaleChannel(Source[Index].Red, Linear->Shift[0], Linear->Bits[0]) |
+        AbScaleChannel(Source[Index].Green, Linear->Shift[1], Linear->Bits[1]) |
+        AbScaleChannel(Source[Index].Blue, Linear->Shift[2], Linear->Bits[2]);
+    if (Linear->BytesPerPixel == sizeof(UINT32)) {
+      Out32[Index] = Value;
+      continue;
+    }
+    for (Byte = 0; Byte < Linear->BytesPerPixel; ++Byte) {
+      *Out++ = (UINT8)(Value >> (Byte * 8));
+    }
+  }
+}
+
+// Non-temporal stores: VRAM is uncached or write-combining, so reading it back
+// or letting stores allocate cache lines only slows the copy down.
+static VOID
+AbStreamStore(
+    UINTN *Dest,
+    UINTN Value) {
+#if defined (__GNUC__) && (defined (MDE_CPU_IA32) || defined (MDE_CPU_X64))
+  __asm__ __volatile__ ("movnti %1, %0" : "=m" (*Dest) : "r" (Value));
+#elif defined (_MSC_VER) && defined (MDE_CPU_X64)
+  _mm_stream_si64x((__int64 *)Dest, (__int64)Value);
+#elif defined (_MSC_VER) && defined (MDE_CPU_IA32)
+  _mm_stream_si32((int *)Dest, (int)Value);
+#else
+  *(volatile UINTN *)Dest = Value;
+#endif
+}
+
+static VOID
+AbStreamCopy(
+    UINT8 *Dest,
+    CONST UINT8 *Source,
+    UINTN Length) {
+  while (Length > 0 && ((UINTN)Dest & (sizeof(UINTN) - 1)) != 0) {
+    *(volatile UINT8 *)Dest++ = *Source++;
+    Length--;
+  }
+  while (Length >= sizeof(UINTN)) {
+    AbStreamStore((UINTN *)Dest, *(CONST UINTN *)Source);
+    Dest += sizeof(UINTN);
+    Source += sizeof(UINTN);
+    Length -= sizeof(UINTN);
+  }
+  while (Length > 0) {
+    *(volatile UINT8 *)Dest++ = *Source++;
+    Length--;
+  }
+}
+
+static VOID
+AbRecordBlitTime(
+    GOP_STATE *State,
+    UINT64 StartUs) {
+  BLIT_TIMING *Timing;
+  UINT64 Elapsed;
+
+  Timing = State->DirectWrite ? &State->DirectTiming : &State->GopTiming;
+  Elapsed = AbClockNowUs() - StartUs;
+  Timing->Frames++;
+  Timing->TotalUs += Elapsed;
+  if (Elapsed > Timing->MaxUs) {
+    Timing->MaxUs = Elapsed;
+  }
+}
+
 VOID
 AbSwapBuffers(FRAME_BUFFER **Front, FRAME_BUFFER **Back) {
   FRAME_BUFFER *Temp;
@@ -0,0 +1,441 @@
+#include "JsonToken.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#define AB_JSON_UINT_LIMIT  (MAX_UINT64 / 10)
+
+static CONST CHAR8 *
+AbJsonSkipSpace(
+    CONST CHAR8 *Ptr,
+    CONST CHAR8 *End) {
+  while (Ptr < End && (*Ptr == ' ' || *Ptr == '\t' || *Ptr == '\n' || *Ptr == '\r')) {
+    ++Ptr;
+  }
+  return Ptr;
+}
+
+// Ptr is just past the opening quote; returns the closing quote.
+static CONST CHAR8 *
+AbJsonScanString(
+    CONST CHAR8 *Ptr,
+    CONST CHAR8 *End) {
+  while (Ptr < End) {
+    if (*Ptr == '"') {
+      return Ptr;
+    }
+    if (*Ptr == '\\') {
+      ++Ptr;
+    } else if ((UINT8)*Ptr < 0x20) {
+      return NULL;
+    }
+    ++Ptr;
+  }
+  return NULL;
+}
+
+// Ptr is on the opening bracket; returns the matching closing bracket. Only
+// balance is checked below the first level, which is all the callers need to
+// step over a value they may later tokenize on its own.
+static CONST CHAR8 *
+AbJsonScanContainer(
+    CONST CHAR8 *Ptr,
+    CONST CHAR8 *End,
+    UINT32 *Count) {
+  UINT64 Arrays = 0;           // Bit n set: level n is an array
+  UINT32 Depth = 0;
+  UINT32 Commas = 0;
+  BOOLEAN Empty = TRUE;
+  CHAR8 Ch;
+
+  for (; Ptr < End; ++Ptr) {
+    Ch = *Ptr;
+    switch (Ch) {
+      case '"':
+        Ptr = AbJsonScanString(Ptr + 1, End);
+        if (Ptr == NULL) {
+          return NULL;
+        }
+        Empty = Empty && Depth != 1;
+        break;
+      case '{':
+      case '[':
+        if (Depth == AB_JSON_MAX_DEPTH) {
+          return NULL;
+        }
+        Empty = Empty && Depth != 1;
+        if (Ch == '[') {
+          Arrays |= LShiftU64(1, Depth);
+        } else {
+          Arrays &= ~LShiftU64(1, Depth);
+        }
+        ++Depth;
+        break;
+      case '}':
+      case ']':
+        --Depth;
+        if (((RShiftU64(Arrays, Depth) & 1) != 0) != (Ch == ']')) {
+          return NULL;
+        }
+        if (Depth == 0) {
+          *Count = Empty ? 0 : Commas + 1;
+          return Ptr;
+        }
+        break;
+      case ',':
+        if (Depth == 1) {
+          ++Commas;
+        }
+        break;
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        break;
+      default:
+        Empty = Empty && Depth != 1;
+        break;
+    }
+  }
+  return NULL;
+}
+
+static CONST CHAR8 *
+AbJsonScanLiteral(
+    CONST CHAR8 *Ptr,
+    CONST CHAR8 *End,
+    CONST CHAR8 *Literal,
+    JSON_TYPE Type,
+    JSON_KEY *Key) {
+  UINTN Length = AsciiStrLen(Literal);
+
+  if ((UINTN)(End - Ptr) < Length || CompareMem(Ptr, Literal, Length) != 0) {
+    return NULL;
+  }
+  Key->Type = Type;
+  Key->ValueLength = (UINT32)Length;
+  return Ptr + Length;
+}
+
+// Fills in the value half of Key and returns the first byte after the value.
+static CONST CHAR8 *
+AbJsonScanValue(
+    CONST CHAR8 *Ptr,
+    CONST CHAR8 *End,
+    JSON_KEY *Key) {
+  CONST CHAR8 *Close;
+
+  if (Ptr >= End) {
+    return NULL;
+  }
+  Key->Value = Ptr;
+  Key->Count = 0;
+  switch (*Ptr) {
+    case '"':
+      Close = AbJsonScanString(Ptr + 1, End);
+      if (Close == NULL) {
+        return NULL;
+      }
+      Key->Type = JsonString;
+      Key->Value = Ptr + 1;
+      Key->ValueLength = (UINT32)(Close - Key->Value);
+      return Close + 1;
+    case '{':
+    case '[':
+      Close = AbJsonScanContainer(Ptr, End, &Key->Count);
+      if (Close == NULL) {
+        return NULL;
+      }
+      Key->Type = (*Ptr == '{') ? JsonObject : JsonArray;
+      Key->ValueLength = (UINT32)(Close + 1 - Ptr);
+      return Close + 1;
+    case 't':
+      return AbJsonScanLiteral(Ptr, End, "true", JsonTrue, Key);
+    case 'f':
+      return AbJsonScanLiteral(Ptr, End, "false", JsonFalse, Key);
+    case 'n':
+      return AbJsonScanLiteral(Ptr, End, "null", JsonNull, Key);
+    default:
+      break;
+  }
+
+  Close = Ptr;
+  while (Close < End && ((*Close >= '0' && *Close <= '9') || *Close == '-' || *Close == '+' ||
+                         *Close == '.' || *Close == 'e' || *Close == 'E')) {
+    ++Close;
+  }
+  if (Close == Ptr) {
+    return NULL;
+  }
+  Key->Type = JsonNumber;
+  Key->ValueLength = (UINT32)(Close - Ptr);
+  return Close;
+}
+
+EFI_STATUS
+AbJsonTokenize(
+    CONST CHAR8 *Json,
+    UINTN Length,
+    JSON_KEY_TABLE *Table,
+    UINTN *Consumed) {
+  CONST CHAR8 *End;
+  CONST CHAR8 *Ptr;
+  JSON_KEY Key;
+
+  if (Json == NULL || Table == NULL || Length > MAX_UINT32) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Table->Count = 0;
+  Table->Dropped = 0;
+
+  End = Json + Length;
+  Ptr = Json;
+  // Windows tools like to start UTF-8 files with a byte order mark.
+  if (Length >= 3 && (UINT8)Ptr[0] == 0xEF && (UINT8)Ptr[1] == 0xBB && (UINT8)Ptr[2] == 0xBF) {
+    Ptr += 3;
+  }
+  Ptr = AbJsonSkipSpace(Ptr, End);
+  if (Ptr == End || *Ptr != '{') {
+    return EFI_COMPROMISED_DATA;
+  }
+  Ptr = AbJsonSkipSpace(Ptr + 1, End);
+  if (Ptr < End && *Ptr == '}') {
+    goto Done;
+  }
+
+  for (;;) {
+    if (Ptr == End || *Ptr != '"') {
+      return EFI_COMPROMISED_DATA;
+    }
+    Key.Name = Ptr + 1;
+    Ptr = AbJsonScanString(Key.Name, End);
+    if (Ptr == NULL) {
+      return EFI_COMPROMISED_DATA;
+    }
+    Key.NameLength = (UINT32)(Ptr - Key.Name);
+
+    Ptr = AbJsonSkipSpace(Ptr + 1, End);
+    if (Ptr == End || *Ptr != ':') {
+      return EFI_COMPROMISED_DATA;
+    }
+    Ptr = AbJsonScanValue(AbJsonSkipSpace(Ptr + 1, End), End, &Key);
+    if (Ptr == NULL) {
+      return EFI_COMPROMISED_DATA;
+    }
+    if (Table->Count < AB_JSON_MAX_KEYS) {
+      CopyMem(&Table->Keys[Table->Count++], &Key, sizeof(Key));
+    } else {
+      ++Table->Dropped;
+    }
+
+    Ptr = AbJsonSkipSpace(Ptr, End);
+    if (Ptr == End) {
+      return EFI_COMPROMISED_DATA;
+    }
+    if (*Ptr == '}') {
+      break;
+    }
+    if (*Ptr != ',') {
+      return EFI_COMPROMISED_DATA;
+    }
+    Ptr = AbJsonSkipSpace(Ptr + 1, End);
+  }
+
+Done:
+  if (Consumed != NULL) {
+    *Consumed = (UINTN)(Ptr + 1 - Json);
+  }
+  return EFI_SUCCESS;
+}
+
+CONST JSON_KEY *
+AbJsonFind(
+    CONST JSON_KEY_TABLE *Table,
+    CONST CHAR8 *Name) {
+  UINTN Length;
+  UINT32 Index;
+
+  if (Table == NULL || Name == NULL) {
+    return NULL;
+  }
+  Length = AsciiStrLen(Name);
+  for (Index = 0; Index < Table->Count; ++Index) {
+    if (Table->Keys[Index].NameLength == Length &&
+        CompareMem(Table->Keys[Index].Name, Name, Length) == 0) {
+      return &Table->Keys[Index];
+    }
+  }
+  return NULL;
+}
+
+BOOLEAN
+AbJsonGetUint(
+    CONST JSON_KEY_TABLE *Table,
+    CONST CHAR8 *Name,
+    UINT64 *Value) {
+  CONST JSON_KEY *Key;
+  UINT64 Result = 0;
+  UINT32 Digit;
+  UINT32 Index;
+
+  Key = AbJsonFind(Table, Name);
+  if (Key == NULL || Key->Type != JsonNumber || Value == NULL) {
+    return FALSE;
+  }
+  for (Index = 0; Index < Key->ValueLength; ++Index) {
+    if (Key->Value[Index] < '0' || Key->Value[Index] > '9') {
+      return FALSE;
+    }
+    Digit = (UINT32)(Key->Value[Index] - '0');
+    if (Result > AB_JSON_UINT_LIMIT || (Result == AB_JSON_UINT_LIMIT && Digit > MAX_UINT64 % 10)) {
+      return FALSE;
+    }
+    Result = MultU64x32(Result, 10) + Digit;
+  }
+  *Value = Result;
+  return TRUE;
+}
+
+BOOLEAN
+AbJsonGetBool(
+    CONST JSON_KEY_TABLE *Table,
+    CONST CHAR8 *Name,
+    BOOLEAN *Value) {
+  CONST JSON_KEY *Key;
+
+  Key = AbJsonFind(Table, Name);
+  if (Key == NULL || (Key->Type != JsonTrue && Key->Type != JsonFalse) || Value == NULL) {
+    return FALSE;
+  }
+  *Value = (BOOLEAN)(Key->Type == JsonTrue);
+  return TRUE;
+}
+
+static INT32
+AbJsonHexDigit(CHAR8 Ch) {
+  if (Ch >= '0' && Ch <= '9') {
+    return Ch - '0';
+  }
+  if (Ch >= 'a' && Ch <= 'f') {
+    return Ch - 'a' + 10;
+  }
+  if (Ch >= 'A' && Ch <= 'F') {
+    return Ch - 'A' + 10;
+  }
+  return -1;
+}
+
+BOOLEAN
+AbJsonGetString(
+    CONST JSON_KEY_TABLE *Table,
+    CONST CHAR8 *Name,
+    CHAR8 *Buffer,
+    UINTN BufferSize) {
+  CONST JSON_KEY *Key;
+  CONST CHAR8 *Ptr;
+  CONST CHAR8 *End;
+  UINTN Out = 0;
+  UINT32 CodePoint;
+  UINT32 Index;
+  INT32 Nibble;
+  CHAR8 Ch;
+
+  Key = AbJsonFind(Table, Name);
+  if (Key == NULL || Key->Type != JsonString || Buffer == NULL || BufferSize == 0) {
+    return FALSE;
+  }
+
+  Ptr = Key->Value;
+  End = Key->Value + Key->ValueLength;
+  while (Ptr < End) {
+    Ch = *Ptr++;
+    if (Ch == '\\') {
+      // The tokenizer guarantees a character after every backslash.
+      switch (*Ptr++) {
+        case '"':  Ch = '"';  break;
+        case '\\': Ch = '\\'; break;
+        case '/':  Ch = '/';  break;
+        case 'b':  Ch = '\b'; break;
+        case 'f':  Ch = '\f'; break;
+        case 'n':  Ch = '\n'; break;
+        case 'r':  Ch = '\r'; break;
+        case 't':  Ch = '\t'; break;
+        case 'u':
+          // Paths and option names are ASCII; anything wider is refused.
+          if (End - Ptr < 4) {
+            return FALSE;
+          }
+          CodePoint = 0;
+          for (Index = 0; Index < 4; ++Index) {
+            Nibble = AbJsonHexDigit(*Ptr++);
+            if (Nibble < 0) {
+              return FALSE;
+            }
+            CodePoint = (CodePoint << 4) | (UINT32)Nibble;
+          }
+          if (CodePoint == 0 || CodePoint > 0x7F) {
+            return FALSE;
+          }
+          Ch = (CHAR8)CodePoint;
+          break;
+        default:
+          return FALSE;
+      }
+    }
+    if (Out + 1 >= BufferSize) {
+      return FALSE;
+    }
+    Buffer[Out++] = Ch;
+  }
+  Buffer[Out] = '\0';
+  return TRUE;
+}
+
+BOOLEAN
+AbJsonGetArray(
+    CONST JSON_KEY_TABLE *Table,
+    CONST CHAR8 *Name,
+    JSON_ARRAY_CURSOR *Cursor) {
+  CONST JSON_KEY *Key;
+
+  Key = AbJsonFind(Table, Name);
+  if (Key == NULL || Key->Type != JsonArray || Cursor == NULL) {
+    return FALSE;
+  }
+  Cursor->Next = Key->Value + 1;
+  Cursor->End = Key->Value + Key->ValueLength - 1;
+  Cursor->Index = 0;
+  Cursor->Count = Key->Count;
+  return TRUE;
+}
+
+EFI_STATUS
+AbJsonNextObject(
+    JSON_ARRAY_CURSOR *Cursor,
+    JSON_KEY_TABLE *Object) {
+  CONST CHAR8 *Ptr;
+  UINTN Consumed;
+  EFI_STATUS Status;
+
+  if (Cursor == NULL || Object == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Cursor->Index >= Cursor->Count) {
+    return EFI_NOT_FOUND;
+  }
+
+  Ptr = AbJsonSkipSpace(Cursor->Next, Cursor->End);
+  if (Cursor->Index > 0) {
+    if (Ptr == Cursor->End || *Ptr != ',') {
+      return EFI_COMPROMISED_DATA;
+    }
+    Ptr = AbJsonSkipSpace(Ptr + 1, Cursor->End);
+  }
+  Status = AbJsonTokenize(Ptr, (UINTN)(Cursor->End - Ptr), Object, &Consumed);
+  if (EFI_ERROR(Status)) {
+    return EFI_COMPROMISED_DATA;
+  }
+  Cursor->Next = Ptr + Consumed;
+  ++Cursor->Index;
+  return EFI_SUCCESS;
+}
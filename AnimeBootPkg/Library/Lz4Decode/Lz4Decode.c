@@ -0,0 +1,184 @@
+#include "Lz4Decode.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#define AB_LZ4_MIN_MATCH     4U
+#define AB_LZ4_RUN_MASK      15U
+#define AB_LZ4_WILD_COPY     8U
+
+// Lengths of 15 continue in following bytes, each adding up to 255.
+static BOOLEAN
+AbLz4ReadLength(
+    CONST UINT8 **In,
+    CONST UINT8 *InEnd,
+    UINTN *Length) {
+  UINT8 Byte;
+
+  do {
+    if (*In >= InEnd) {
+      return FALSE;
+    }
+    Byte = *(*In)++;
+    if (*Length > MAX_UINTN - Byte) {
+      return FALSE;
+    }
+    *Length += Byte;
+  } while (Byte == 255);
+  return TRUE;
+}
+
+// Copies Length bytes eight at a time; may write up to seven bytes past the
+// end, which the caller has checked are inside the destination.
+static VOID
+AbLz4WildCopy(
+    UINT8 *Out,
+    CONST UINT8 *In,
+    UINTN Length) {
+  UINT8 *End = Out + Length;
+
+  do {
+    WriteUnaligned64((UINT64 *)Out, ReadUnaligned64((CONST UINT64 *)In));
+    Out += AB_LZ4_WILD_COPY;
+    In += AB_LZ4_WILD_COPY;
+  } while (Out < End);
+}
+
+// Offsets of 1, 2 and 4 (one BGRA pixel) tile an eight-byte word exactly, so
+// the run is stored a word at a time. Same overrun rule as AbLz4WildCopy.
+static VOID
+AbLz4PatternFill(
+    UINT8 *Out,
+    UINTN Offset,
+    UINTN Length) {
+  CONST UINT8 *Match = Out - Offset;
+  UINT8 *End = Out + Length;
+  UINT8 Pattern[AB_LZ4_WILD_COPY];
+  UINT64 Word;
+  UINTN Index;
+
+  for (Index = 0; Index < AB_LZ4_WILD_COPY; ++Index) {
+    Pattern[Index] = Match[Index % Offset];
+  }
+  Word = ReadUnaligned64((CONST UINT64 *)Pattern);
+  do {
+    WriteUnaligned64((UINT64 *)Out, Word);
+    Out += AB_LZ4_WILD_COPY;
+  } while (Out < End);
+}
+
+// A match closer than its length repeats the Offset bytes before Out. Each
+// pass copies everything repeated so far, doubling the run, so long runs of
+// one pixel take a handful of CopyMem calls.
+static VOID
+AbLz4RepeatCopy(
+    UINT8 *Out,
+    UINTN Offset,
+    UINTN Length) {
+  CONST UINT8 *Match = Out - Offset;
+  UINTN Copied;
+  UINTN Chunk;
+
+  if (Length <= 2 * AB_LZ4_WILD_COPY) {
+    for (Copied = 0; Copied < Length; ++Copied) {
+      Out[Copied] = Match[Copied];
+    }
+    return;
+  }
+  for (Copied = 0; Copied < Length; Copied += Chunk) {
+    Chunk = MIN(Copied + Offset, Length - Copied);
+    CopyMem(Out + Copied, Match, Chunk);
+  }
+}
+
+EFI_STATUS
+AbLz4DecodeBlock(
+    CONST UINT8 *Source,
+    UINTN SourceSize,
+    UINT8 *Destination,
+    UINTN DestinationSize,
+    UINTN *DecodedSize) {
+  CONST UINT8 *In;
+  CONST UINT8 *InEnd;
+  UINT8 *Out;
+  UINT8 *OutEnd;
+  UINTN Length;
+  UINTN Offset;
+  UINT8 Token;
+  BOOLEAN Room;
+
+  if (Source == NULL || Destination == NULL || DecodedSize == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *DecodedSize = 0;
+  In = Source;
+  InEnd = Source + SourceSize;
+  Out = Destination;
+  OutEnd = Destination + DestinationSize;
+
+  while (In < InEnd) {
+    Token = *In++;
+
+    Length = Token >> 4;
+    if (Length == AB_LZ4_RUN_MASK && !AbLz4ReadLength(&In, InEnd, &Length)) {
+      return EFI_COMPROMISED_DATA;
+    }
+    if (Length > (UINTN)(InEnd - In) || Length > (UINTN)(OutEnd - Out)) {
+      return EFI_COMPROMISED_DATA;
+    }
+    if ((UINTN)(InEnd - In) >= Length + AB_LZ4_WILD_COPY &&
+        (UINTN)(OutEnd - Out) >= Length + AB_LZ4_WILD_COPY) {
+      if (Length > 0) {
+        AbLz4WildCopy(Out, In, Length);
+      }
+    } else {
+      CopyMem(Out, In, Length);
+    }
+    In += Length;
+    Out += Length;
+
+    // The last sequence is literals only.
+    if (In == InEnd) {
+      break;
+    }
+
+    if ((UINTN)(InEnd - In) < 2) {
+      return EFI_COMPROMISED_DATA;
+    }
+    Offset = (UINTN)In[0] | ((UINTN)In[1] << 8);
+    In += 2;
+    if (Offset == 0 || Offset > (UINTN)(Out - Destination)) {
+      return EFI_COMPROMISED_DATA;
+    }
+
+    Length = Token & AB_LZ4_RUN_MASK;
+    if (Length == AB_LZ4_RUN_MASK && !AbLz4ReadLength(&In, InEnd, &Length)) {
+      return EFI_COMPROMISED_DATA;
+    }
+    Length += AB_LZ4_MIN_MATCH;
+    if (Length > (UINTN)(OutEnd - Out)) {
+      return EFI_COMPROMISED_DATA;
+    }
+
+    Room = (UINTN)(OutEnd - Out) >= Length + AB_LZ4_WILD_COPY;
+    if (Offset >= Length || Offset >= AB_LZ4_WILD_COPY) {
+      if (Room) {
+        // Whatever each word reads is either before Out or already written.
+        AbLz4WildCopy(Out, Out - Offset, Length);
+      } else if (Offset >= Length) {
+        CopyMem(Out, Out - Offset, Length);
+      } else {
+        AbLz4RepeatCopy(Out, Offset, Length);
+      }
+    } else if (Room && (AB_LZ4_WILD_COPY % Offset) == 0) {
+      AbLz4PatternFill(Out, Offset, Length);
+    } else {
+      AbLz4RepeatCopy(Out, Offset, Length);
+    }
+    Out += Length;
+  }
+
+  *DecodedSize = (UINTN)(Out - Destination);
+  return EFI_SUCCESS;
+}
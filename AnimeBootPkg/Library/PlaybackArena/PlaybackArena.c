@@ -0,0 +1,86 @@
+#include "PlaybackArena.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+EFI_STATUS
+AbArenaInit(
+    PLAYBACK_ARENA *Arena,
+    UINT64 Size) {
+  if (Arena == NULL || Size == 0 || Size > MAX_UINTN - EFI_PAGE_SIZE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem(Arena, sizeof(*Arena));
+  Arena->Pages = EFI_SIZE_TO_PAGES((UINTN)Size);
+  Arena->Base = AllocatePages(Arena->Pages);
+  if (Arena->Base == NULL) {
+    Arena->Pages = 0;
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Arena->Size = EFI_PAGES_TO_SIZE(Arena->Pages);
+  return EFI_SUCCESS;
+}
+
+VOID
+AbArenaFree(PLAYBACK_ARENA *Arena) {
+  if (Arena == NULL) {
+    return;
+  }
+  if (Arena->Base != NULL) {
+    FreePages(Arena->Base, Arena->Pages);
+  }
+  ZeroMem(Arena, sizeof(*Arena));
+}
+
+VOID *
+AbArenaAlloc(
+    PLAYBACK_ARENA *Arena,
+    UINT64 Size) {
+  VOID *Block;
+
+  if (Arena == NULL || Arena->Base == NULL || Size == 0 ||
+      AB_ARENA_FOOTPRINT(Size) > Arena->Size - Arena->Used) {
+    return NULL;
+  }
+
+  // The base is page aligned and every footprint a multiple of the alignment.
+  Block = Arena->Base + Arena->Used;
+  Arena->Used += AB_ARENA_FOOTPRINT(Size);
+  return Block;
+}
+
+UINT64
+AbArenaFrameFootprint(
+    UINT32 Width,
+    UINT32 Height) {
+  return AB_ARENA_FOOTPRINT(sizeof(FRAME_BUFFER)) +
+      AB_ARENA_FOOTPRINT((UINT64)Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+}
+
+EFI_STATUS
+AbArenaAllocFrame(
+    PLAYBACK_ARENA *Arena,
+    UINT32 Width,
+    UINT32 Height,
+    FRAME_BUFFER **Frame) {
+  FRAME_BUFFER *Buffer;
+  VOID *Pixels;
+
+  if (Frame == NULL || Width == 0 || Height == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Arena == NULL || AbArenaFrameFootprint(Width, Height) > Arena->Size - Arena->Used) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Buffer = AbArenaAlloc(Arena, sizeof(FRAME_BUFFER));
+  Pixels = AbArenaAlloc(Arena, (UINT64)Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  Buffer->Width = Width;
+  Buffer->Height = Height;
+  Buffer->PitchPixels = Width;
+  Buffer->Pixels = Pixels;
+  *Frame = Buffer;
+  return EFI_SUCCESS;
+}
@@ -1,21 +1,42 @@
 from __future__ import annotations
 
+import hashlib
 import io
 import json
 import struct
 from dataclasses import dataclass
 from pathlib import Path
-from typing import Iterable, List, Sequence
+from typing import Iterable, List, Optional, Sequence
 
+import numpy as np
 from PIL import Image
 
+from .lz4block import compress_block, decompress_block
 from .manifest import FrameEntry, Manifest
 from .utils import align
 
 MAGIC = b"ABANIM\x00"
-HEADER_STRUCT = struct.Struct("<8sHHHHIIIIIIIIII6I")
+HEADER_STRUCT = struct.Struct("<8sHHHHIIIIIIIII6I")
 FRAME_STRUCT = struct.Struct("<QII")
+RECT_STRUCT = struct.Struct("<HHHH")
+VERSION_MAJOR = 1
+# 1.1 added the per-frame rectangle table, 1.2 the hot prefix. Every package
+# abtool writes has a hot prefix, so it always writes 1.2.
+VERSION_MINOR = 2
+FLAG_MANIFEST = 0x1
+FLAG_RAW_FRAMES = 0x2
+FLAG_FRAME_RECTS = 0x4
+FLAG_HOT_PREFIX = 0x8
 ALIGNMENT = 32
+# Raw frames start on a page/sector boundary so the firmware's file read can
+# land them directly in the frame buffer. The hot prefix ends on one too.
+RAW_FRAME_ALIGNMENT = 4096
+HOT_PREFIX_ALIGNMENT = 4096
+
+PIXEL_FORMAT_RAW = 0
+PIXEL_FORMAT_BMP = 1
+PIXEL_FORMAT_LZ4 = 2
+COMPRESSION_CHOICES = ("none", "lz4")
 
 
 @dataclass
@@ -23,39 +44,96 @@ class FramePayload:
     path: Path
     data: bytes
     duration_us: int
+    rect: Optional[tuple[int, int, int, int]] = None   # x, y, width, height on the screen image
+
+
+@dataclass
+class PackStats:
+    frame_count: int
+    pixel_format: int
+    raw_bytes: int        # Decoded BGRA32 size of all frames
+    payload_bytes: int    # Frame bytes actually stored
+    shared_frames: int    # Frames pointing at an earlier identical payload
+    partial_frames: int = 0   # Frames stored as the rectangle that changed
+    folded_frames: int = 0    # Unchanged frames added to the previous frame's duration
+
+    @property
+    def ratio(self) -> float:
+        return self.raw_bytes / self.payload_bytes if self.payload_bytes else 0.0
 
 
 def _detect_pixel_format(path: Path) -> int:
     suffix = path.suffix.lower()
     if suffix == ".raw":
-        return 0
+        return PIXEL_FORMAT_RAW
     if suffix == ".bmp":
-        return 1
-    return 1
+        return PIXEL_FORMAT_BMP
+    return PIXEL_FORMAT_BMP
 
 
-def build_package(manifest: Manifest, root_dir: Path, output: Path) -> None:
+def build_package(
+    manifest: Manifest,
+    root_dir: Path,
+    output: Path,
+    compression: str = "none",
+    delta: bool = False,
+) -> PackStats:
+    if compression not in COMPRESSION_CHOICES:
+        raise ValueError(f"Unknown compression '{compression}'")
     manifest.ensure_frames()
     frames = _load_frames(manifest.frames, root_dir)
+    source_count = len(frames)
     pixel_format = _detect_pixel_format(frames[0].path)
+    frame_bytes = manifest.logical_width * manifest.logical_height * 4
+    frame_alignment = 1
+    if pixel_format == PIXEL_FORMAT_RAW or compression == "lz4" or delta:
+        for frame in frames:
+            frame.data = _frame_to_bgra(frame, manifest.logical_width, manifest.logical_height)
+    if delta:
+        # Rectangles are cut from decoded pixels, so BMP input is stored raw.
+        if pixel_format == PIXEL_FORMAT_BMP:
+            pixel_format = PIXEL_FORMAT_RAW
+        frames = _crop_to_changes(frames, manifest)
+    if compression == "lz4":
+        pixel_format = PIXEL_FORMAT_LZ4
+        # Frame 0 is read before anything else is on screen, so it gets the
+        # extra compression effort.
+        for index, frame in enumerate(frames):
+            frame.data = compress_block(frame.data, best=index == 0)
+    elif pixel_format == PIXEL_FORMAT_RAW and not delta:
+        frame_alignment = RAW_FRAME_ALIGNMENT
+    # The player only needs the settings; the frame list stays in the source
+    # manifest and out of the hot prefix.
     manifest_dict = manifest.to_dict()
+    del manifest_dict["frames"]
     manifest_bytes = json.dumps(manifest_dict, separators=(",", ":")).encode("utf-8")
 
     frame_table_offset = align(HEADER_STRUCT.size + len(manifest_bytes), ALIGNMENT)
-    frame_data_offset = align(frame_table_offset + len(frames) * FRAME_STRUCT.size, ALIGNMENT)
+    table_end = frame_table_offset + len(frames) * FRAME_STRUCT.size
+    rect_table_offset = 0
+    if delta:
+        rect_table_offset = align(table_end, ALIGNMENT)
+        table_end = rect_table_offset + len(frames) * RECT_STRUCT.size
+    # Header, manifest, tables and frame 0 sit back to back so the firmware
+    # gets everything for the first image in one read.
+    frame_data_offset = align(table_end, ALIGNMENT)
+    hot_prefix_size = align(frame_data_offset + len(frames[0].data), HOT_PREFIX_ALIGNMENT)
 
     target_fps = 0
     if manifest.frame_duration_us:
         target_fps = int(round(1_000_000 / manifest.frame_duration_us))
     flags = 0
     if manifest_bytes:
-        flags |= 0x1
-    if pixel_format == 0:
-        flags |= 0x2
+        flags |= FLAG_MANIFEST
+    if pixel_format == PIXEL_FORMAT_RAW:
+        flags |= FLAG_RAW_FRAMES
+    if delta:
+        flags |= FLAG_FRAME_RECTS
+    flags |= FLAG_HOT_PREFIX
     header = HEADER_STRUCT.pack(
         MAGIC,
-        1,
-        0,
+        VERSION_MAJOR,
+        VERSION_MINOR,
         HEADER_STRUCT.size,
         flags,
         len(manifest_bytes),
@@ -67,8 +145,8 @@ def build_package(manifest: Manifest, root_dir: Path, output: Path) -> None:
         pixel_format,
         target_fps,
         manifest.loop_count,
-        0,
-        0,
+        rect_table_offset,
+        hot_prefix_size,
         0,
         0,
         0,
@@ -80,15 +158,51 @@ def build_package(manifest: Manifest, root_dir: Path, output: Path) -> None:
         fp.write(manifest_bytes)
         fp.write(b"\x00" * (frame_table_offset - HEADER_STRUCT.size - len(manifest_bytes)))
 
+        # Identical frames share one payload; the player also recognises a
+        # descriptor repeating the previous one and just holds the image.
         table_bytes = bytearray()
+        stored: List[tuple[FramePayload, int]] = []
+        shared: dict[bytes, int] = {}
         cursor = 0
-        for frame in frames:
-            table_bytes += FRAME_STRUCT.pack(cursor, len(frame.data), frame.duration_us)
-            cursor += len(frame.data)
+        for index, frame in enumerate(frames):
+            digest = hashlib.sha256(frame.data).digest()
+            offset = shared.get(digest)
+            if offset is None:
+                if index > 0:
+                    # Alignment is of the file position, not of the offset.
+                    cursor = align(max(cursor + frame_data_offset, hot_prefix_size), frame_alignment)
+                    cursor -= frame_data_offset
+                offset = cursor
+                shared[digest] = offset
+                stored.append((frame, offset))
+                cursor += len(frame.data)
+            table_bytes += FRAME_STRUCT.pack(offset, len(frame.data), frame.duration_us)
+        if delta:
+            table_bytes += b"\x00" * (rect_table_offset - frame_table_offset - len(table_bytes))
+            for frame in frames:
+                table_bytes += RECT_STRUCT.pack(*frame.rect)
         fp.write(table_bytes)
         fp.write(b"\x00" * (frame_data_offset - frame_table_offset - len(table_bytes)))
-        for frame in frames:
+        cursor = 0
+        for frame, offset in stored:
+            fp.write(b"\x00" * (offset - cursor))
             fp.write(frame.data)
+            cursor = offset + len(frame.data)
+        # A package whose frames all fit in the prefix is padded out to it.
+        fp.write(b"\x00" * max(0, hot_prefix_size - frame_data_offset - cursor))
+
+    return PackStats(
+        frame_count=len(frames),
+        pixel_format=pixel_format,
+        raw_bytes=frame_bytes * len(frames),
+        payload_bytes=sum(len(frame.data) for frame, _ in stored),
+        shared_frames=len(frames) - len(stored),
+        partial_frames=sum(
+            1 for frame in frames
+            if frame.rect is not None and frame.rect[2:] != (manifest.logical_width, manifest.logical_height)
+        ),
+        folded_frames=source_count - len(frames),
+    )
 
 
 def _load_frames(entries: Sequence[FrameEntry], root_dir: Path) -> List[FramePayload]:
@@ -100,6 +214,57 @@ def _load_frames(entries: Sequence[FrameEntry], root_dir: Path) -> List[FramePay
     return payloads
 
 
+def _crop_to_changes(frames: List[FramePayload], manifest: Manifest) -> List[FramePayload]:
+    """Cut every frame after the first down to the bounding box of what changed.
+
+    Frame 0 stays whole since each loop starts from it. A frame identical to
+    the one before it has nothing to store and just extends that frame.
+    """
+    width = manifest.logical_width
+    height = manifest.logical_height
+    kept: List[FramePayload] = []
+    previous: Optional[np.ndarray] = None
+    for frame in frames:
+        pixels = np.frombuffer(frame.data, dtype=np.uint32).reshape(height, width)
+        if previous is None:
+            frame.rect = (0, 0, width, height)
+            kept.append(frame)
+            previous = pixels
+            continue
+        changed = pixels != previous
+        rows = np.flatnonzero(changed.any(axis=1))
+        if rows.size == 0:
+            last = kept[-1]
+            last.duration_us = (last.duration_us or manifest.frame_duration_us) + (
+                frame.duration_us or manifest.frame_duration_us
+            )
+            continue
+        cols = np.flatnonzero(changed[rows[0] : rows[-1] + 1].any(axis=0))
+        top, bottom = int(rows[0]), int(rows[-1]) + 1
+        left, right = int(cols[0]), int(cols[-1]) + 1
+        frame.rect = (left, top, right - left, bottom - top)
+        frame.data = pixels[top:bottom, left:right].tobytes()
+        kept.append(frame)
+        previous = pixels
+    return kept
+
+
+def _frame_to_bgra(frame: FramePayload, width: int, height: int) -> bytes:
+    """Return the frame as top-down BGRA32 rows without padding."""
+    expected = width * height * 4
+    if frame.path.suffix.lower() == ".raw":
+        if len(frame.data) != expected:
+            raise ValueError(
+                f"{frame.path}: raw frame is {len(frame.data)} bytes, expected {expected} "
+                f"({width}x{height} BGRA32, no row padding)"
+            )
+        return frame.data
+    image = Image.open(io.BytesIO(frame.data)).convert("RGBA")
+    if image.size != (width, height):
+        raise ValueError(f"{frame.path}: frame is {image.size[0]}x{image.size[1]}, expected {width}x{height}")
+    return image.tobytes("raw", "BGRA")
+
+
 @dataclass
 class LoadedFrame:
     image: Image.Image
@@ -119,15 +284,17 @@ def load_package(path: Path) -> LoadedPackage:
     with path.open("rb") as fp:
         header_data = fp.read(HEADER_STRUCT.size)
         header = HEADER_STRUCT.unpack(header_data)
-        if header[0] != MAGIC:
+        if header[0][: len(MAGIC)] != MAGIC:
             raise ValueError("Invalid magic")
         manifest_size = header[5]
         frame_count = header[6]
         frame_table_offset = header[7]
         frame_data_offset = header[8]
+        flags = header[4]
         width = header[9]
         height = header[10]
         pixel_format = header[11]
+        rect_table_offset = header[14]
 
         manifest_bytes = fp.read(manifest_size)
         manifest = Manifest.from_dict(json.loads(manifest_bytes.decode("utf-8")))
@@ -136,11 +303,21 @@ def load_package(path: Path) -> LoadedPackage:
         descriptors = [
             FRAME_STRUCT.unpack(fp.read(FRAME_STRUCT.size)) for _ in range(frame_count)
         ]
+        rects = [(0, 0, width, height)] * frame_count
+        if flags & FLAG_FRAME_RECTS:
+            fp.seek(rect_table_offset)
+            rects = [RECT_STRUCT.unpack(fp.read(RECT_STRUCT.size)) for _ in range(frame_count)]
         frames: List[LoadedFrame] = []
-        for offset, length, duration_us in descriptors:
+        screen = Image.new("RGBA", (width, height))
+        for (offset, length, duration_us), (x, y, rect_width, rect_height) in zip(descriptors, rects):
             fp.seek(frame_data_offset + offset)
             payload = fp.read(length)
-            image = _decode_frame(payload, width, height, pixel_format)
+            image = _decode_frame(payload, rect_width, rect_height, pixel_format)
+            if (rect_width, rect_height) != (width, height):
+                screen = screen.copy()
+                screen.paste(image, (x, y))
+                image = screen
+            screen = image
             frames.append(LoadedFrame(image=image, duration_us=duration_us))
         return LoadedPackage(
             manifest=manifest,
@@ -152,7 +329,10 @@ def load_package(path: Path) -> LoadedPackage:
 
 
 def _decode_frame(payload: bytes, width: int, height: int, pixel_format: int) -> Image.Image:
-    if pixel_format == 0:
+    if pixel_format == PIXEL_FORMAT_LZ4:
+        payload = decompress_block(payload, width * height * 4)
+        pixel_format = PIXEL_FORMAT_RAW
+    if pixel_format == PIXEL_FORMAT_RAW:
         return Image.frombuffer("RGBA", (width, height), payload, "raw", "BGRA", 0, 1)  # type: ignore
     return Image.open(io.BytesIO(payload)).convert("RGBA")
 
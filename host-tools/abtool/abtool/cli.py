@@ -4,9 +4,18 @@ import argparse
 import logging
 from pathlib import Path
 
-from .anim_package import build_package
-from .frames import DecodedFrame, export_frames_to_bmp, load_media_frames, resize_frame
+from .anim_package import COMPRESSION_CHOICES, PIXEL_FORMAT_LZ4, build_package
+from .frames import (
+    DEFAULT_MERGE_THRESHOLD,
+    DecodedFrame,
+    export_frames_to_bmp,
+    find_loop_cut,
+    load_media_frames,
+    merge_similar_frames,
+    resize_frame,
+)
 from .manifest import FrameEntry, build_manifest_from_frames, load_manifest, save_manifest
+from .poster import MAX_SPLASH_BYTES, write_poster_source
 from .preview import PreviewPlayer
 
 LOG = logging.getLogger("abtool")
@@ -28,11 +37,46 @@ def main(argv: list[str] | None = None) -> int:
     extract_parser.add_argument("--background", default="#000000")
     extract_parser.add_argument("--manifest", type=Path, default=None)
     extract_parser.add_argument("--prefix", default="frame")
+    extract_parser.add_argument(
+        "--merge-threshold",
+        type=float,
+        default=DEFAULT_MERGE_THRESHOLD,
+        help="Merge consecutive frames whose largest 8x8 block luma change is at most this (0-255, default 0: off)",
+    )
+    extract_parser.add_argument(
+        "--loop-cut",
+        action="store_true",
+        help="Keep only the first cycle when the clip repeats itself seamlessly",
+    )
 
     pack_parser = subparsers.add_parser("pack", help="Pack manifest and frames into .anim container")
     pack_parser.add_argument("manifest", type=Path)
     pack_parser.add_argument("output", type=Path)
     pack_parser.add_argument("--frames-root", type=Path, default=None, help="Override frame root directory")
+    pack_parser.add_argument(
+        "--compress",
+        choices=COMPRESSION_CHOICES,
+        default="none",
+        help="Store frames as LZ4-compressed BGRA32 (decoded by the firmware player)",
+    )
+    pack_parser.add_argument(
+        "--delta",
+        action="store_true",
+        help="Store each frame as the rectangle that changed since the previous one (format 1.1)",
+    )
+
+    poster_parser = subparsers.add_parser(
+        "poster", help="Write a package frame as SplashFrame.c to build into AnimeBoot.efi"
+    )
+    poster_parser.add_argument("package", type=Path)
+    poster_parser.add_argument("output", type=Path)
+    poster_parser.add_argument("--frame", type=int, default=0, help="Frame of the package to use")
+    poster_parser.add_argument(
+        "--max-bytes",
+        type=int,
+        default=MAX_SPLASH_BYTES,
+        help="Fail if the compressed frame is larger than this",
+    )
 
     preview_parser = subparsers.add_parser("preview", help="Preview .anim in a window")
     preview_parser.add_argument("package", type=Path)
@@ -44,6 +88,8 @@ def main(argv: list[str] | None = None) -> int:
         command_extract(args)
     elif args.command == "pack":
         command_pack(args)
+    elif args.command == "poster":
+        command_poster(args)
     elif args.command == "preview":
         command_preview(args)
     else:
@@ -57,6 +103,15 @@ def command_extract(args: argparse.Namespace) -> None:
     for frame in frames:
         resized = resize_frame(frame.image, args.width, args.height, args.scaling, args.background)
         processed.append(DecodedFrame(image=resized, duration_us=frame.duration_us))
+    source_count = len(processed)
+    if args.loop_cut:
+        cut = find_loop_cut(processed, args.merge_threshold)
+        if cut is not None:
+            LOG.info("Loop cut after %d of %d frames", cut, len(processed))
+            processed = processed[:cut]
+    processed = merge_similar_frames(processed, args.merge_threshold)
+    if len(processed) != source_count:
+        LOG.info("Kept %d of %d source frames", len(processed), source_count)
     frame_paths = export_frames_to_bmp(processed, args.output, args.prefix)
     manifest_frames = [
         FrameEntry(path=Path(path.name), duration_us=frame.duration_us)
@@ -81,8 +136,37 @@ def command_pack(args: argparse.Namespace) -> None:
     manifest = load_manifest(manifest_path)
     root_dir = args.frames_root or manifest_path.parent
     output_path = args.output
-    build_package(manifest, root_dir, output_path)
+    stats = build_package(manifest, root_dir, output_path, compression=args.compress, delta=args.delta)
     LOG.info("Package written to %s", output_path)
+    if args.delta:
+        LOG.info(
+            "Delta: %d of %d frames store only their changed rectangle, %d unchanged frames folded",
+            stats.partial_frames,
+            stats.frame_count,
+            stats.folded_frames,
+        )
+    if stats.shared_frames:
+        LOG.info("Dedup: %d of %d frames reuse an identical earlier payload", stats.shared_frames, stats.frame_count)
+    if stats.pixel_format == PIXEL_FORMAT_LZ4:
+        LOG.info(
+            "LZ4: %d frames, %d KiB of pixels stored in %d KiB (%.2fx)",
+            stats.frame_count,
+            stats.raw_bytes // 1024,
+            stats.payload_bytes // 1024,
+            stats.ratio,
+        )
+
+
+def command_poster(args: argparse.Namespace) -> None:
+    stats = write_poster_source(args.package, args.output, args.frame, args.max_bytes)
+    LOG.info("Poster source written to %s", args.output)
+    LOG.info(
+        "Poster: %dx%d, %d KiB of pixels adds %d KiB to AnimeBoot.efi",
+        stats.width,
+        stats.height,
+        stats.raw_bytes // 1024,
+        (stats.block_bytes + 1023) // 1024,
+    )
 
 
 def command_preview(args: argparse.Namespace) -> None:
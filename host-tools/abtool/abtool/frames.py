@@ -13,6 +13,15 @@ from .utils import parse_hex_color
 
 LOG = logging.getLogger(__name__)
 
+# Side of the luma blocks compared by the perceptual difference. Averaging
+# over blocks hides codec noise and dithering but keeps a mouth flap or a
+# blink, which change a few blocks a lot.
+SIGNATURE_BLOCK = 8
+# Merging is lossy, so it is off unless asked for.
+DEFAULT_MERGE_THRESHOLD = 0.0
+# A loop shorter than this is more likely a held pose than a cycle.
+MIN_LOOP_FRAMES = 2
+
 
 @dataclass
 class DecodedFrame:
@@ -61,6 +70,66 @@ def _load_single_image(path: Path, fallback_fps: int) -> List[DecodedFrame]:
     return [DecodedFrame(image=image, duration_us=duration)]
 
 
+def frame_signature(image: Image.Image) -> np.ndarray:
+    """Block-averaged luma used to compare frames perceptually."""
+    rgb = np.asarray(image.convert("RGB"), dtype=np.float32)
+    luma = rgb @ np.array([0.299, 0.587, 0.114], dtype=np.float32)
+    height, width = luma.shape
+    rows, cols = height // SIGNATURE_BLOCK, width // SIGNATURE_BLOCK
+    if rows == 0 or cols == 0:
+        return luma
+    blocks = luma[: rows * SIGNATURE_BLOCK, : cols * SIGNATURE_BLOCK]
+    return blocks.reshape(rows, SIGNATURE_BLOCK, cols, SIGNATURE_BLOCK).mean(axis=(1, 3))
+
+
+def frame_difference(a: np.ndarray, b: np.ndarray) -> float:
+    """Largest block luma change between two signatures, 0-255."""
+    return float(np.abs(a - b).max())
+
+
+def merge_similar_frames(frames: Sequence[DecodedFrame], threshold: float) -> List[DecodedFrame]:
+    """Collapse runs of near-identical frames into one longer frame.
+
+    Each frame is compared with the first frame of the current run rather than
+    with its predecessor, so a slow pan cannot creep past the threshold one
+    small step at a time. Animation drawn on twos or threes comes out with one
+    frame per drawing.
+    """
+    if threshold <= 0:
+        return list(frames)
+    merged: List[DecodedFrame] = []
+    anchor: np.ndarray | None = None
+    for frame in frames:
+        signature = frame_signature(frame.image)
+        if anchor is not None and frame_difference(anchor, signature) <= threshold:
+            merged[-1].duration_us += frame.duration_us
+            continue
+        merged.append(DecodedFrame(image=frame.image, duration_us=frame.duration_us))
+        anchor = signature
+    return merged
+
+
+def find_loop_cut(frames: Sequence[DecodedFrame], threshold: float) -> int | None:
+    """Return the length of the shortest cycle the sequence repeats, if any.
+
+    A cut at k is seamless when every frame from k on matches the frame k
+    positions earlier, both in content and duration: playing frames[:k] in a
+    loop then shows exactly what the full clip would.
+    """
+    count = len(frames)
+    if count < 2 * MIN_LOOP_FRAMES:
+        return None
+    signatures = [frame_signature(frame.image) for frame in frames]
+    for cut in range(MIN_LOOP_FRAMES, count // 2 + 1):
+        if all(
+            frames[index].duration_us == frames[index - cut].duration_us
+            and frame_difference(signatures[index], signatures[index - cut]) <= threshold
+            for index in range(cut, count)
+        ):
+            return cut
+    return None
+
+
 def resize_frame(
     frame: Image.Image,
     width: int,
@@ -0,0 +1,163 @@
+"""LZ4 block format (no frame header), as decoded by AnimeBoot's Lz4DecodeLib."""
+
+from __future__ import annotations
+
+try:  # The C extension is much faster when installed; the output is the same format.
+    import lz4.block as _lz4_block
+except ImportError:  # pragma: no cover - depends on the environment
+    _lz4_block = None
+
+MIN_MATCH = 4
+# The format requires the last match to start at least 12 bytes before the
+# end and the last 5 bytes to be literals.
+MF_LIMIT = 12
+LAST_LITERALS = 5
+MAX_OFFSET = 0xFFFF
+# After this many misses in a row the search step grows, so incompressible
+# stretches are skipped quickly.
+SKIP_TRIGGER = 6
+
+
+# Highest LZ4HC level; slow to compress, no slower to decode.
+HC_MAX_LEVEL = 12
+
+
+def compress_block(data: bytes, best: bool = False) -> bytes:
+    """Compress data into a single LZ4 block.
+
+    best trades packing time for a smaller block: the maximum HC level, or
+    no search acceleration in the pure Python fallback.
+    """
+    if _lz4_block is not None:
+        if best:
+            return _lz4_block.compress(
+                data, mode="high_compression", compression=HC_MAX_LEVEL, store_size=False
+            )
+        return _lz4_block.compress(data, mode="high_compression", store_size=False)
+
+    data = bytes(data)
+    size = len(data)
+    out = bytearray()
+    anchor = 0
+    if size > MF_LIMIT:
+        table: dict[bytes, int] = {}
+        match_limit = size - LAST_LITERALS
+        pos = 0
+        misses = 0
+        while pos < size - MF_LIMIT:
+            key = data[pos : pos + MIN_MATCH]
+            candidate = table.get(key)
+            table[key] = pos
+            if candidate is None or pos - candidate > MAX_OFFSET:
+                misses += 1
+                pos += 1 if best else 1 + (misses >> SKIP_TRIGGER)
+                continue
+
+            # Extend backwards into pending literals, then forwards.
+            while pos > anchor and candidate > 0 and data[pos - 1] == data[candidate - 1]:
+                pos -= 1
+                candidate -= 1
+            length = _match_length(data, candidate, pos, match_limit - pos)
+            _emit_sequence(out, data, anchor, pos, pos - candidate, length)
+            pos += length
+            anchor = pos
+            misses = 0
+            if pos - 2 < size - MF_LIMIT:
+                table[data[pos - 2 : pos - 2 + MIN_MATCH]] = pos - 2
+    _emit_literals(out, data, anchor, size)
+    return bytes(out)
+
+
+def decompress_block(block: bytes, size: int) -> bytes:
+    """Decode an LZ4 block that must expand to exactly size bytes."""
+    if _lz4_block is not None:
+        return _lz4_block.decompress(block, uncompressed_size=size)
+
+    out = bytearray()
+    pos = 0
+    end = len(block)
+    while pos < end:
+        token = block[pos]
+        pos += 1
+        literals, pos = _read_length(block, pos, token >> 4)
+        if pos + literals > end:
+            raise ValueError("LZ4 literals run past the end of the block")
+        out += block[pos : pos + literals]
+        pos += literals
+        if pos == end:
+            break
+        if pos + 2 > end:
+            raise ValueError("LZ4 block truncated inside a match offset")
+        offset = block[pos] | (block[pos + 1] << 8)
+        pos += 2
+        if offset == 0 or offset > len(out):
+            raise ValueError("LZ4 match offset out of range")
+        length, pos = _read_length(block, pos, token & 0x0F)
+        length += MIN_MATCH
+        start = len(out) - offset
+        # Overlapping matches repeat the last offset bytes; grow the run by
+        # doubling instead of byte by byte.
+        while length > 0:
+            chunk = out[start : start + min(length, len(out) - start)]
+            out += chunk
+            length -= len(chunk)
+    if len(out) != size:
+        raise ValueError(f"LZ4 block expands to {len(out)} bytes, expected {size}")
+    return bytes(out)
+
+
+def _match_length(data: bytes, candidate: int, pos: int, limit: int) -> int:
+    length = 0
+    step = 16
+    while length < limit:
+        count = min(step, limit - length)
+        if data[candidate + length : candidate + length + count] == data[pos + length : pos + length + count]:
+            length += count
+            step = min(step * 2, 1 << 16)
+        elif count <= 16:
+            while length < limit and data[candidate + length] == data[pos + length]:
+                length += 1
+            break
+        else:
+            step = count // 4
+    return length
+
+
+def _emit_sequence(out: bytearray, data: bytes, anchor: int, pos: int, offset: int, length: int) -> None:
+    literals = pos - anchor
+    match = length - MIN_MATCH
+    out.append((min(literals, 15) << 4) | min(match, 15))
+    _write_length(out, literals)
+    out += data[anchor:pos]
+    out += offset.to_bytes(2, "little")
+    _write_length(out, match)
+
+
+def _emit_literals(out: bytearray, data: bytes, anchor: int, end: int) -> None:
+    literals = end - anchor
+    out.append(min(literals, 15) << 4)
+    _write_length(out, literals)
+    out += data[anchor:end]
+
+
+def _write_length(out: bytearray, value: int) -> None:
+    if value < 15:
+        return
+    value -= 15
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+
+
+def _read_length(block: bytes, pos: int, value: int) -> tuple[int, int]:
+    if value != 15:
+        return value, pos
+    while True:
+        if pos >= len(block):
+            raise ValueError("LZ4 block truncated inside a length")
+        byte = block[pos]
+        pos += 1
+        value += byte
+        if byte != 255:
+            return value, pos
@@ -23,11 +23,19 @@ class Manifest:
     logical_width: int = DEFAULT_WIDTH
     logical_height: int = DEFAULT_HEIGHT
     scaling: str = "letterbox"
+    scale_filter: str = "auto"
     background: str = "#000000"
     max_memory: int = DEFAULT_MAX_MEMORY
     loop_count: int = 1
     frame_duration_us: int = DEFAULT_FRAME_DURATION_US
     allow_key_skip: bool = True
+    allow_frame_drop: bool = True
+    cache_frames: bool = True
+    direct_framebuffer: bool = False
+    select_mode: bool = True
+    decode_workers: int = 8
+    async_io: bool = True
+    preload_percent: int = 50
     max_total_duration_ms: int = 0
     frames: List[FrameEntry] = field(default_factory=list)
 
@@ -41,11 +49,19 @@ class Manifest:
             logical_width=int(data.get("logical_width", DEFAULT_WIDTH)),
             logical_height=int(data.get("logical_height", DEFAULT_HEIGHT)),
             scaling=data.get("scaling", "letterbox"),
+            scale_filter=data.get("scale_filter", "auto"),
             background=data.get("background", "#000000"),
             max_memory=int(data.get("max_memory", DEFAULT_MAX_MEMORY)),
             loop_count=int(data.get("loop_count", 1)),
             frame_duration_us=int(data.get("frame_duration_us", DEFAULT_FRAME_DURATION_US)),
             allow_key_skip=bool(data.get("allow_key_skip", True)),
+            allow_frame_drop=bool(data.get("allow_frame_drop", True)),
+            cache_frames=bool(data.get("cache_frames", True)),
+            direct_framebuffer=bool(data.get("direct_framebuffer", False)),
+            select_mode=bool(data.get("select_mode", True)),
+            decode_workers=int(data.get("decode_workers", 8)),
+            async_io=bool(data.get("async_io", True)),
+            preload_percent=int(data.get("preload_percent", 50)),
             max_total_duration_ms=int(data.get("max_total_duration_ms", 0)),
             frames=frames,
         )
@@ -55,11 +71,19 @@ class Manifest:
             "logical_width": self.logical_width,
             "logical_height": self.logical_height,
             "scaling": self.scaling,
+            "scale_filter": self.scale_filter,
             "background": self.background,
             "max_memory": self.max_memory,
             "loop_count": self.loop_count,
             "frame_duration_us": self.frame_duration_us,
             "allow_key_skip": self.allow_key_skip,
+            "allow_frame_drop": self.allow_frame_drop,
+            "cache_frames": self.cache_frames,
+            "direct_framebuffer": self.direct_framebuffer,
+            "select_mode": self.select_mode,
+            "decode_workers": self.decode_workers,
+            "async_io": self.async_io,
+            "preload_percent": self.preload_percent,
             "max_total_duration_ms": self.max_total_duration_ms,
             "frames": [
                 {"path": str(entry.path).replace("\\", "/"), "duration_us": entry.duration_us}
@@ -0,0 +1,74 @@
+"""Poster frame compiled into AnimeBoot.efi (SplashFrame.c)."""
+
+from __future__ import annotations
+
+from dataclasses import dataclass
+from pathlib import Path
+
+from .anim_package import load_package
+from .lz4block import compress_block
+
+# Matches AB_MAX_SPLASH_BYTES in SplashFrame.h.
+MAX_SPLASH_BYTES = 256 * 1024
+BYTES_PER_LINE = 16
+
+
+@dataclass
+class PosterStats:
+    width: int
+    height: int
+    raw_bytes: int
+    block_bytes: int
+
+
+def write_poster_source(package_path: Path, output: Path, frame_index: int = 0,
+                        max_bytes: int = MAX_SPLASH_BYTES) -> PosterStats:
+    """Write frame_index of the package as an LZ4-compressed C array.
+
+    The poster keeps the package's size, scaling and mode selection so the
+    firmware shows it exactly where the animation will appear.
+    """
+    if max_bytes > MAX_SPLASH_BYTES:
+        raise ValueError(f"Poster limit cannot exceed {MAX_SPLASH_BYTES} bytes (AB_MAX_SPLASH_BYTES)")
+    package = load_package(package_path)
+    if not 0 <= frame_index < len(package.frames):
+        raise ValueError(f"{package_path}: no frame {frame_index} (package has {len(package.frames)})")
+    pixels = package.frames[frame_index].image.convert("RGBA").tobytes("raw", "BGRA")
+    block = compress_block(pixels, best=True)
+    if len(block) > max_bytes:
+        raise ValueError(
+            f"Poster frame compresses to {len(block)} bytes, over the {max_bytes} byte limit; "
+            "use a simpler frame or a smaller package"
+        )
+
+    manifest = package.manifest
+    lines = [
+        f"// Generated by abtool poster from {package_path.name}, frame {frame_index}. Do not edit.",
+        f"// {package.width}x{package.height} BGRA32, {len(pixels)} bytes as a {len(block)} byte LZ4 block.",
+        "",
+        '#include "SplashFrame.h"',
+        "",
+        f"CONST UINT32  gAbSplashWidth = {package.width};",
+        f"CONST UINT32  gAbSplashHeight = {package.height};",
+        f"CONST BOOLEAN gAbSplashSelectMode = {'TRUE' if manifest.select_mode else 'FALSE'};",
+        f'CONST CHAR8   gAbSplashScaling[16] = "{manifest.scaling}";',
+        f'CONST CHAR8   gAbSplashScaleFilter[16] = "{manifest.scale_filter}";',
+        f"CONST UINT32  gAbSplashSize = {len(block)};",
+        f"CONST UINT8   gAbSplashData[{len(block)}] = {{",
+    ]
+    for start in range(0, len(block), BYTES_PER_LINE):
+        chunk = block[start : start + BYTES_PER_LINE]
+        lines.append("  " + " ".join(f"0x{byte:02x}," for byte in chunk))
+    lines += [
+        "};",
+        "",
+        'STATIC_ASSERT (sizeof (gAbSplashData) <= AB_MAX_SPLASH_BYTES, "Splash frame too large");',
+        "",
+    ]
+    output.write_text("\n".join(lines), encoding="ascii", newline="\n")
+    return PosterStats(
+        width=package.width,
+        height=package.height,
+        raw_bytes=len(pixels),
+        block_bytes=len(block),
+    )
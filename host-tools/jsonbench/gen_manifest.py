@@ -0,0 +1,47 @@
+"""Write synthetic loose manifests for jsonbench.
+
+The default layout is exactly what `abtool extract` writes (save_manifest,
+indent=2, every playback field before "frames"). --frames-only leaves the
+playback fields out, as a hand-written manifest might, which is the case
+where every missing field used to cost a scan of the whole document.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "abtool"))
+
+from abtool.manifest import FrameEntry, Manifest, save_manifest  # noqa: E402
+
+
+def build_manifest(frame_count: int) -> Manifest:
+    manifest = Manifest()
+    manifest.frames = [
+        # Slightly uneven durations, like a 24 fps clip resampled from video.
+        FrameEntry(path=Path(f"frames/frame{index:05d}.bmp"), duration_us=41666 + index % 3)
+        for index in range(frame_count)
+    ]
+    return manifest
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output", type=Path)
+    parser.add_argument("--frames", type=int, default=4096)
+    parser.add_argument("--frames-only", action="store_true", help="Omit the playback fields")
+    args = parser.parse_args()
+
+    manifest = build_manifest(args.frames)
+    if args.frames_only:
+        data = {"frames": manifest.to_dict()["frames"]}
+        args.output.write_text(json.dumps(data, indent=2), encoding="utf-8")
+    else:
+        save_manifest(args.output, manifest)
+
+
+if __name__ == "__main__":
+    main()
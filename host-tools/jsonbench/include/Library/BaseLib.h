@@ -0,0 +1,40 @@
+#ifndef JSONBENCH_BASE_LIB_H_
+#define JSONBENCH_BASE_LIB_H_
+
+#include <Uefi.h>
+
+UINTN
+AsciiStrLen(CONST CHAR8 *String);
+
+CHAR8 *
+AsciiStrStr(
+  CONST CHAR8 *String,
+  CONST CHAR8 *SearchString
+  );
+
+RETURN_STATUS
+AsciiStrDecimalToUint64S(
+  CONST CHAR8 *String,
+  CHAR8 **EndPointer,
+  UINT64 *Data
+  );
+
+UINT64
+LShiftU64(
+  UINT64 Operand,
+  UINTN Count
+  );
+
+UINT64
+RShiftU64(
+  UINT64 Operand,
+  UINTN Count
+  );
+
+UINT64
+MultU64x32(
+  UINT64 Multiplicand,
+  UINT32 Multiplier
+  );
+
+#endif  // JSONBENCH_BASE_LIB_H_
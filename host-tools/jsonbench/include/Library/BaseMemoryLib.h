@@ -0,0 +1,20 @@
+#ifndef JSONBENCH_BASE_MEMORY_LIB_H_
+#define JSONBENCH_BASE_MEMORY_LIB_H_
+
+#include <Uefi.h>
+
+VOID *
+CopyMem(
+  VOID *Destination,
+  CONST VOID *Source,
+  UINTN Length
+  );
+
+INTN
+CompareMem(
+  CONST VOID *Destination,
+  CONST VOID *Source,
+  UINTN Length
+  );
+
+#endif  // JSONBENCH_BASE_MEMORY_LIB_H_
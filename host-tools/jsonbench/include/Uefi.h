@@ -0,0 +1,41 @@
+// Just enough of MdePkg's Uefi.h to build JsonTokenLib on the host.
+#ifndef JSONBENCH_UEFI_H_
+#define JSONBENCH_UEFI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONST    const
+#define STATIC   static
+#define VOID     void
+#define TRUE     ((BOOLEAN)1)
+#define FALSE    ((BOOLEAN)0)
+
+typedef uint8_t    UINT8;
+typedef uint16_t   UINT16;
+typedef uint32_t   UINT32;
+typedef int32_t    INT32;
+typedef uint64_t   UINT64;
+typedef size_t     UINTN;
+typedef ptrdiff_t  INTN;
+typedef char       CHAR8;
+typedef uint8_t    BOOLEAN;
+typedef UINTN      RETURN_STATUS;
+typedef UINTN      EFI_STATUS;
+
+#define MAX_UINT32  ((UINT32)0xFFFFFFFF)
+#define MAX_UINT64  ((UINT64)0xFFFFFFFFFFFFFFFFULL)
+#define MAX_BIT     ((UINTN)1 << (sizeof(UINTN) * 8 - 1))
+#define ENCODE_ERROR(Code)  ((RETURN_STATUS)(MAX_BIT | (Code)))
+
+#define RETURN_ERROR(Status)   (((INTN)(RETURN_STATUS)(Status)) < 0)
+#define EFI_ERROR(Status)      RETURN_ERROR(Status)
+#define RETURN_SUCCESS         0
+#define RETURN_UNSUPPORTED     ENCODE_ERROR(3)
+#define EFI_SUCCESS            RETURN_SUCCESS
+#define EFI_INVALID_PARAMETER  ENCODE_ERROR(2)
+#define EFI_OUT_OF_RESOURCES   ENCODE_ERROR(9)
+#define EFI_NOT_FOUND          ENCODE_ERROR(14)
+#define EFI_COMPROMISED_DATA   ENCODE_ERROR(33)
+
+#endif  // JSONBENCH_UEFI_H_
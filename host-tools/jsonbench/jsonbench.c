@@ -0,0 +1,430 @@
+// Host benchmark for JsonTokenLib against the string-scanning manifest parser
+// it replaced. Both parse the same file into the same playback fields and
+// frame list, and the run fails unless their results agree.
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "JsonToken.h"
+
+#define PATH_CHARS  256
+
+typedef struct {
+  UINT64  Sum;               // Every field read folds in here
+  UINT32  FrameCount;
+  CHAR8   (*Paths)[PATH_CHARS];
+  UINT32  *Durations;
+  UINT64  Allocations;
+} PARSE_RESULT;
+
+static CONST CHAR8 *mUintKeys[] = {
+  "logical_width", "logical_height", "frame_duration_us", "loop_count",
+  "max_memory", "preload_percent", "max_total_duration_ms", "decode_workers"
+};
+static CONST CHAR8 *mBoolKeys[] = {
+  "allow_key_skip", "allow_frame_drop", "cache_frames",
+  "direct_framebuffer", "select_mode", "async_io"
+};
+static CONST CHAR8 *mStringKeys[] = { "scaling", "scale_filter" };
+
+//
+// BaseLib and BaseMemoryLib as MdePkg implements them, so the old parser pays
+// what it paid in firmware: a byte-by-byte AsciiStrStr and a length check
+// over the rest of the document in AsciiStrDecimalToUint64S.
+//
+UINTN
+AsciiStrLen(CONST CHAR8 *String) {
+  return strlen(String);
+}
+
+CHAR8 *
+AsciiStrStr(
+    CONST CHAR8 *String,
+    CONST CHAR8 *SearchString) {
+  CONST CHAR8 *First;
+  CONST CHAR8 *Search;
+
+  if (*SearchString == '\0') {
+    return (CHAR8 *)String;
+  }
+  while (*String != '\0') {
+    Search = SearchString;
+    First = String;
+    while (*String == *Search && *Search != '\0') {
+      String++;
+      Search++;
+    }
+    if (*Search == '\0') {
+      return (CHAR8 *)First;
+    }
+    String = First + 1;
+  }
+  return NULL;
+}
+
+RETURN_STATUS
+AsciiStrDecimalToUint64S(
+    CONST CHAR8 *String,
+    CHAR8 **EndPointer,
+    UINT64 *Data) {
+  static volatile UINTN LengthCheck;
+
+  LengthCheck += strlen(String);
+  while (*String == ' ' || *String == '\t') {
+    String++;
+  }
+  if (*String < '0' || *String > '9') {
+    return RETURN_UNSUPPORTED;
+  }
+  *Data = strtoull(String, EndPointer, 10);
+  return RETURN_SUCCESS;
+}
+
+UINT64
+LShiftU64(
+    UINT64 Operand,
+    UINTN Count) {
+  return Operand << Count;
+}
+
+UINT64
+RShiftU64(
+    UINT64 Operand,
+    UINTN Count) {
+  return Operand >> Count;
+}
+
+UINT64
+MultU64x32(
+    UINT64 Multiplicand,
+    UINT32 Multiplier) {
+  return Multiplicand * Multiplier;
+}
+
+VOID *
+CopyMem(
+    VOID *Destination,
+    CONST VOID *Source,
+    UINTN Length) {
+  return memmove(Destination, Source, Length);
+}
+
+INTN
+CompareMem(
+    CONST VOID *Destination,
+    CONST VOID *Source,
+    UINTN Length) {
+  return memcmp(Destination, Source, Length);
+}
+
+//
+// The parser before JsonTokenLib: AbJsonFindKey and friends, and
+// AbParseLooseFrames copying each frame object into its own allocation.
+//
+static CHAR8 *
+OldFindKey(
+    CHAR8 *Json,
+    CONST CHAR8 *Key) {
+  CHAR8 Pattern[64];
+
+  snprintf(Pattern, sizeof(Pattern), "\"%s\"", Key);
+  return AsciiStrStr(Json, Pattern);
+}
+
+static CHAR8 *
+OldSkipNoise(CHAR8 *Ptr) {
+  while (*Ptr != '\0' &&
+         (*Ptr == ' ' || *Ptr == '\t' || *Ptr == '\n' ||
+          *Ptr == '\r' || *Ptr == ':' || *Ptr == ',')) {
+    ++Ptr;
+  }
+  return Ptr;
+}
+
+static BOOLEAN
+OldReadUint(
+    CHAR8 *Json,
+    CONST CHAR8 *Key,
+    UINT64 *Value) {
+  CHAR8 *KeyPtr = OldFindKey(Json, Key);
+
+  if (KeyPtr == NULL) {
+    return FALSE;
+  }
+  return !RETURN_ERROR(AsciiStrDecimalToUint64S(OldSkipNoise(KeyPtr + strlen(Key) + 2), NULL, Value));
+}
+
+static BOOLEAN
+OldReadBool(
+    CHAR8 *Json,
+    CONST CHAR8 *Key,
+    BOOLEAN *Value) {
+  CHAR8 *KeyPtr = OldFindKey(Json, Key);
+  CHAR8 *ValuePtr;
+
+  if (KeyPtr == NULL) {
+    return FALSE;
+  }
+  ValuePtr = OldSkipNoise(KeyPtr + strlen(Key) + 2);
+  if (strncmp(ValuePtr, "true", 4) == 0) {
+    *Value = TRUE;
+    return TRUE;
+  }
+  if (strncmp(ValuePtr, "false", 5) == 0) {
+    *Value = FALSE;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static BOOLEAN
+OldReadString(
+    CHAR8 *Json,
+    CONST CHAR8 *Key,
+    CHAR8 *Buffer,
+    UINTN BufferSize) {
+  CHAR8 *KeyPtr = OldFindKey(Json, Key);
+  CHAR8 *ValuePtr;
+  UINTN Index;
+
+  if (KeyPtr == NULL) {
+    return FALSE;
+  }
+  ValuePtr = OldSkipNoise(KeyPtr + strlen(Key) + 2);
+  if (*ValuePtr != '"') {
+    return FALSE;
+  }
+  ++ValuePtr;
+  for (Index = 0; Index + 1 < BufferSize && ValuePtr[Index] != '\0' && ValuePtr[Index] != '"'; ++Index) {
+    Buffer[Index] = ValuePtr[Index];
+  }
+  Buffer[Index] = '\0';
+  return TRUE;
+}
+
+static int
+OldParse(
+    CHAR8 *Json,
+    PARSE_RESULT *Result) {
+  CHAR8 Buffer[16];
+  CHAR8 *FramesKey;
+  CHAR8 *ArrayStart;
+  CHAR8 *ArrayEnd;
+  CHAR8 *Cursor;
+  UINT64 Value;
+  BOOLEAN Flag;
+  UINT32 Count = 0;
+  UINT32 Index = 0;
+  UINTN Key;
+
+  for (Key = 0; Key < sizeof(mUintKeys) / sizeof(mUintKeys[0]); ++Key) {
+    if (OldReadUint(Json, mUintKeys[Key], &Value)) {
+      Result->Sum += Value;
+    }
+  }
+  for (Key = 0; Key < sizeof(mBoolKeys) / sizeof(mBoolKeys[0]); ++Key) {
+    if (OldReadBool(Json, mBoolKeys[Key], &Flag)) {
+      Result->Sum += Flag;
+    }
+  }
+  for (Key = 0; Key < sizeof(mStringKeys) / sizeof(mStringKeys[0]); ++Key) {
+    if (OldReadString(Json, mStringKeys[Key], Buffer, sizeof(Buffer))) {
+      Result->Sum += strlen(Buffer);
+    }
+  }
+
+  FramesKey = OldFindKey(Json, "frames");
+  if (FramesKey == NULL) {
+    return -1;
+  }
+  ArrayStart = AsciiStrStr(FramesKey, "[");
+  ArrayEnd = AsciiStrStr(FramesKey, "]");
+  if (ArrayStart == NULL || ArrayEnd == NULL) {
+    return -1;
+  }
+  for (Cursor = ArrayStart; Cursor < ArrayEnd; ++Cursor) {
+    Count += (*Cursor == '{');
+  }
+  if (Count > Result->FrameCount) {
+    return -1;
+  }
+
+  Cursor = ArrayStart;
+  while (Cursor < ArrayEnd && Index < Count) {
+    CHAR8 *ObjectStart = AsciiStrStr(Cursor, "{");
+    CHAR8 *ObjectEnd = AsciiStrStr(ObjectStart, "}");
+    UINTN Length = (UINTN)(ObjectEnd - ObjectStart + 1);
+    CHAR8 *Segment = calloc(1, Length + 1);
+
+    Result->Allocations++;
+    memcpy(Segment, ObjectStart, Length);
+    if (!OldReadString(Segment, "path", Result->Paths[Index], PATH_CHARS)) {
+      free(Segment);
+      return -1;
+    }
+    Result->Durations[Index] = OldReadUint(Segment, "duration_us", &Value) ? (UINT32)Value : 0;
+    free(Segment);
+    Index++;
+    Cursor = ObjectEnd + 1;
+  }
+  Result->FrameCount = Index;
+  return 0;
+}
+
+//
+// The same reads through JsonTokenLib, as AbLoadLooseManifest does them.
+//
+static int
+NewParse(
+    CONST CHAR8 *Json,
+    UINTN Length,
+    PARSE_RESULT *Result) {
+  JSON_KEY_TABLE Keys;
+  JSON_KEY_TABLE Object;
+  JSON_ARRAY_CURSOR Cursor;
+  CHAR8 Buffer[16];
+  UINT64 Value;
+  BOOLEAN Flag;
+  UINTN Key;
+
+  if (EFI_ERROR(AbJsonTokenize(Json, Length, &Keys, NULL))) {
+    return -1;
+  }
+  for (Key = 0; Key < sizeof(mUintKeys) / sizeof(mUintKeys[0]); ++Key) {
+    if (AbJsonGetUint(&Keys, mUintKeys[Key], &Value)) {
+      Result->Sum += Value;
+    }
+  }
+  for (Key = 0; Key < sizeof(mBoolKeys) / sizeof(mBoolKeys[0]); ++Key) {
+    if (AbJsonGetBool(&Keys, mBoolKeys[Key], &Flag)) {
+      Result->Sum += Flag;
+    }
+  }
+  for (Key = 0; Key < sizeof(mStringKeys) / sizeof(mStringKeys[0]); ++Key) {
+    if (AbJsonGetString(&Keys, mStringKeys[Key], Buffer, sizeof(Buffer))) {
+      Result->Sum += strlen(Buffer);
+    }
+  }
+
+  if (!AbJsonGetArray(&Keys, "frames", &Cursor) || Cursor.Count > Result->FrameCount) {
+    return -1;
+  }
+  while (Cursor.Index < Cursor.Count) {
+    if (EFI_ERROR(AbJsonNextObject(&Cursor, &Object)) ||
+        !AbJsonGetString(&Object, "path", Result->Paths[Cursor.Index - 1], PATH_CHARS)) {
+      return -1;
+    }
+    Result->Durations[Cursor.Index - 1] =
+        AbJsonGetUint(&Object, "duration_us", &Value) ? (UINT32)Value : 0;
+  }
+  Result->FrameCount = Cursor.Count;
+  return 0;
+}
+
+static double
+NowUs(VOID) {
+  struct timespec Time;
+
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return Time.tv_sec * 1e6 + Time.tv_nsec / 1e3;
+}
+
+static VOID
+ResetResult(
+    PARSE_RESULT *Result,
+    UINT32 Capacity) {
+  Result->Sum = 0;
+  Result->FrameCount = Capacity;
+  Result->Allocations = 0;
+}
+
+int
+main(
+    int Argc,
+    char **Argv) {
+  PARSE_RESULT Old = { 0 };
+  PARSE_RESULT New = { 0 };
+  CHAR8 *Json;
+  FILE *File;
+  long Length;
+  UINT32 Capacity;
+  UINT32 Index;
+  int Reps;
+  int Rep;
+  double Start;
+  double OldBest = 0;
+  double NewBest = 0;
+  double Elapsed;
+
+  if (Argc < 2) {
+    fprintf(stderr, "usage: %s manifest.json [repetitions]\n", Argv[0]);
+    return 2;
+  }
+  Reps = (Argc > 2) ? atoi(Argv[2]) : 20;
+  if (Reps < 1) {
+    Reps = 1;
+  }
+  File = fopen(Argv[1], "rb");
+  if (File == NULL) {
+    perror(Argv[1]);
+    return 1;
+  }
+  fseek(File, 0, SEEK_END);
+  Length = ftell(File);
+  fseek(File, 0, SEEK_SET);
+  Json = calloc(1, (size_t)Length + 1);
+  if (Json == NULL || fread(Json, 1, (size_t)Length, File) != (size_t)Length) {
+    fprintf(stderr, "%s: read failed\n", Argv[1]);
+    return 1;
+  }
+  fclose(File);
+
+  // Every frame object is at least {"path":""}, which bounds the count.
+  Capacity = (UINT32)(Length / 11 + 1);
+  Old.Paths = calloc(Capacity, PATH_CHARS);
+  New.Paths = calloc(Capacity, PATH_CHARS);
+  Old.Durations = calloc(Capacity, sizeof(UINT32));
+  New.Durations = calloc(Capacity, sizeof(UINT32));
+
+  for (Rep = 0; Rep < Reps; ++Rep) {
+    ResetResult(&Old, Capacity);
+    Start = NowUs();
+    if (OldParse(Json, &Old) != 0) {
+      fprintf(stderr, "old parser failed\n");
+      return 1;
+    }
+    Elapsed = NowUs() - Start;
+    OldBest = (Rep == 0 || Elapsed < OldBest) ? Elapsed : OldBest;
+
+    ResetResult(&New, Capacity);
+    Start = NowUs();
+    if (NewParse(Json, (UINTN)Length, &New) != 0) {
+      fprintf(stderr, "new parser failed\n");
+      return 1;
+    }
+    Elapsed = NowUs() - Start;
+    NewBest = (Rep == 0 || Elapsed < NewBest) ? Elapsed : NewBest;
+  }
+
+  if (Old.Sum != New.Sum || Old.FrameCount != New.FrameCount) {
+    fprintf(stderr, "parsers disagree on fields or frame count\n");
+    return 1;
+  }
+  for (Index = 0; Index < New.FrameCount; ++Index) {
+    if (strcmp(Old.Paths[Index], New.Paths[Index]) != 0 || Old.Durations[Index] != New.Durations[Index]) {
+      fprintf(stderr, "parsers disagree on frame %u\n", Index);
+      return 1;
+    }
+  }
+
+  printf("%s: %ld bytes, %u frames, best of %d: old %.1f us (%llu allocations), new %.1f us (0 allocations), %.2fx\n",
+         Argv[1], Length, New.FrameCount, Reps, OldBest, (unsigned long long)Old.Allocations, NewBest,
+         OldBest / NewBest);
+  return 0;
+}
@@ -332,12 +332,12 @@ function Create-ConfigFile {
 
     if ($isPackage) {
         $config = @{
-            animation_path = "$($PartitionLabel):\\animations\\splash.anim"
-            manifest_path = "$($PartitionLabel):\\animations\\sequence.anim.json"
+            animation_path = "$($PartitionLabel):\animations\splash.anim"
+            manifest_path = "$($PartitionLabel):\animations\sequence.anim.json"
         }
     } else {
         $config = @{
-            animation_path = "$($PartitionLabel):\\animations\\sequence.anim.json"
+            animation_path = "$($PartitionLabel):\animations\sequence.anim.json"
         }
     }
 